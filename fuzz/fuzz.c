@@ -0,0 +1,718 @@
+/*
+    The differential fuzzing harness of the table. An input is a sequence
+    of operations: insertions, deletions, lookups, resizes, rehash steps,
+    snapshots and copies. The harness runs them on a table and on a simple
+    reference model, every result of the table is checked against the model.
+    The first byte of the input is the mode of the table, the second one
+    is its size, so small tables are full, evict and grow often.
+    The harness counts the probes of lookups and the time of the calls
+    of the table for every mode, see `fuzz_report`.
+    A mismatch prints the operation and aborts, the input is written
+    to FUZZ_CRASH_FILE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fuzz.h"
+#include "hashtable.h"
+
+// The keys of inputs are FUZZ_KEYS keys, every FUZZ_LONG_KEYS key is long.
+#define FUZZ_KEYS 192
+#define FUZZ_LONG_KEYS 8
+#define FUZZ_KEY_BYTES 48
+// The model keeps at most FUZZ_RUN values of a key of `TB_MULTI` tables.
+#define FUZZ_RUN 16
+// The number of keys of `tb_get_values`.
+#define FUZZ_BATCH 8
+// The default time to live of `TB_TTL` tables.
+#define FUZZ_TTL 8
+// Tables grow by `tb_reserve` up to FUZZ_MAX_SIZE items.
+#define FUZZ_MAX_SIZE 4096
+#define FUZZ_CRASH_FILE "fuzz-crash.bin"
+
+/*
+    A mode of the table, the options of `tb_create_hash_table_ex`.
+ */
+typedef struct {
+    const char *name;
+    uint32_t flags;
+    uint32_t probing;
+    uint32_t memory;
+} fuzz_mode;
+
+static const fuzz_mode modes[FUZZ_MODES] = {
+    {"double", 0, TB_PROBE_DOUBLE, 0},
+    {"quadratic", 0, TB_PROBE_QUADRATIC, 0},
+    {"linear", 0, TB_PROBE_LINEAR, 0},
+    {"compact", TB_COMPACT, TB_PROBE_DOUBLE, 0},
+    {"compact filter seeded", TB_COMPACT | TB_FILTER | TB_SEEDED, TB_PROBE_LINEAR, 0},
+    {"cuckoo", TB_CUCKOO, TB_PROBE_DOUBLE, 0},
+    {"cuckoo seeded", TB_CUCKOO | TB_SEEDED, TB_PROBE_DOUBLE, 0},
+    {"filter", TB_FILTER, TB_PROBE_DOUBLE, 0},
+    {"seeded", TB_SEEDED, TB_PROBE_QUADRATIC, 0},
+    {"lru", TB_LRU, TB_PROBE_DOUBLE, 0},
+    {"ttl", TB_TTL, TB_PROBE_LINEAR, 0},
+    {"lru ttl filter", TB_LRU | TB_TTL | TB_FILTER, TB_PROBE_DOUBLE, 0},
+    {"interned", TB_INTERNED, TB_PROBE_DOUBLE, 0},
+    {"multi", TB_MULTI, TB_PROBE_DOUBLE, 0},
+    {"multi filter", TB_MULTI | TB_FILTER, TB_PROBE_LINEAR, 0},
+    {"arena", 0, TB_PROBE_QUADRATIC, TB_MEMORY_PREFAULT},
+};
+
+/*
+    The statistics of a mode: the probes of found and missing keys
+    by `tb_probe_length`, the time of the calls of the table.
+ */
+typedef struct {
+    uint64_t runs;
+    uint64_t operations;
+    uint64_t hits;
+    uint64_t hit_probes;
+    uint64_t misses;
+    uint64_t miss_probes;
+    uint32_t max_probes;
+    uint64_t nanoseconds;
+} fuzz_stats;
+
+static fuzz_stats stats[FUZZ_MODES];
+
+/*
+    A key of the model. `present` keys were inserted and not removed,
+    `TB_TTL` tables can remove them after `expires`. `used` is the time
+    of the last use of `TB_LRU` tables. `values` are the `count` values
+    of `TB_MULTI` tables, other tables have one value.
+ */
+typedef struct {
+    int present;
+    uint64_t expires;
+    uint64_t used;
+    uint32_t count;
+    int64_t values[FUZZ_RUN];
+} fuzz_entry;
+
+/*
+    The state of a run: the table, the model, the snapshot and its model,
+    the input and the number of the operation.
+ */
+typedef struct {
+    const fuzz_mode *mode;
+    fuzz_stats *stats;
+    tb_hash_table *table;
+    fuzz_entry model[FUZZ_KEYS];
+    uint64_t tick;
+    tb_table_snapshot *snapshot;
+    fuzz_entry snapshot_model[FUZZ_KEYS];
+    uint64_t snapshot_now;
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint64_t operation;
+} fuzz_state;
+
+static char keys[FUZZ_KEYS][FUZZ_KEY_BYTES];
+static uint64_t fuzz_now;
+static const uint8_t *crash_data;
+static size_t crash_size;
+
+#define CHECK(state, condition) { \
+    if (!(condition)) { \
+        fuzz_fail((state), #condition, __LINE__); \
+    } \
+}
+
+/*
+    A static function, the clock of `TB_TTL` tables, the harness moves it.
+    Returns the time in milliseconds.
+ */
+static uint64_t fuzz_clock(void) {
+    return fuzz_now;
+}
+
+/*
+    A static function, the monotonic time.
+    Returns the time in nanoseconds.
+ */
+static uint64_t fuzz_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+/*
+    A static function, prints a mismatch of the table and the model,
+    writes the input to FUZZ_CRASH_FILE and aborts.
+    Nothing to returns.
+ */
+static void fuzz_fail(const fuzz_state *state, const char *condition, int line) {
+    fflush(stdout);
+    fprintf(stderr, "Fuzzing failed! Mode: %s. Operation: %llu. Check: %s. Line: %i \n",
+            state->mode->name, (unsigned long long)state->operation, condition, line);
+    FILE *file = fopen(FUZZ_CRASH_FILE, "wb");
+    if (file != NULL) {
+        fwrite(crash_data, 1, crash_size, file);
+        fclose(file);
+    }
+    abort();
+}
+
+/*
+    A static function, fills the keys once. Long keys have a common prefix,
+    every key ends with "_" and its number.
+    Nothing to returns.
+ */
+static void init_keys(void) {
+    if (keys[0][0]) {
+        return;
+    }
+    for (uint32_t k = 0; k < FUZZ_KEYS; ++k) {
+        if (k % FUZZ_LONG_KEYS == FUZZ_LONG_KEYS - 1) {
+            snprintf(keys[k], FUZZ_KEY_BYTES, "a_long_key_with_a_common_prefix_%u", k);
+        } else {
+            snprintf(keys[k], FUZZ_KEY_BYTES, "k_%u", k);
+        }
+    }
+}
+
+/*
+    A static function, the number of a key of the table.
+    Returns the number of the key.
+ */
+static uint32_t key_number(const char *key) {
+    return (uint32_t)strtoul(strrchr(key, '_') + 1, NULL, 10);
+}
+
+/*
+    A static function, the next byte of the input.
+    Returns the byte, or 0 after the end of the input.
+ */
+static uint8_t next_byte(fuzz_state *state) {
+    return state->offset < state->size ? state->data[state->offset++] : 0;
+}
+
+/*
+    A static function, checks if the key of the model is in the table:
+    it is present and not expired.
+    Returns 1 if the key is live, otherwise 0.
+ */
+static int is_live(const fuzz_state *state, const fuzz_entry *entry, uint64_t now) {
+    return entry->present && !((state->mode->flags & TB_TTL) && entry->expires && entry->expires <= now);
+}
+
+/*
+    A static function, the number of live keys of the model.
+    Returns the number of keys.
+ */
+static uint32_t live_count(const fuzz_state *state) {
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < FUZZ_KEYS; ++k) {
+        count += (uint32_t)is_live(state, &state->model[k], fuzz_now);
+    }
+    return count;
+}
+
+/*
+    A static function, removes all expired items from a `TB_TTL` table
+    and the model, so the next insertion does not depend on the steps
+    of expiration.
+    Nothing to returns.
+ */
+static void expire_all(fuzz_state *state) {
+    tb_expire_step(state->table, state->table->allocated);
+    for (uint32_t k = 0; k < FUZZ_KEYS; ++k) {
+        state->model[k].present = is_live(state, &state->model[k], fuzz_now);
+    }
+}
+
+/*
+    A static function, a key for the functions with the length of keys:
+    the key is followed by other bytes in `buffer`.
+    Returns the key in the buffer.
+ */
+static const char *key_in_buffer(char *buffer, uint32_t k) {
+    size_t length = strlen(keys[k]);
+    memcpy(buffer, keys[k], length);
+    memcpy(buffer + length, "_0xyz", 6);
+    return buffer;
+}
+
+/*
+    A static function, checks the value of a lookup of the key `k`,
+    `value` is NULL or the first value. Counts the probes of the key.
+    Nothing to returns.
+ */
+static void check_value(fuzz_state *state, uint32_t k, const void *value) {
+    fuzz_entry *entry = &state->model[k];
+    uint32_t probes = tb_probe_length(state->table, keys[k]);
+    if (probes > state->stats->max_probes) {
+        state->stats->max_probes = probes;
+    }
+    if (is_live(state, entry, fuzz_now)) {
+        CHECK(state, value != NULL);
+        int64_t found;
+        memcpy(&found, value, sizeof(found));
+        CHECK(state, found == entry->values[0]);
+        entry->used = ++state->tick;
+        ++state->stats->hits;
+        state->stats->hit_probes += probes;
+    } else {
+        CHECK(state, value == NULL);
+        ++state->stats->misses;
+        state->stats->miss_probes += probes;
+    }
+}
+
+/*
+    A static function, checks the values of an item of a `TB_MULTI` table.
+    Nothing to returns.
+ */
+static void check_run(const fuzz_state *state, const tb_hash_table *table,
+        const tb_hash_table_item *item, const fuzz_entry *entry) {
+    uint32_t count;
+    void *values = tb_item_values(table, item, &count);
+    CHECK(state, count == entry->count);
+    for (uint32_t i = 0; i < count; ++i) {
+        CHECK(state, memcmp(TB_VALUE_AT(values, i), &entry->values[i], sizeof(int64_t)) == 0);
+    }
+}
+
+/*
+    A static function, checks all items of a table by its iteration,
+    the table is not touched. Open addressing tables have the right
+    numbers of items and tombstones in their slots.
+    Nothing to returns.
+ */
+static void check_table(const fuzz_state *state, const tb_hash_table *table) {
+    uint8_t seen[FUZZ_KEYS] = {0};
+    uint32_t position = 0, live = 0, present = 0;
+    tb_hash_table_item *item;
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        uint32_t k = key_number(item->key);
+        CHECK(state, k < FUZZ_KEYS && !seen[k]);
+        CHECK(state, (table->flags & TB_INTERNED) ? item->key == keys[k] : strcmp(item->key, keys[k]) == 0);
+        seen[k] = 1;
+        const fuzz_entry *entry = &state->model[k];
+        CHECK(state, is_live(state, entry, fuzz_now));
+        if (table->flags & TB_MULTI) {
+            check_run(state, table, item, entry);
+        } else {
+            CHECK(state, memcmp(item->val, &entry->values[0], sizeof(int64_t)) == 0);
+        }
+    }
+    for (uint32_t k = 0; k < FUZZ_KEYS; ++k) {
+        live += (uint32_t)is_live(state, &state->model[k], fuzz_now);
+        present += (uint32_t)state->model[k].present;
+        CHECK(state, seen[k] == is_live(state, &state->model[k], fuzz_now));
+    }
+    if (table->flags & TB_TTL) {
+        // expired items are counted until they are removed
+        CHECK(state, live <= table->count && table->count <= present);
+    } else {
+        CHECK(state, table->count == live);
+    }
+    CHECK(state, table->count <= table->size);
+    CHECK(state, !(table->empty && table->count));
+    if (!(table->flags & (TB_COMPACT | TB_CUCKOO))) {
+        uint32_t items = 0, tombstones = 0;
+        for (uint32_t index = 0; index < table->allocated; ++index) {
+            items += table->items[index] != NULL && table->items[index] != EMPTY_ITEM;
+            tombstones += table->items[index] == EMPTY_ITEM;
+        }
+        CHECK(state, items == table->count && tombstones == table->tombstones);
+        CHECK(state, items <= table->allocated);
+    }
+}
+
+/*
+    A static function, checks all keys of the snapshot against the model
+    of the table at the time of the snapshot.
+    Nothing to returns.
+ */
+static void check_snapshot(fuzz_state *state) {
+    for (uint32_t k = 0; k < FUZZ_KEYS; ++k) {
+        const fuzz_entry *entry = &state->snapshot_model[k];
+        const void *value = tb_snapshot_get_value(state->snapshot, keys[k]);
+        if (is_live(state, entry, state->snapshot_now)) {
+            CHECK(state, value != NULL && memcmp(value, &entry->values[0], sizeof(int64_t)) == 0);
+        } else {
+            CHECK(state, value == NULL);
+        }
+    }
+}
+
+/*
+    A static function, sets the value of the key `k` in the model,
+    a new key is evicted from a full `TB_LRU` table, see `fuzz_insert`.
+    Nothing to returns.
+ */
+static void model_insert(fuzz_state *state, uint32_t k, int64_t value, uint64_t ttl) {
+    fuzz_entry *entry = &state->model[k];
+    if (!is_live(state, entry, fuzz_now) && (state->mode->flags & TB_LRU)
+            && live_count(state) == state->table->size) {
+        fuzz_entry *oldest = NULL;
+        for (uint32_t i = 0; i < FUZZ_KEYS; ++i) {
+            fuzz_entry *other = &state->model[i];
+            if (is_live(state, other, fuzz_now) && (oldest == NULL || other->used < oldest->used)) {
+                oldest = other;
+            }
+        }
+        oldest->present = 0;
+    }
+    if (!is_live(state, entry, fuzz_now)) {
+        entry->count = 1;
+    }
+    entry->present = 1;
+    entry->values[0] = value;
+    entry->expires = ttl ? fuzz_now + ttl : 0;
+    entry->used = ++state->tick;
+}
+
+/*
+    A static function, checks if a new key can be inserted: the table
+    is not full, or it evicts. Expired items of `TB_TTL` tables are
+    removed first, if the table is full.
+    Returns 1 if the key can be inserted, otherwise 0.
+ */
+static int has_room(fuzz_state *state, uint32_t k) {
+    if (is_live(state, &state->model[k], fuzz_now)) {
+        return 1;
+    }
+    if ((state->mode->flags & TB_TTL) && state->table->count == state->table->size) {
+        // the insertion would remove all expired items itself
+        expire_all(state);
+    }
+    return (state->mode->flags & TB_LRU) || live_count(state) < state->table->size;
+}
+
+/*
+    A static function, inserts or appends a value of the key `k`.
+    Nothing to returns.
+ */
+static void fuzz_insert(fuzz_state *state, uint32_t k) {
+    uint8_t kind = next_byte(state);
+    int64_t value = (int64_t)next_byte(state) << 8 | (int64_t)state->operation;
+    fuzz_entry *entry = &state->model[k];
+    const fuzz_mode *mode = state->mode;
+    if (!has_room(state, k)) {
+        return;
+    }
+    char buffer[FUZZ_KEY_BYTES + 8];
+    uint64_t ttl = mode->flags & TB_TTL ? FUZZ_TTL : 0;
+    uint64_t begin = fuzz_ns();
+    if ((mode->flags & TB_MULTI) && kind % 2) {
+        if (is_live(state, entry, fuzz_now) && entry->count == FUZZ_RUN) {
+            return;
+        }
+        uint32_t count = kind % 4 == 1 ? tb_append_value(state->table, keys[k], &value)
+            : tb_append_value_n(state->table, key_in_buffer(buffer, k), strlen(keys[k]), &value);
+        state->stats->nanoseconds += fuzz_ns() - begin;
+        if (is_live(state, entry, fuzz_now)) {
+            entry->values[entry->count++] = value;
+        } else {
+            model_insert(state, k, value, 0);
+        }
+        CHECK(state, count == entry->count);
+        return;
+    }
+    if ((mode->flags & TB_TTL) && kind % 3 == 1) {
+        ttl = kind % 16;
+        tb_insert_item_ttl(state->table, keys[k], &value, ttl);
+    } else if (kind % 3 == 2 && !(mode->flags & TB_INTERNED)) {
+        tb_hash_table_item *item = tb_insert_item_n(state->table, key_in_buffer(buffer, k),
+                strlen(keys[k]), &value);
+        CHECK(state, item != NULL && strcmp(item->key, keys[k]) == 0);
+    } else {
+        tb_insert_item(state->table, keys[k], &value);
+    }
+    state->stats->nanoseconds += fuzz_ns() - begin;
+    model_insert(state, k, value, ttl);
+}
+
+/*
+    A static function, looks up the key `k` by one of the lookup functions.
+    Nothing to returns.
+ */
+static void fuzz_get(fuzz_state *state, uint32_t k) {
+    uint8_t kind = next_byte(state) % 4;
+    char buffer[FUZZ_KEY_BYTES + 8];
+    const void *value;
+    uint64_t begin = fuzz_ns();
+    if (kind == 1 && !(state->mode->flags & TB_INTERNED)) {
+        value = tb_get_value_n(state->table, key_in_buffer(buffer, k), strlen(keys[k]));
+    } else if (kind == 2) {
+        tb_hash_table_item *item = tb_get_item(state->table, keys[k]);
+        value = item != NULL ? item->val : NULL;
+    } else if (kind == 3) {
+        uint32_t count;
+        void *values = tb_get_all_values(state->table, keys[k], &count);
+        state->stats->nanoseconds += fuzz_ns() - begin;
+        if (state->mode->flags & TB_MULTI) {
+            CHECK(state, count == (is_live(state, &state->model[k], fuzz_now) ? state->model[k].count : 0));
+            for (uint32_t i = 0; i < count; ++i) {
+                CHECK(state, memcmp(TB_VALUE_AT(values, i), &state->model[k].values[i], sizeof(int64_t)) == 0);
+            }
+        } else {
+            CHECK(state, count == (values != NULL));
+        }
+        check_value(state, k, values);
+        return;
+    } else {
+        value = tb_get_value(state->table, keys[k]);
+    }
+    state->stats->nanoseconds += fuzz_ns() - begin;
+    check_value(state, k, value);
+}
+
+/*
+    A static function, looks up FUZZ_BATCH keys by `tb_get_values`.
+    Nothing to returns.
+ */
+static void fuzz_get_batch(fuzz_state *state) {
+    const char *batch[FUZZ_BATCH];
+    uint32_t numbers[FUZZ_BATCH];
+    void *values[FUZZ_BATCH];
+    for (uint32_t i = 0; i < FUZZ_BATCH; ++i) {
+        numbers[i] = next_byte(state) % FUZZ_KEYS;
+        batch[i] = keys[numbers[i]];
+    }
+    uint64_t begin = fuzz_ns();
+    uint32_t found = tb_get_values(state->table, batch, FUZZ_BATCH, values);
+    state->stats->nanoseconds += fuzz_ns() - begin;
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < FUZZ_BATCH; ++i) {
+        expected += (uint32_t)is_live(state, &state->model[numbers[i]], fuzz_now);
+        check_value(state, numbers[i], values[i]);
+    }
+    CHECK(state, found == expected);
+}
+
+/*
+    A static function, removes the key `k`, or one value of it
+    in `TB_MULTI` tables.
+    Nothing to returns.
+ */
+static void fuzz_delete(fuzz_state *state, uint32_t k) {
+    uint8_t kind = next_byte(state);
+    fuzz_entry *entry = &state->model[k];
+    int live = is_live(state, entry, fuzz_now);
+    char buffer[FUZZ_KEY_BYTES + 8];
+    int deleted;
+    uint64_t begin = fuzz_ns();
+    if ((state->mode->flags & TB_MULTI) && kind % 2) {
+        int64_t value = live ? entry->values[(kind >> 1) % entry->count] : (int64_t)kind;
+        deleted = tb_delete_value(state->table, keys[k], &value);
+        state->stats->nanoseconds += fuzz_ns() - begin;
+        CHECK(state, deleted == live);
+        if (live) {
+            uint32_t i = 0;
+            while (entry->values[i] != value) {
+                ++i;
+            }
+            memmove(&entry->values[i], &entry->values[i + 1], (entry->count - i - 1) * sizeof(int64_t));
+            entry->present = --entry->count > 0;
+        }
+        return;
+    }
+    if (kind % 2 && !(state->mode->flags & TB_INTERNED)) {
+        deleted = tb_delete_item_n(state->table, key_in_buffer(buffer, k), strlen(keys[k]));
+    } else {
+        deleted = tb_delete_item(state->table, keys[k]);
+    }
+    state->stats->nanoseconds += fuzz_ns() - begin;
+    if (live || !entry->present) {
+        // an expired item can be removed already
+        CHECK(state, deleted == live);
+    }
+    entry->present = 0;
+}
+
+/*
+    A static function, resizes the table: grows it, shrinks it to its
+    items or moves the slots of a rehash.
+    Nothing to returns.
+ */
+static void fuzz_resize(fuzz_state *state) {
+    uint8_t kind = next_byte(state);
+    tb_hash_table *table = state->table;
+    int layout = !(table->flags & (TB_COMPACT | TB_CUCKOO));
+    uint64_t begin = fuzz_ns();
+    if (kind % 4 == 0 && table->size < FUZZ_MAX_SIZE) {
+        uint32_t size = table->size + 1 + kind / 4;
+        int reserved = tb_reserve(table, size);
+        CHECK(state, reserved == (state->snapshot == NULL));
+        CHECK(state, !reserved || table->size == size);
+    } else if (kind % 4 == 1) {
+        uint32_t size = table->size;
+        int shrunk = tb_shrink_to_fit(table);
+        CHECK(state, shrunk == (layout && state->snapshot == NULL));
+        CHECK(state, table->size == size);
+    } else {
+        tb_rehash_step(table, kind);
+    }
+    state->stats->nanoseconds += fuzz_ns() - begin;
+}
+
+/*
+    A static function, takes a snapshot of the table, or checks and deletes
+    the snapshot. Only open addressing tables have snapshots.
+    Nothing to returns.
+ */
+static void fuzz_snapshot(fuzz_state *state) {
+    if (state->table->flags & (TB_COMPACT | TB_CUCKOO)) {
+        return;
+    }
+    if (state->snapshot == NULL) {
+        // the slots of `tb_shrink_to_fit` can not grow with a snapshot
+        CHECK(state, tb_reserve(state->table, state->table->size));
+        state->snapshot = tb_snapshot(state->table);
+        CHECK(state, state->snapshot != NULL);
+        memcpy(state->snapshot_model, state->model, sizeof(state->model));
+        state->snapshot_now = fuzz_now;
+        return;
+    }
+    check_snapshot(state);
+    tb_delete_snapshot(state->snapshot);
+    state->snapshot = NULL;
+}
+
+/*
+    A static function, copies the table and checks the copy.
+    Nothing to returns.
+ */
+static void fuzz_copy(fuzz_state *state) {
+    tb_hash_table *copy = tb_copy_hash_table(state->table);
+    CHECK(state, copy != NULL);
+    check_table(state, copy);
+    tb_delete_hash_table(copy);
+}
+
+/*
+    The name of the mode `mode`.
+    Returns the name.
+ */
+const char *fuzz_mode_name(uint32_t mode) {
+    return modes[mode % FUZZ_MODES].name;
+}
+
+/*
+    A static function, runs the operations of `data` on a table of the mode
+    `mode` and on the model, `data` starts with the size of the table.
+    A mismatch aborts, see `fuzz_fail`.
+    Nothing to returns.
+ */
+static void fuzz_run(uint32_t mode, const uint8_t *data, size_t size) {
+    static fuzz_state state;
+    init_keys();
+    memset(&state, 0, sizeof(state));
+    state.mode = &modes[mode % FUZZ_MODES];
+    state.stats = &stats[mode % FUZZ_MODES];
+    state.data = data;
+    state.size = size;
+    fuzz_now = 1000;
+    tb_hash_table_options options = {0};
+    options.flags = state.mode->flags;
+    options.probing = state.mode->probing;
+    options.memory = state.mode->memory;
+    options.ttl = FUZZ_TTL;
+    options.clock = fuzz_clock;
+    state.table = tb_create_hash_table_ex(1 + next_byte(&state) % 64, &options);
+    CHECK(&state, state.table != NULL);
+    ++state.stats->runs;
+    while (state.offset < state.size) {
+        uint8_t operation = next_byte(&state);
+        uint32_t k = next_byte(&state) % FUZZ_KEYS;
+        ++state.operation;
+        switch (operation % 16) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            fuzz_insert(&state, k);
+            break;
+        case 4:
+        case 5:
+        case 6:
+            fuzz_get(&state, k);
+            break;
+        case 7:
+            fuzz_get_batch(&state);
+            break;
+        case 8:
+        case 9:
+            fuzz_delete(&state, k);
+            break;
+        case 10:
+            fuzz_resize(&state);
+            break;
+        case 11:
+            // the time goes, a few slots are checked for expired items
+            fuzz_now += k % 4;
+            tb_expire_step(state.table, k);
+            break;
+        case 12:
+            check_table(&state, state.table);
+            break;
+        case 13:
+            fuzz_snapshot(&state);
+            break;
+        case 14:
+            fuzz_copy(&state);
+            break;
+        default:
+            if (k < 8) {
+                tb_clear(state.table);
+                memset(state.model, 0, sizeof(state.model));
+            }
+            break;
+        }
+    }
+    state.stats->operations += state.operation;
+    check_table(&state, state.table);
+    if (state.snapshot != NULL) {
+        check_snapshot(&state);
+        tb_delete_snapshot(state.snapshot);
+    }
+    tb_delete_hash_table(state.table);
+}
+
+/*
+    A static function, prints the statistics of all modes: the operations,
+    the time of the calls of the table, the mean probes of found
+    and missing keys by `tb_probe_length`.
+    Nothing to returns.
+ */
+static void fuzz_report(void) {
+    for (uint32_t mode = 0; mode < FUZZ_MODES; ++mode) {
+        const fuzz_stats *mode_stats = &stats[mode];
+        if (!mode_stats->runs) {
+            continue;
+        }
+        printf("Fuzzing of %s tables - %llu runs, %llu operations: %f ms of the table, "
+                "probes of hits %.2f, probes of misses %.2f, max %u \n",
+                modes[mode].name, (unsigned long long)mode_stats->runs,
+                (unsigned long long)mode_stats->operations,
+                (double)mode_stats->nanoseconds / 1000000,
+                mode_stats->hits ? (double)mode_stats->hit_probes / (double)mode_stats->hits : 0,
+                mode_stats->misses ? (double)mode_stats->miss_probes / (double)mode_stats->misses : 0,
+                mode_stats->max_probes);
+    }
+}
+
+/*
+    The entry of libFuzzer, the first byte of the input is the mode.
+    The statistics are printed at exit.
+    Returns 0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static int reported = 0;
+    if (!reported) {
+        reported = 1;
+        atexit(fuzz_report);
+    }
+    crash_data = data;
+    crash_size = size;
+    if (size > 0) {
+        fuzz_run(data[0], data + 1, size - 1);
+    }
+    return 0;
+}
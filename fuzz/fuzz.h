@@ -0,0 +1,16 @@
+/*
+    The differential fuzzing harness of the table, see fuzz.c.
+ */
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The number of modes of the table, which the harness checks.
+#define FUZZ_MODES 16
+
+const char *fuzz_mode_name(uint32_t mode);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#endif
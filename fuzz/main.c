@@ -0,0 +1,78 @@
+/*
+    The standalone driver of the fuzzing harness, see fuzz.c.
+    Without arguments or with numbers `runs` and `seed` it generates
+    `runs` random inputs for every mode. With files it replays them,
+    e.g. fuzz-crash.bin or inputs of libFuzzer. The statistics are 
+    printed at exit.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fuzz.h"
+
+// The maximum size of generated inputs and of replayed files.
+#define FUZZ_INPUT_BYTES 4096
+
+/*
+    A static function, the xorshift64 generator of inputs.
+    Returns the next random number.
+ */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/*
+    A static function, replays an input of libFuzzer from a file.
+    Returns 1 if the file is read, otherwise 0.
+ */
+static int replay(const char *path) {
+    static uint8_t data[FUZZ_INPUT_BYTES];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    printf("Replay of %s - %zu bytes, mode %s \n", path, size, size ? fuzz_mode_name(data[0]) : "none");
+    LLVMFuzzerTestOneInput(data, size);
+    return 1;
+}
+
+// main func
+int main(int argc, char** argv) {
+    if (argc > 1 && strspn(argv[1], "0123456789") != strlen(argv[1])) {
+        for (int i = 1; i < argc; ++i) {
+            if (!replay(argv[i])) {
+                printf("Can not read %s \n", argv[i]);
+                return 1;
+            }
+        }
+        return 0;
+    }
+    uint32_t runs = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    static uint8_t data[FUZZ_INPUT_BYTES];
+    for (uint32_t mode = 0; mode < FUZZ_MODES; ++mode) {
+        uint64_t random = seed * 0x9e3779b97f4a7c15ull + mode + 1;
+        for (uint32_t run = 0; run < runs; ++run) {
+            size_t size = 2 + next_random(&random) % (sizeof(data) - 1);
+            data[0] = (uint8_t)mode;
+            for (size_t i = 1; i < size; ++i) {
+                data[i] = (uint8_t)next_random(&random);
+            }
+            // a narrow range of keys makes more collisions and reuse
+            if (run % 2) {
+                for (size_t i = 3; i < size; i += 2) {
+                    data[i] %= 24;
+                }
+            }
+            LLVMFuzzerTestOneInput(data, size);
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <Python.h>
 #include <structmember.h>
-#include "../hashtable.h"
+#include <pthread.h>
+#include "../src/hashtable.h"
 
 #if PY_MAJOR_VERSION >= 3
 #define INIT_ERROR return NULL
@@ -8,6 +9,41 @@
 #define INIT_ERROR return
 #endif
 
+/*
+    Macros for the methods with several arguments.
+    Python 3.7+ passes arguments as a C array (`METH_FASTCALL`),
+    so no tuple is allocated for a call. Older versions use a tuple.
+ */
+#if PY_VERSION_HEX >= 0x03070000
+#define METH_FAST METH_FASTCALL
+#define FAST_ARGS PyObject *const *args, Py_ssize_t nargs
+#define FAST_UNPACK
+#else
+#define METH_FAST METH_VARARGS
+#define FAST_ARGS PyObject *tuple
+#define FAST_UNPACK \
+    PyObject **args = &PyTuple_GET_ITEM(tuple, 0); \
+    Py_ssize_t nargs = PyTuple_GET_SIZE(tuple);
+#endif
+
+/*
+    Bulk operations with at least this number of keys release the GIL.
+    For small batches releasing the GIL costs more than the lookups.
+ */
+#define BULK_NOGIL_MIN 256
+
+/*
+    Macros around the C loop of a bulk operation.
+    Release the GIL if the batch is big enough.
+ */
+#define BULK_BEGIN(count) { \
+    PyThreadState *_save = (count) >= BULK_NOGIL_MIN ? PyEval_SaveThread() : NULL;
+#define BULK_END \
+    if (_save) { \
+        PyEval_RestoreThread(_save); \
+    } \
+}
+
 /*
     A macro for the the value from the pointer;
  */
@@ -22,6 +58,8 @@
     `size` is the size of a table.
     `count` is the sum of the elements in a table.
     `empty` is 1 or 0.
+    `lock` is taken by every access to the C table, lookups share it.
+    Bulk operations hold it without the GIL, other callers wait for them.
  */
 typedef struct {
     PyObject_HEAD
@@ -29,21 +67,45 @@ typedef struct {
     uint32_t size;
     uint32_t count;
     uint32_t empty;
+    pthread_rwlock_t lock;
 } PyHashTable;
 
+/*
+    Kinds of the iterators and the views of the hash table.
+    `ITEMS` returns tuples `(key, value)`.
+    `KEYS` returns keys.
+    `VALUES` returns values.
+ */
+enum {
+    ITEMS = 0,
+    KEYS = 1,
+    VALUES = 2
+};
+
 /*
     The hash table iterator struct.
     `index` is a current index.
-    `size` is the size of a table.
-    `items` is an array of pointers.
+    `kind` is ITEMS, KEYS or VALUES.
+    `owner` is the hash table, the iterator holds a reference to it.
  */
 typedef struct {
     PyObject_HEAD
     uint32_t index;
-    uint32_t size;
-    tb_hash_table_item **items;
+    int kind;
+    PyHashTable *owner;
 } PyHashTableItems;
 
+/*
+    The view struct, returns by `keys()` and `values()`.
+    `kind` is KEYS or VALUES.
+    `owner` is the hash table, the view holds a reference to it.
+ */
+typedef struct {
+    PyObject_HEAD
+    int kind;
+    PyHashTable *owner;
+} PyHashTableView;
+
 // A module state.
 struct module_state {
     PyObject *error;
@@ -63,17 +125,160 @@ PyHashTable_new(PyTypeObject *type, PyObject *args)
         PyErr_Print();
         return NULL;
     }
+    pthread_rwlock_init(&hash_table->lock, NULL);
     return (PyObject *)hash_table;
 }
 
+/*
+    A static function, returns a pointer to the key string.
+    The key must be a string, otherwise sets `TypeError` and returns NULL.
+    The table keeps keys with NUL, so a key with NUL characters 
+    sets `ValueError` and returns NULL.
+    The pointer is valid while the key object is alive, nothing is copied.
+ */
+static const char *
+PyHashTable_key(PyObject *key)
+{
+    const char *result = NULL;
+    Py_ssize_t size = 0;
+#if PY_MAJOR_VERSION >= 3
+    if (PyUnicode_Check(key)) {
+        result = PyUnicode_AsUTF8AndSize(key, &size);
+    }
+#else
+    if (PyString_Check(key)) {
+        result = PyString_AS_STRING(key);
+        size = PyString_GET_SIZE(key);
+    }
+#endif
+    else {
+        PyErr_SetString(PyExc_TypeError, "The key must be a string.");
+        return NULL;
+    }
+    if (result != NULL && strlen(result) != (size_t)size) {
+        PyErr_SetString(PyExc_ValueError, "The key must not contain NUL characters.");
+        return NULL;
+    }
+    return result;
+}
+
+/*
+    A static function, copies `count` and `empty` from the C table.
+    Nothing to returns.
+ */
+static void
+PyHashTable_sync(PyHashTable *h_table)
+{
+    h_table->count = h_table->table->count;
+    h_table->empty = h_table->table->empty;
+}
+
+/*
+    A static function, locks the table for reading or for writing.
+    If a bulk operation holds the lock, waits for it without the GIL,
+    so the bulk operation can take the GIL back and finish.
+    No Python code runs while the lock is held, it can not be reentered.
+    Nothing to returns.
+ */
+static void
+PyHashTable_lock(PyHashTable *h_table, int write)
+{
+    int busy = write ? pthread_rwlock_trywrlock(&h_table->lock) 
+        : pthread_rwlock_tryrdlock(&h_table->lock);
+    if (busy) {
+        Py_BEGIN_ALLOW_THREADS
+        if (write) {
+            pthread_rwlock_wrlock(&h_table->lock);
+        } else {
+            pthread_rwlock_rdlock(&h_table->lock);
+        }
+        Py_END_ALLOW_THREADS
+    }
+}
+
+/*
+    A static function, unlocks the table, see `PyHashTable_lock`.
+    Nothing to returns.
+ */
+static void
+PyHashTable_unlock(PyHashTable *h_table)
+{
+    pthread_rwlock_unlock(&h_table->lock);
+}
+
+/*
+    A static function, gets a value by key under the lock of the table.
+    Returns a new reference to the value, or NULL if the key is not in the table.
+ */
+static PyObject *
+PyHashTable_lookup(PyHashTable *h_table, const char *key)
+{
+    PyHashTable_lock(h_table, 0);
+    void *p = tb_get_value(h_table->table, key);
+    PyObject *value = p ? get_pointer(PyObject *, p) : NULL;
+    Py_XINCREF(value);
+    PyHashTable_unlock(h_table);
+    return value;
+}
+
+/*
+    A static function, removes a value by key and releases the value.
+    The key is searched once, the table gives back the removed value.
+    Returns 1 if the key was in the table, otherwise 0.
+ */
+static int
+PyHashTable_remove(PyHashTable *h_table, const char *key)
+{
+    PyObject *value = NULL;
+    PyHashTable_lock(h_table, 1);
+    int del = tb_pop_item_n(h_table->table, key, strlen(key), &value);
+    PyHashTable_sync(h_table);
+    PyHashTable_unlock(h_table);
+    Py_XDECREF(value);
+    return del;
+}
+
+/*
+    A static function, sets a value by key.
+    If the key exists, replaces the value in place, without a new item.
+    The key is searched once, the table gives back the old value.
+    Returns 0 if success, otherwise -1.
+ */
+static int
+PyHashTable_set(PyHashTable *h_table, const char *key, PyObject *value)
+{
+    PyObject *old = NULL;
+    Py_INCREF(value);
+    PyHashTable_lock(h_table, 1);
+    tb_hash_table_item *item = tb_exchange_item_n(h_table->table, key, strlen(key), &value, &old);
+    PyHashTable_sync(h_table);
+    PyHashTable_unlock(h_table);
+    if (item == NULL) {
+        Py_DECREF(value);
+        PyErr_SetString(PyExc_RuntimeError, "The table is full.");
+        return -1;
+    }
+    Py_XDECREF(old);
+    return 0;
+}
+
 /*
     A static function, removes a hash table from memory.
+    Releases all the values of the table.
     Nothing to returns.
  */
 static void 
 PyHashTable_dealloc(PyHashTable *self) 
 {
-    tb_delete_hash_table(self->table);
+    if (self->table) {
+        uint32_t position = 0;
+        tb_hash_table_item *item;
+        while ((item = tb_next_item(self->table, &position)) != NULL) {
+            Py_XDECREF(get_pointer(PyObject *, item->val));
+        }
+        tb_delete_hash_table(self->table);
+    }
+    pthread_rwlock_destroy(&self->lock);
 #if PY_MAJOR_VERSION >=3
     self->ob_base.ob_type->tp_free((PyObject *)self);
 #else
@@ -83,18 +288,24 @@ PyHashTable_dealloc(PyHashTable *self)
 
 /*
     A static function, initializes a new hash table.
+    `Table(size, compact=False, seeded=False)`, `compact` selects 
+    the insertion-ordered compact layout, `seeded` selects the keyed hash 
+    with a random seed, for keys from untrusted clients.
     Returns 0 if success, otherwise -1.
  */
 static int
-PyHashTable_init(PyHashTable *hash_table, PyObject *args)
+PyHashTable_init(PyHashTable *hash_table, PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"size", "compact", "seeded", NULL};
     uint32_t size = 0;
-    if (!PyTuple_Size(args)) {
+    int compact = 0;
+    int seeded = 0;
+    if (!PyTuple_Size(args) && (!kwds || !PyDict_Size(kwds))) {
         PyErr_SetString(PyExc_TypeError, "__init__ missing 1 positional argument `size`.");
         PyErr_Print();
         return -1;
     }
-    if (!PyArg_ParseTuple(args, "i", &size)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|ii", kwlist, &size, &compact, &seeded)) {
         PyErr_SetString(PyExc_TypeError, "The size must be an integer.");
         PyErr_Print();
         return -1;
@@ -104,7 +315,9 @@ PyHashTable_init(PyHashTable *hash_table, PyObject *args)
         PyErr_Print();
         return -1;
     }
-    tb_hash_table *table = tb_create_hash_table((size_t)size);
+    tb_hash_table_options options = {0};
+    options.flags = (compact ? TB_COMPACT : 0) | (seeded ? TB_SEEDED : 0);
+    tb_hash_table *table = tb_create_hash_table_ex((size_t)size, &options);
     if (!table) {
         PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
         PyErr_Print();
@@ -117,128 +330,522 @@ PyHashTable_init(PyHashTable *hash_table, PyObject *args)
     return 0;
 }
 
+
 /*
     A static function, gets a value by key.
-    Creates a python object from this value and returns it.
+    Returns the value, or `None` if the key is not in the table.
  */
 static PyObject *
-PyHashTable_get(PyObject *self, PyObject *args)
+PyHashTable_get(PyObject *self, PyObject *arg)
 {
-    
-    char *key;
-    if (!PyArg_Parse(args, "s", &key)) {
-        PyErr_SetString(PyExc_TypeError, "The key must be a string.");
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
         return NULL;
     }
-    PyHashTable *h_table = (PyHashTable *)self;
-    if (h_table == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
-        PyErr_Print();
-        return NULL;
-    }
-    void *p = tb_get_value(h_table->table, key);
-    if (p == NULL) {
+    PyObject *value = PyHashTable_lookup((PyHashTable *)self, key);
+    if (value == NULL) {
         Py_RETURN_NONE;
     }
-    PyObject *value = get_pointer(PyObject *, p);
-    return Py_BuildValue("O", value);
+    return value;
 }
 
 /*
     A static function, inserts a value by key into the table.
-    Returns the position.
+    Returns `None`.
  */
 static PyObject *
-PyHashTable_insert(PyObject *self, PyObject *args)
+PyHashTable_insert(PyObject *self, FAST_ARGS)
 {
-    PyObject *value = NULL;
-    char *key;
-    if (!PyTuple_Size(args)) {
+    FAST_UNPACK
+    if (!nargs) {
         PyErr_SetString(PyExc_TypeError, 
                 "insert missing 2 positional arguments.");
-        PyErr_Print();
         return NULL;
-    } else if (PyTuple_Size(args) == 1) {
+    } else if (nargs == 1) {
         PyErr_SetString(PyExc_TypeError, 
                 "insert missing 1 positional argument `value`.");
-        PyErr_Print();
+        return NULL;
+    } else if (nargs > 2) {
+        PyErr_SetString(PyExc_TypeError, 
+                "insert takes 2 positional arguments.");
         return NULL;
     }
-    if (!PyArg_ParseTuple(args, "sO", &key, &value)) {
+    const char *key = PyHashTable_key(args[0]);
+    if (key == NULL) {
         PyErr_SetString(PyExc_TypeError, 
                 "The invalid parameters in the function. "
                 "The first parameter must be a string. "
                 "The second parameter must be an any object.");
         return NULL;
     }
-    PyHashTable *h_table = (PyHashTable *)self;
-    if (h_table == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
+    if (PyHashTable_set((PyHashTable *)self, key, args[1]) < 0) {
         return NULL;
     }
-    Py_INCREF(value);
+    Py_RETURN_NONE;
+}
+
+/*
+    A static function, removes a value by key.
+    Returns `True` if success, otherwise `False`.
+ */
+static PyObject *
+PyHashTable_delete(PyObject *self, PyObject *arg)
+{
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
+        return NULL;
+    }
+    return PyBool_FromLong(PyHashTable_remove((PyHashTable *)self, key));
+}
+
+/*
+    A static function, searches an element by key.
+    Returns a tuple in the format `(key, value)`.
+ */
+static PyObject *
+PyHashTable_find(PyObject *self, PyObject *arg)
+{
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
+        return NULL;
+    }
+    PyObject *value = PyHashTable_lookup((PyHashTable *)self, key);
     if (value == NULL) {
+        return Py_BuildValue("(s, O)", "", Py_None);
+    }
+    PyObject *result = PyTuple_Pack(2, arg, value);
+    Py_DECREF(value);
+    return result;
+}
+
+/*
+    A static function, gets the key strings of a bulk operation.
+    `seq` is a result of `PySequence_Fast`, it keeps the key objects alive.
+    Returns an array from `PyMem_Malloc`, or NULL on error.
+ */
+static const char **
+PyHashTable_bulk_keys(PyObject *seq)
+{
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    PyObject **objects = PySequence_Fast_ITEMS(seq);
+    const char **keys = PyMem_Malloc((count ? count : 1) * sizeof(char *));
+    if (keys == NULL) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        keys[i] = PyHashTable_key(objects[i]);
+        if (keys[i] == NULL) {
+            PyMem_Free(keys);
+            return NULL;
+        }
+    }
+    return keys;
+}
+
+/*
+    A static function, gets values by many keys.
+    The lookups run in C without the GIL.
+    Returns a list of values, `None` for missing keys.
+ */
+static PyObject *
+PyHashTable_get_many(PyObject *self, PyObject *arg)
+{
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyObject *seq = PySequence_Fast(arg, "The keys must be iterable.");
+    if (seq == NULL) {
+        return NULL;
+    }
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    const char **keys = PyHashTable_bulk_keys(seq);
+    void **values = keys ? PyMem_Malloc((count ? count : 1) * sizeof(void *)) : NULL;
+    PyObject *result = values ? PyList_New(count) : NULL;
+    if (result == NULL) {
+        if (keys && !values) {
+            PyErr_NoMemory();
+        }
+        PyMem_Free(keys);
+        PyMem_Free(values);
+        Py_DECREF(seq);
+        return NULL;
+    }
+    PyHashTable_lock(h_table, 0);
+    BULK_BEGIN(count)
+    tb_get_values(h_table->table, keys, (uint32_t)count, values);
+    // copy the objects out, the value storage can be freed after the unlock
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        values[i] = values[i] ? get_pointer(PyObject *, values[i]) : Py_None;
+    }
+    BULK_END
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        Py_INCREF((PyObject *)values[i]);
+    }
+    PyHashTable_unlock(h_table);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyList_SET_ITEM(result, i, (PyObject *)values[i]);
+    }
+    PyMem_Free(keys);
+    PyMem_Free(values);
+    Py_DECREF(seq);
+    return result;
+}
+
+/*
+    A static function, removes values by many keys.
+    The deletions run in C without the GIL, a key is found once.
+    Returns the number of removed items.
+ */
+static PyObject *
+PyHashTable_delete_many(PyObject *self, PyObject *arg)
+{
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyObject *seq = PySequence_Fast(arg, "The keys must be iterable.");
+    if (seq == NULL) {
+        return NULL;
+    }
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    const char **keys = PyHashTable_bulk_keys(seq);
+    PyObject **values = keys ? PyMem_Malloc((count ? count : 1) * sizeof(PyObject *)) : NULL;
+    if (values == NULL) {
+        if (keys) {
+            PyErr_NoMemory();
+        }
+        PyMem_Free(keys);
+        Py_DECREF(seq);
+        return NULL;
+    }
+    uint32_t removed = 0;
+    PyHashTable_lock(h_table, 1);
+    BULK_BEGIN(count)
+    // the popped objects are released after the GIL is taken back
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        values[i] = NULL;
+        removed += tb_pop_item_n(h_table->table, keys[i], strlen(keys[i]), &values[i]);
+    }
+    BULK_END
+    PyHashTable_sync(h_table);
+    PyHashTable_unlock(h_table);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        Py_XDECREF(values[i]);
+    }
+    PyMem_Free(keys);
+    PyMem_Free(values);
+    Py_DECREF(seq);
+    return PyLong_FromUnsignedLong(removed);
+}
+
+/*
+    A static function, inserts all the pairs from a mapping or
+    an iterable of `(key, value)` pairs, as `dict.update` does.
+    The insertions run in C without the GIL.
+    Returns `None`.
+ */
+static PyObject *
+PyHashTable_update(PyObject *self, PyObject *arg)
+{
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyObject *pairs = NULL;
+    if (PyDict_Check(arg)) {
+        pairs = PyDict_Items(arg);
+    } else if (PyObject_HasAttrString(arg, "keys")) {
+        pairs = PyMapping_Items(arg);
+    } else {
+        pairs = PySequence_Fast(arg, "The argument must be a mapping or an iterable of pairs.");
+    }
+    if (pairs == NULL) {
+        return NULL;
+    }
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(pairs);
+    PyObject **objects = PySequence_Fast_ITEMS(pairs);
+    const char **keys = PyMem_Malloc((count ? count : 1) * sizeof(char *));
+    PyObject **key_objects = PyMem_Malloc((count ? count : 1) * sizeof(PyObject *));
+    PyObject **values = PyMem_Malloc((count ? count : 1) * sizeof(PyObject *));
+    PyObject **old = PyMem_Malloc((count ? count : 1) * sizeof(PyObject *));
+    Py_ssize_t ready = 0;
+    if (!keys || !key_objects || !values || !old) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (; ready < count; ++ready) {
+        PyObject *pair = PySequence_Fast(objects[ready], "The element must be a pair.");
+        if (pair == NULL) {
+            goto error;
+        }
+        if (PySequence_Fast_GET_SIZE(pair) != 2) {
+            PyErr_SetString(PyExc_ValueError, "The element must be a pair `(key, value)`.");
+            Py_DECREF(pair);
+            goto error;
+        }
+        key_objects[ready] = PySequence_Fast_GET_ITEM(pair, 0);
+        values[ready] = PySequence_Fast_GET_ITEM(pair, 1);
+        keys[ready] = PyHashTable_key(key_objects[ready]);
+        if (keys[ready] == NULL) {
+            Py_DECREF(pair);
+            goto error;
+        }
+        Py_INCREF(key_objects[ready]);
+        Py_INCREF(values[ready]);
+        Py_DECREF(pair);
+    }
+    Py_ssize_t inserted = 0;
+    PyHashTable_lock(h_table, 1);
+    BULK_BEGIN(count)
+    for (; inserted < count; ++inserted) {
+        old[inserted] = NULL;
+        if (tb_exchange_item_n(h_table->table, keys[inserted], strlen(keys[inserted]), 
+                &values[inserted], &old[inserted]) == NULL) {
+            break;
+        }
+    }
+    BULK_END
+    PyHashTable_sync(h_table);
+    PyHashTable_unlock(h_table);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        if (i < inserted) {
+            Py_XDECREF(old[i]);
+        } else {
+            Py_DECREF(values[i]);
+        }
+        Py_DECREF(key_objects[i]);
+    }
+    PyMem_Free(keys);
+    PyMem_Free(key_objects);
+    PyMem_Free(values);
+    PyMem_Free(old);
+    Py_DECREF(pairs);
+    if (inserted < count) {
+        PyErr_SetString(PyExc_RuntimeError, "The table is full.");
         return NULL;
     }
-    tb_insert_item(h_table->table, key, &value);
-    h_table->count = h_table->table->count;
-    h_table->empty = h_table->table->empty;
     Py_RETURN_NONE;
+
+error:
+    for (Py_ssize_t i = 0; i < ready; ++i) {
+        Py_DECREF(key_objects[i]);
+        Py_DECREF(values[i]);
+    }
+    PyMem_Free(keys);
+    PyMem_Free(key_objects);
+    PyMem_Free(values);
+    PyMem_Free(old);
+    Py_DECREF(pairs);
+    return NULL;
 }
 
 /*
-    A static function, removes a value by key.
-    Returns `True` if success, otherwise `False`.
+    A static function, creates a copy of the hash table.
+    The C slot array and the keys are cloned directly, nothing is reinserted.
+    Returns the new table.
  */
 static PyObject *
-PyHashTable_delete(PyObject *self, PyObject *args)
+PyHashTable_copy(PyObject *self)
 {
-    char *key;
-    if (!PyArg_Parse(args, "s", &key)) {
-        PyErr_SetString(PyExc_TypeError, "The key must be a string.");
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyHashTable *copy = (PyHashTable *)PyHashTable_new(Py_TYPE(self), NULL);
+    if (copy == NULL) {
         return NULL;
     }
+    PyHashTable_lock(h_table, 0);
+    copy->table = tb_copy_hash_table(h_table->table);
+    if (copy->table != NULL) {
+        uint32_t position = 0;
+        tb_hash_table_item *item;
+        while ((item = tb_next_item(copy->table, &position)) != NULL) {
+            Py_XINCREF(get_pointer(PyObject *, item->val));
+        }
+    }
+    PyHashTable_unlock(h_table);
+    if (copy->table == NULL) {
+        Py_DECREF(copy);
+        return PyErr_NoMemory();
+    }
+    copy->size = h_table->size;
+    PyHashTable_sync(copy);
+    return (PyObject *)copy;
+}
+
+/*
+    A static function, the pickle support.
+    The state is a tuple `(keys, values)`, where `keys` is one bytes blob
+    of all the keys, each one ends with NUL, and `values` is a list
+    of values in the same order.
+    The seed is not pickled, the restored table gets a new one.
+    The values are collected under the lock, the list is created after it,
+    the list can start the garbage collector.
+    Returns a tuple `(Table, (size, compact, seeded), state)`.
+ */
+static PyObject *
+PyHashTable_reduce(PyObject *self)
+{
     PyHashTable *h_table = (PyHashTable *)self;
-    if (h_table == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
+    tb_hash_table *table = h_table->table;
+    PyHashTable_lock(h_table, 0);
+    size_t length = 0;
+    uint32_t position = 0;
+    tb_hash_table_item *item;
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        length += strlen(item->key) + 1;
+    }
+    Py_ssize_t count = (Py_ssize_t)table->count;
+    PyObject *keys = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)length);
+    PyObject **objects = keys ? PyMem_Malloc((count ? count : 1) * sizeof(PyObject *)) : NULL;
+    if (objects == NULL) {
+        PyHashTable_unlock(h_table);
+        Py_XDECREF(keys);
+        return keys ? PyErr_NoMemory() : NULL;
+    }
+    char *blob = PyBytes_AS_STRING(keys);
+    Py_ssize_t i = 0;
+    position = 0;
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        size_t key_length = strlen(item->key) + 1;
+        memcpy(blob, item->key, key_length);
+        blob += key_length;
+        objects[i] = get_pointer(PyObject *, item->val);
+        Py_INCREF(objects[i++]);
+    }
+    PyHashTable_unlock(h_table);
+    PyObject *values = PyList_New(count);
+    for (i = 0; i < count; ++i) {
+        if (values != NULL) {
+            PyList_SET_ITEM(values, i, objects[i]);
+        } else {
+            Py_DECREF(objects[i]);
+        }
+    }
+    PyMem_Free(objects);
+    if (values == NULL) {
+        Py_DECREF(keys);
         return NULL;
     }
-    int del = tb_delete_item(h_table->table, key);
-    
-    h_table->count = h_table->table->count;
-    h_table->empty = h_table->table->empty;
-    return Py_BuildValue("N", PyBool_FromLong(del));
+    return Py_BuildValue("O(Iii)(NN)", (PyObject *)Py_TYPE(self), h_table->size, 
+            (table->flags & TB_COMPACT) != 0, (table->flags & TB_SEEDED) != 0, keys, values);
 }
 
 /*
-    A static function, searches an element by key.
-    Returns a tuple in the format `(key, value)`.
+    A static function, restores the state from `__reduce__`.
+    Returns `None`.
  */
 static PyObject *
-PyHashTable_find(PyObject *self, PyObject *args)
+PyHashTable_setstate(PyObject *self, PyObject *state)
 {
-   char *key;
-    if (!PyArg_Parse(args, "s", &key)) {
-        PyErr_SetString(PyExc_TypeError, "The key must be a string.");
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyObject *keys = NULL;
+    PyObject *values = NULL;
+    if (!PyArg_ParseTuple(state, "SO!", &keys, &PyList_Type, &values)) {
         return NULL;
-    } 
+    }
+    const char *blob = PyBytes_AS_STRING(keys);
+    const char *end = blob + PyBytes_GET_SIZE(keys);
+    Py_ssize_t count = PyList_GET_SIZE(values);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        const char *key_end = blob < end ? memchr(blob, '\0', (size_t)(end - blob)) : NULL;
+        if (key_end == NULL) {
+            PyErr_SetString(PyExc_ValueError, "The state of the table is broken.");
+            return NULL;
+        }
+        if (PyHashTable_set(h_table, blob, PyList_GET_ITEM(values, i)) < 0) {
+            return NULL;
+        }
+        blob = key_end + 1;
+    }
+    Py_RETURN_NONE;
+}
+
+/*
+    A static function, the `len(table)` operator.
+    Returns the count of elements.
+ */
+static Py_ssize_t
+PyHashTable_length(PyObject *self)
+{
     PyHashTable *h_table = (PyHashTable *)self;
-    if (!h_table) {
-        PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
+    PyHashTable_lock(h_table, 0);
+    Py_ssize_t count = (Py_ssize_t)h_table->table->count;
+    PyHashTable_unlock(h_table);
+    return count;
+}
+
+/*
+    A static function, the `table[key]` operator.
+    Returns the value, raises `KeyError` if the key is not in the table.
+ */
+static PyObject *
+PyHashTable_subscript(PyObject *self, PyObject *arg)
+{
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
         return NULL;
     }
-    tb_hash_table_item *item = tb_find_item(h_table->table, key);
-    if (item == NULL) {
-        return Py_BuildValue("(s, O)", "", Py_None);
+    PyObject *value = PyHashTable_lookup((PyHashTable *)self, key);
+    if (value == NULL) {
+        PyErr_SetObject(PyExc_KeyError, arg);
+    }
+    return value;
+}
+
+/*
+    A static function, the `table[key] = value` and `del table[key]` operators.
+    Returns 0 if success, otherwise -1.
+ */
+static int
+PyHashTable_ass_subscript(PyObject *self, PyObject *arg, PyObject *value)
+{
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
+        return -1;
+    }
+    if (value == NULL) {
+        if (!PyHashTable_remove((PyHashTable *)self, key)) {
+            PyErr_SetObject(PyExc_KeyError, arg);
+            return -1;
+        }
+        return 0;
     }
-    void *p = item->val;
-    if (p == NULL) {
-        return Py_BuildValue("(s, O)", key, Py_None);
+    return PyHashTable_set((PyHashTable *)self, key, value);
+}
+
+/*
+    A static function, the `key in table` operator.
+    Returns 1 if the key is in the table, 0 if not, -1 on error.
+ */
+static int
+PyHashTable_contains(PyObject *self, PyObject *arg)
+{
+    const char *key = PyHashTable_key(arg);
+    if (key == NULL) {
+        return -1;
     }
-    PyObject *value = get_pointer(PyObject *, p);
-    return Py_BuildValue("(s, O)", key, value);
+    PyHashTable *h_table = (PyHashTable *)self;
+    PyHashTable_lock(h_table, 0);
+    int found = tb_get_value(h_table->table, key) != NULL;
+    PyHashTable_unlock(h_table);
+    return found;
 }
 
+/*
+    The mapping protocol of the hash table.
+ */
+static PyMappingMethods PyHashTable_as_mapping = {
+    (lenfunc)PyHashTable_length,                        /* mp_length */
+    (binaryfunc)PyHashTable_subscript,                  /* mp_subscript */
+    (objobjargproc)PyHashTable_ass_subscript            /* mp_ass_subscript */
+};
+
+/*
+    The sequence protocol of the hash table, only for `in` operator.
+ */
+static PySequenceMethods PyHashTable_as_sequence = {
+    (lenfunc)PyHashTable_length,                        /* sq_length */
+    (binaryfunc)0,                                      /* sq_concat */
+    (ssizeargfunc)0,                                    /* sq_repeat */
+    (ssizeargfunc)0,                                    /* sq_item */
+    0,                                                  /* was_sq_slice */
+    (ssizeobjargproc)0,                                 /* sq_ass_item */
+    0,                                                  /* was_sq_ass_slice */
+    (objobjproc)PyHashTable_contains                    /* sq_contains */
+};
+
 /*
     A static function, creates pointer to the iterator.
  */
@@ -249,38 +856,66 @@ PyHashTableItems_iter(PyObject *self)
     return self;
 }
 
+/*
+    A static function, removes the iterator from memory.
+    Releases the hash table.
+ */
+static void
+PyHashTableItems_dealloc(PyHashTableItems *self)
+{
+    Py_XDECREF(self->owner);
+    PyObject_Del(self);
+}
+
 /*
     A static function, returns a next element from iterator.
+    The element depends on the kind of the iterator.
  */
 static PyObject *
 PyHashTableItems_iternext(PyObject *self)
 {
     PyHashTableItems *iter = (PyHashTableItems *)self;
-    PyObject *value = NULL;
     if (iter == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
         return NULL;
     }
-    // get an element from the index
-    // if an element is deleted, increase the index and check again
-    while (iter->index < iter->size && iter->index >= 0) {
-        if (iter->items[iter->index] != NULL 
-                && iter->items[iter->index]->key != NULL
-                && iter->items[iter->index]->val != NULL) {
-            void *p = iter->items[iter->index]->val;
-            if (p == NULL) {
-                return Py_BuildValue("(s, O)", iter->items[iter->index]->key, Py_None);
-            }       
-            value = get_pointer(PyObject *, p);
-            PyObject *obj = Py_BuildValue("sO", iter->items[iter->index]->key, value);
-            iter->index++;
-            return obj;
-        } else {
-            iter->index++;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    // the key is copied under the lock, strings do not start the garbage collector
+    PyHashTable_lock(iter->owner, 0);
+    // get the next element, deleted elements are skipped
+    tb_hash_table_item *item = tb_next_item(iter->owner->table, &iter->index);
+    int found = item != NULL && item->val != NULL;
+    if (found) {
+        if (iter->kind != VALUES) {
+#if PY_MAJOR_VERSION >= 3
+            key = PyUnicode_FromString(item->key);
+#else
+            key = PyString_FromString(item->key);
+#endif
+        }
+        if (iter->kind != KEYS) {
+            value = get_pointer(PyObject *, item->val);
+            Py_INCREF(value);
         }
     }
-    PyErr_SetNone(PyExc_StopIteration);
-    return NULL;
+    PyHashTable_unlock(iter->owner);
+    if (!found) {
+        PyErr_SetNone(PyExc_StopIteration);
+        return NULL;
+    }
+    switch (iter->kind) {
+    case KEYS:
+        return key;
+    case VALUES:
+        return value;
+    default:
+        if (key == NULL) {
+            Py_DECREF(value);
+            return NULL;
+        }
+        return Py_BuildValue("(NN)", key, value);
+    }
 }
 
 /*
@@ -291,7 +926,7 @@ static PyTypeObject PyHashTableItems_type = {
     "_iter()",                                          /* tp_name */
     sizeof(PyHashTableItems),                           /* tp_basicsize */
     0,                                                  /*  itemsize */
-    (destructor)0,                                      /* tp_dealloc */
+    (destructor)PyHashTableItems_dealloc,               /* tp_dealloc */
     (printfunc)0,                                       /* tp_print */
     (getattrfunc)0,                                     /* tp_getattr */
     (setattrfunc)0,                                     /* tp_setattr */
@@ -341,6 +976,27 @@ static PyTypeObject PyHashTableItems_type = {
     (destructor)0                                       /* tp_del */
 };
 
+
+/*
+    A static function, creates a new iterator of the hash table.
+    `kind` is ITEMS, KEYS or VALUES.
+    Returns the iteterator if success, otherwise `NULL`.
+ */
+static PyObject *
+PyHashTableItems_new(PyHashTable *h_table, int kind)
+{
+    PyHashTableItems *iter = PyObject_New(PyHashTableItems, &PyHashTableItems_type);
+    if (iter == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "The pointer on the iterator is NULL.");
+        return NULL;
+    }
+    Py_INCREF(h_table);
+    iter->owner = h_table;
+    iter->index = 0;
+    iter->kind = kind;
+    return (PyObject *)iter;
+}
+
 /*
     A static function, initializes a new iterator of the hash table.
     Returns the iteterator if success, otherwise `NULL`.
@@ -353,15 +1009,188 @@ PyHashTableItems_iter_init(PyObject *self)
         PyErr_SetString(PyExc_RuntimeError, "The pointer on the hashtable is NULL.");
         return NULL;
     }
-    PyHashTableItems *iter = PyObject_New(PyHashTableItems, &PyHashTableItems_type);
-    if (iter == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "The pointer on the iterator is NULL.");
+    return PyHashTableItems_new(h_table, ITEMS);
+}
+
+/*
+    A static function, the `iter(table)` operator.
+    Returns the iterator of all the keys, as `dict` does.
+ */
+static PyObject *
+PyHashTable_iter(PyObject *self)
+{
+    return PyHashTableItems_new((PyHashTable *)self, KEYS);
+}
+
+/*
+    A static function, removes the view from memory.
+    Releases the hash table.
+ */
+static void
+PyHashTableView_dealloc(PyHashTableView *self)
+{
+    Py_XDECREF(self->owner);
+    PyObject_Del(self);
+}
+
+/*
+    A static function, the `len(view)` operator.
+    Returns the count of elements in the hash table.
+ */
+static Py_ssize_t
+PyHashTableView_length(PyObject *self)
+{
+    return PyHashTable_length((PyObject *)((PyHashTableView *)self)->owner);
+}
+
+/*
+    A static function, the `iter(view)` operator.
+    Returns the iterator of keys or values.
+ */
+static PyObject *
+PyHashTableView_iter(PyObject *self)
+{
+    PyHashTableView *view = (PyHashTableView *)self;
+    return PyHashTableItems_new(view->owner, view->kind);
+}
+
+/*
+    A static function, the `x in view` operator.
+    For keys it is one lookup, for values it is a scan of the table.
+    Returns 1 if found, 0 if not, -1 on error.
+ */
+static int
+PyHashTableView_contains(PyObject *self, PyObject *arg)
+{
+    PyHashTableView *view = (PyHashTableView *)self;
+    if (view->kind == KEYS) {
+        return PyHashTable_contains((PyObject *)view->owner, arg);
+    }
+    uint32_t position = 0;
+    for (;;) {
+        // the comparison runs Python code, so it is out of the lock
+        PyHashTable_lock(view->owner, 0);
+        tb_hash_table_item *item = tb_next_item(view->owner->table, &position);
+        PyObject *value = item ? get_pointer(PyObject *, item->val) : NULL;
+        Py_XINCREF(value);
+        PyHashTable_unlock(view->owner);
+        if (value == NULL) {
+            return 0;
+        }
+        int cmp = PyObject_RichCompareBool(value, arg, Py_EQ);
+        Py_DECREF(value);
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+}
+
+/*
+    The sequence protocol of the view.
+ */
+static PySequenceMethods PyHashTableView_as_sequence = {
+    (lenfunc)PyHashTableView_length,                    /* sq_length */
+    (binaryfunc)0,                                      /* sq_concat */
+    (ssizeargfunc)0,                                    /* sq_repeat */
+    (ssizeargfunc)0,                                    /* sq_item */
+    0,                                                  /* was_sq_slice */
+    (ssizeobjargproc)0,                                 /* sq_ass_item */
+    0,                                                  /* was_sq_ass_slice */
+    (objobjproc)PyHashTableView_contains                /* sq_contains */
+};
+
+/*
+    The full definition of the view object of the hash table.
+ */
+static PyTypeObject PyHashTableView_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "hashtable.View",                                   /* tp_name */
+    sizeof(PyHashTableView),                            /* tp_basicsize */
+    0,                                                  /*  itemsize */
+    (destructor)PyHashTableView_dealloc,                /* tp_dealloc */
+    (printfunc)0,                                       /* tp_print */
+    (getattrfunc)0,                                     /* tp_getattr */
+    (setattrfunc)0,                                     /* tp_setattr */
+#if PY_VERSION_HEX >= 0x03050000
+    (PyAsyncMethods *)0,                                /* tp_as_async */
+#elif PY_VERSION_HEX >= 0x03000000
+    (void *)0,                                          /* tp_reserved */
+#else
+    0,                                                  /* tp_compare */
+#endif
+    (reprfunc)0,                                        /* tp_repr */
+    (PyNumberMethods *)0,                               /* tp_as_number */
+    &PyHashTableView_as_sequence,                       /* tp_as_sequence */
+    (PyMappingMethods *)0,                              /* tp_as_mapping */
+    (hashfunc)0,                                        /* tp_hash */
+    (ternaryfunc)0,                                     /* tp_call */
+    (reprfunc)0,                                        /* tp_str */
+    (getattrofunc)0,                                    /* tp_getattro */
+    (setattrofunc)0,                                    /* tp_setattro */
+    (PyBufferProcs *)0,                                 /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                                 /* tp_flags */
+    0,                                                  /* tp_doc */
+    (traverseproc)0,                                    /* tp_traverse */
+    (inquiry)0,                                         /* tp_clear */
+    (richcmpfunc)0,                                     /* tp_richcompare */
+    0,                                                  /* tp_weaklistoffset */
+    (getiterfunc)PyHashTableView_iter,                  /* tp_iter */
+    (iternextfunc)0,                                    /* tp_iternext */
+    (struct PyMethodDef *)0,                            /* tp_methods */
+    (struct PyMemberDef *)0,                            /* tp_members */
+    0,                                                  /* tp_getset */
+    0,                                                  /* tp_base */
+    0,                                                  /* tp_dict */
+    (descrgetfunc)0,                                    /* tp_descr_get */
+    (descrsetfunc)0,                                    /* tp_descr_set */
+    0,                                                  /* tp_dictoffset */
+    (initproc)0,                                        /* tp_init */
+    0,                                                  /* tp_alloc */
+    (newfunc)0,                                         /* tp_new */
+    (freefunc)0,                                        /* tp_free */
+    (inquiry)0,                                         /* tb_is_gc */
+    0,                                                  /* tp_bases */
+    0,                                                  /* tp_mro */
+    0,                                                  /* tp_cache */
+    0,                                                  /* tp_subclasses */
+    0,                                                  /* tp_weaklist */
+    (destructor)0                                       /* tp_del */
+};
+
+/*
+    A static function, creates a new view of the hash table.
+    `kind` is KEYS or VALUES.
+    Returns the view if success, otherwise `NULL`.
+ */
+static PyObject *
+PyHashTableView_new(PyHashTable *h_table, int kind)
+{
+    PyHashTableView *view = PyObject_New(PyHashTableView, &PyHashTableView_type);
+    if (view == NULL) {
         return NULL;
     }
-    iter->items = h_table->table->items;
-    iter->index = 0;
-    iter->size = h_table->table->size;
-    return (PyObject *)iter;
+    Py_INCREF(h_table);
+    view->owner = h_table;
+    view->kind = kind;
+    return (PyObject *)view;
+}
+
+/*
+    A static function, returns a view of all the keys.
+ */
+static PyObject *
+PyHashTable_keys(PyObject *self)
+{
+    return PyHashTableView_new((PyHashTable *)self, KEYS);
+}
+
+/*
+    A static function, returns a view of all the values.
+ */
+static PyObject *
+PyHashTable_values(PyObject *self)
+{
+    return PyHashTableView_new((PyHashTable *)self, VALUES);
 }
 
 /*
@@ -391,7 +1220,8 @@ static PyMemberDef PyHashTable_members[] = {
         offsetof(PyHashTable, count),
         READONLY,
         "The count of elements in the table."
-    }
+    },
+    {NULL}
 };
 
 /*
@@ -402,6 +1232,12 @@ static PyMemberDef PyHashTable_members[] = {
     `find` - searches an element by key in the hash table.
     `at` - returns an element in this position.
     `items` - returns the iterator of all the elements in the hash table.
+    `keys` - returns the view of all the keys in the hash table.
+    `values` - returns the view of all the values in the hash table.
+    `get_many` - gets values by many keys.
+    `update` - inserts all the pairs from a mapping or an iterable.
+    `delete_many` - removes values by many keys.
+    `copy` - returns a copy of the hash table.
  */
 static PyMethodDef PyHashTable_methods[] = {
     {
@@ -412,8 +1248,8 @@ static PyMethodDef PyHashTable_methods[] = {
     },
     {
         "insert",
-        (PyCFunction)PyHashTable_insert,
-        METH_VARARGS,
+        (PyCFunction)(void(*)(void))PyHashTable_insert,
+        METH_FAST,
         "Inserts a value by key into the table."
     },
     {
@@ -436,6 +1272,63 @@ static PyMethodDef PyHashTable_methods[] = {
         METH_NOARGS,
         "Returns the iterator of all elements.",
     },
+    {
+        "keys",
+        (PyCFunction)PyHashTable_keys,
+        METH_NOARGS,
+        "Returns the view of all keys.",
+    },
+    {
+        "values",
+        (PyCFunction)PyHashTable_values,
+        METH_NOARGS,
+        "Returns the view of all values.",
+    },
+    {
+        "get_many",
+        (PyCFunction)PyHashTable_get_many,
+        METH_O,
+        "Returns a list of values by keys, `None` for missing keys. "
+        "Big batches run without the GIL.",
+    },
+    {
+        "update",
+        (PyCFunction)PyHashTable_update,
+        METH_O,
+        "Inserts all pairs from a mapping or an iterable of `(key, value)`. "
+        "Big batches run without the GIL.",
+    },
+    {
+        "delete_many",
+        (PyCFunction)PyHashTable_delete_many,
+        METH_O,
+        "Deletes values by keys. Returns the number of deleted items. "
+        "Big batches run without the GIL.",
+    },
+    {
+        "copy",
+        (PyCFunction)PyHashTable_copy,
+        METH_NOARGS,
+        "Returns a shallow copy of the table.",
+    },
+    {
+        "__copy__",
+        (PyCFunction)PyHashTable_copy,
+        METH_NOARGS,
+        "Returns a shallow copy of the table.",
+    },
+    {
+        "__reduce__",
+        (PyCFunction)PyHashTable_reduce,
+        METH_NOARGS,
+        "The pickle support.",
+    },
+    {
+        "__setstate__",
+        (PyCFunction)PyHashTable_setstate,
+        METH_O,
+        "The pickle support.",
+    },
     {NULL}
 };
 
@@ -460,8 +1353,8 @@ static PyTypeObject PyHashTable_type = {
 #endif
     (reprfunc)0,                                        /* tp_repr */
     (PyNumberMethods *)0,                               /* tp_as_number */
-    (PySequenceMethods *)0,                             /* tp_as_sequence */
-    (PyMappingMethods *)0,                              /* tp_as_mapping */
+    &PyHashTable_as_sequence,                           /* tp_as_sequence */
+    &PyHashTable_as_mapping,                            /* tp_as_mapping */
     (hashfunc)0,                                        /* tp_hash */
     (ternaryfunc)0,                                     /* tp_call */
     (reprfunc)0,                                        /* tp_str */
@@ -474,7 +1367,7 @@ static PyTypeObject PyHashTable_type = {
     (inquiry)0,                                         /* tp_clear */
     (richcmpfunc)0,                                     /* tp_richcompare */
     0,                                                  /* tp_weaklistoffset */
-    (getiterfunc)0,                                     /* tp_iter */
+    (getiterfunc)PyHashTable_iter,                      /* tp_iter */
     (iternextfunc)0,                                    /* tp_iternext */
     (struct PyMethodDef *)PyHashTable_methods,          /* tp_methods */
     (struct PyMemberDef *)PyHashTable_members,          /* tp_members */
@@ -548,6 +1441,14 @@ PyMODINIT_FUNC inithashtable(void)
     if (PyModule_AddObject(m, "Iterator", iterator) < 0) {
         INIT_ERROR;
     };
+    // Init view
+    if (PyType_Ready(&PyHashTableView_type) < 0) {
+        INIT_ERROR;
+    }
+    Py_INCREF(&PyHashTableView_type);
+    if (PyModule_AddObject(m, "View", (PyObject *)&PyHashTableView_type) < 0) {
+        INIT_ERROR;
+    };
     // Init hashtable class
     if (PyType_Ready(&PyHashTable_type) > 0) {
         INIT_ERROR;
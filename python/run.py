@@ -1,3 +1,6 @@
+import copy
+import pickle
+import threading
 import unittest
 from hashtable import Table
 
@@ -204,6 +207,228 @@ class TestsHashTable(unittest.TestCase):
 
         del table
 
+    def test_nine(self):
+        table = Table(5000)
+        self.assertEqual(len(table), 0)
+
+        for n in range(1, 5000 + 1):
+            table["key_" + str(n)] = n
+
+        self.assertEqual(len(table), 5000)
+        self.assertEqual(table.count, 5000)
+        self.assertFalse(table.empty)
+        self.assertEqual(table["key_42"], 42)
+        self.assertIn("key_42", table)
+        self.assertNotIn("key_0", table)
+
+        table["key_42"] = "replaced"
+        self.assertEqual(table["key_42"], "replaced")
+        self.assertEqual(len(table), 5000)
+
+        del table["key_42"]
+        self.assertNotIn("key_42", table)
+        self.assertEqual(len(table), 4999)
+
+        with self.assertRaises(KeyError):
+            table["key_42"]
+        with self.assertRaises(KeyError):
+            del table["key_42"]
+        with self.assertRaises(TypeError):
+            table[1] = 1
+        with self.assertRaises(TypeError):
+            1 in table
+
+        del table
+
+    def test_ten(self):
+        table = Table(5000)
+
+        for n in range(1, 5000 + 1):
+            table.insert("key_" + str(n), n)
+
+        keys = table.keys()
+        values = table.values()
+        self.assertEqual(len(keys), 5000)
+        self.assertEqual(len(values), 5000)
+        self.assertEqual(set(keys), set("key_" + str(n) for n in range(1, 5000 + 1)))
+        self.assertEqual(sorted(values), list(range(1, 5000 + 1)))
+        self.assertEqual(set(table), set(keys))
+        self.assertIn("key_1", keys)
+        self.assertIn(1, values)
+        self.assertNotIn(0, values)
+
+        # the views are live
+        table.delete("key_1")
+        self.assertEqual(len(keys), 4999)
+        self.assertNotIn("key_1", keys)
+
+        del table
+        self.assertEqual(len(list(keys)), 4999)
+
+    def test_eleven(self):
+        table = Table(5000)
+
+        table.update(("key_" + str(n), n) for n in range(1, 2500 + 1))
+        table.update({"key_" + str(n): n for n in range(2501, 5000 + 1)})
+        self.assertEqual(table.count, 5000)
+
+        values = table.get_many(["key_" + str(n) for n in range(0, 5000 + 1)])
+        self.assertEqual(values, [None] + list(range(1, 5000 + 1)))
+
+        table.update([("key_1", "one"), ["key_2", "two"]])
+        self.assertEqual(table.get_many(("key_1", "key_2")), ["one", "two"])
+        self.assertEqual(table.count, 5000)
+
+        removed = table.delete_many(["key_" + str(n) for n in range(1, 1000 + 1)] + ["key_1", "nothing"])
+        self.assertEqual(removed, 1000)
+        self.assertEqual(table.count, 4000)
+        self.assertEqual(table.get_many(["key_1", "key_1001"]), [None, 1001])
+
+        other = Table(100)
+        other.update(table.get_many(["nothing"]) and {"key_1001": 1001})
+        self.assertEqual(other["key_1001"], 1001)
+        self.assertEqual(other.count, 1)
+
+        with self.assertRaises(TypeError):
+            table.get_many([1, 2])
+        with self.assertRaises(ValueError):
+            table.update([("key",)])
+        self.assertEqual(table.count, 4000)
+
+        del table
+
+    def test_twelve(self):
+        table = Table(5000)
+
+        for n in range(1, 5000 + 1):
+            table.insert("key_" + str(n), [n])
+        for n in range(1, 100 + 1):
+            table.delete("key_" + str(n))
+
+        for other in (table.copy(), copy.copy(table)):
+            self.assertEqual(other.size, table.size)
+            self.assertEqual(other.count, 4900)
+            self.assertEqual(sorted(other.items()), sorted(table.items()))
+            self.assertIs(other["key_101"], table["key_101"])
+            other["key_101"] = None
+            self.assertEqual(table["key_101"], [101])
+
+        for protocol in range(pickle.HIGHEST_PROTOCOL + 1):
+            other = pickle.loads(pickle.dumps(table, protocol))
+            self.assertEqual(other.size, table.size)
+            self.assertEqual(other.count, 4900)
+            self.assertEqual(sorted(other.items()), sorted(table.items()))
+            self.assertNotIn("key_1", other)
+
+        empty = pickle.loads(pickle.dumps(Table(10)))
+        self.assertEqual(empty.count, 0)
+        self.assertTrue(empty.empty)
+
+        del table
+
+    def test_thirteen(self):
+        table = Table(5000, compact=True)
+        self.assertEqual(table.size, 5000)
+        self.assertTrue(table.empty)
+
+        for n in range(1, 5000 + 1):
+            table["key_" + str(n)] = n
+        for n in range(1, 1000 + 1):
+            del table["key_" + str(n)]
+        for n in range(1, 500 + 1):
+            table["new_" + str(n)] = n
+
+        # the compact table keeps insertion order
+        expected = ["key_" + str(n) for n in range(1001, 5000 + 1)]
+        expected += ["new_" + str(n) for n in range(1, 500 + 1)]
+        self.assertEqual(list(table.keys()), expected)
+        self.assertEqual([key for key, value in table.items()], expected)
+        self.assertEqual(table.get_many(["key_1", "key_1001"]), [None, 1001])
+
+        other = pickle.loads(pickle.dumps(table))
+        self.assertEqual(list(other.keys()), expected)
+        other = table.copy()
+        self.assertEqual(list(other.values()), list(table.values()))
+
+        del table
+
+    def test_fourteen(self):
+        table = Table(5000, seeded=True)
+        other = Table(5000, seeded=True)
+        for n in range(1, 5000 + 1):
+            table["key_" + str(n)] = n
+            other["key_" + str(n)] = n
+        self.assertEqual(len(table), 5000)
+        self.assertEqual(table["key_4999"], 4999)
+        self.assertFalse("key_0" in table)
+        del table["key_1"]
+        self.assertEqual(table.get("key_1"), None)
+
+        # the random seeds give different slot orders
+        keys = list(table.keys())
+        self.assertNotEqual(keys, [key for key in other.keys() if key != "key_1"])
+        self.assertEqual(sorted(keys), sorted(key for key in other.keys() if key != "key_1"))
+
+        restored = pickle.loads(pickle.dumps(table))
+        self.assertEqual(sorted(restored.keys()), sorted(table.keys()))
+        self.assertEqual(restored["key_2"], 2)
+
+        del table
+        del other
+
+    def test_fifteen(self):
+        table = Table(20000)
+        keys = ["bulk_" + str(n) for n in range(5000)]
+        errors = []
+
+        # bulk operations run without the GIL, other threads wait for them
+        def bulk():
+            try:
+                for _ in range(20):
+                    table.update((key, 1) for key in keys)
+                    self.assertEqual(table.get_many(keys), [1] * len(keys))
+                    table.delete_many(keys)
+            except Exception as e:
+                errors.append(e)
+
+        thread = threading.Thread(target=bulk)
+        thread.start()
+        n = 0
+        while thread.is_alive():
+            key = "key_" + str(n % 1000)
+            table[key] = n
+            self.assertEqual(table[key], n)
+            self.assertEqual(table.get(key), n)
+            self.assertTrue(key in table)
+            self.assertTrue(len(table) > 0)
+            for item in table.items():
+                pass
+            del table[key]
+            n += 1
+        thread.join()
+        self.assertEqual(errors, [])
+        self.assertEqual(table.count, 0)
+
+        del table
+
+    def test_sixteen(self):
+        table = Table(100)
+        table["a"] = 5
+
+        # the table keeps keys with NUL, keys with NUL are not cut
+        with self.assertRaises(ValueError):
+            table["a\0zzz"] = 6
+        with self.assertRaises(ValueError):
+            "a\0b" in table
+        with self.assertRaises(ValueError):
+            table.get_many(["a", "a\0b"])
+        with self.assertRaises(ValueError):
+            table.update([("a\0b", 1)])
+        self.assertEqual(table["a"], 5)
+        self.assertEqual(list(table.keys()), ["a"])
+
+        del table
+
 
 if __name__ == "__main__":
     unittest.main()
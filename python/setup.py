@@ -36,6 +36,7 @@ if __name__ == "__main__":
                     "hashtable",
                     ["python.c", "../src/hashtable.c"],
                     include_dirs=paths,
+                    libraries=["pthread", "rt"],
                     extra_compile_args=[
                         "-g", "-std=c11", "-Werror", "-Wall", "-D_DEFAULT_SOURCE"
                     ])
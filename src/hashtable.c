@@ -6,6 +6,16 @@
 #include <math.h>
 #include <signal.h>
 #include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "hashtable.h"
 
@@ -16,6 +26,194 @@
 // Numbers of free backets in the hashtable.
 static double PERCENT_FREE_BACKETS = 0.25;
 
+// Number of keys, which first slots are prefetched by batch functions.
+#define BATCH_PREFETCH 8
+
+// Number of slots, which every insertion and deletion checks for expired items.
+#define EXPIRE_STEP_SLOTS 16
+
+// Tombstones are purged, when they are more than 1 / PURGE_TOMBSTONES_SHARE 
+// of the slots. A purge or a shrink moves REHASH_STEP_SLOTS slots 
+// on every insertion and deletion.
+#define PURGE_TOMBSTONES_SHARE 8
+#define REHASH_STEP_SLOTS 64
+
+// The filter of `TB_FILTER` tables: blocks of one cache line, 
+// 128 counters of 4 bits in each block, 4 counters per key,
+// one block for every FILTER_KEYS_PER_BLOCK keys of the size.
+#define FILTER_BLOCK_BYTES 64
+#define FILTER_COUNTERS 4
+#define FILTER_KEYS_PER_BLOCK 12
+#define FILTER_MAX_COUNT 15
+
+// The buckets of `TB_CUCKOO` tables: CUCKOO_SLOTS slots in one cache line.
+// An insertion moves at most CUCKOO_MAX_KICKS items, 
+// then the last moved item goes to the stash of CUCKOO_STASH items.
+#define CUCKOO_SLOTS 4
+#define CUCKOO_MAX_KICKS 256
+#define CUCKOO_STASH 8
+
+// Frozen tables: FROZEN_KEYS_PER_BUCKET keys per pilot on average,
+// keys are placed into `count` / FROZEN_LOAD_FACTOR positions,
+// a pilot is searched among FROZEN_MAX_PILOT values, 
+// the build is retried with FROZEN_MAX_SEEDS seeds.
+#define FROZEN_MAGIC 0x4e455a4f52464254ULL
+#define FROZEN_VERSION 3
+#define FROZEN_KEYS_PER_BUCKET 4
+#define FROZEN_LOAD_FACTOR 0.98
+#define FROZEN_MAX_PILOT UINT16_MAX
+#define FROZEN_MAX_SEEDS 16
+
+// The pool of freed blocks of items: TB_POOL_CLASSES lists of blocks, 
+// the block sizes of each list are multiples of POOL_GRANULE.
+#define POOL_GRANULE 16
+
+// Tables with `TB_MEMORY_*` flags: the slot array is mapped in pages of 
+// MEMORY_PAGE bytes or huge pages, small items are carved from chunks 
+// of ARENA_CHUNK bytes, one 2 MB huge page.
+#define MEMORY_PAGE 4096
+#define MEMORY_HUGE_2MB (1ul << 21)
+#define MEMORY_HUGE_1GB (1ul << 30)
+#define ARENA_CHUNK MEMORY_HUGE_2MB
+
+#ifdef __linux__
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+// The modes of `mbind`, from <numaif.h> of libnuma.
+#define MEMORY_MPOL_BIND 2
+#define MEMORY_MPOL_INTERLEAVE 3
+#endif
+
+// Shared tables: a slot is the offset of a record with the tag of the key 
+// in the upper 16 bits, 0 is a free slot, SHARED_DELETED is a removed one.
+#define SHARED_MAGIC 0x4445524148534254ULL
+#define SHARED_VERSION 3
+#define SHARED_DELETED 1
+#define SHARED_OFFSET_MASK ((1ULL << 48) - 1)
+// The free lists of removed records, by their size in 8 bytes from 24 bytes,
+// the last list keeps all bigger records.
+#define SHARED_FREE_LISTS 32
+
+// Logs of tables: the file starts with LOG_MAGIC and LOG_VERSION, 
+// the records follow, LOG_DELETE marks the records of deletions.
+// The snapshot of compactions is the file of the log with LOG_SNAPSHOT, 
+// it has the same header and a record of every item.
+#define LOG_MAGIC 0x474f4c4c424154ULL
+#define LOG_VERSION 1
+#define LOG_DELETE 0x80000000u
+#define LOG_SNAPSHOT ".snapshot"
+#define LOG_TEMPORARY ".tmp"
+
+// Tracing: the USDT probes insert, get, delete and resize of the provider 
+// "hashtable" for `perf` and `bpftrace`. A probe is a `nop` and a note 
+// of the .note.stapsdt section in the format of <sys/sdt.h> of SystemTap. 
+// A tracer, which attaches to a probe, increments its semaphore, only 
+// then the operations are timed. TB_NO_TRACING removes the probes and 
+// the callbacks of `tb_set_trace`.
+#if !defined(TB_NO_TRACING) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define USDT_PROBES 1
+#endif
+
+// Snapshots copy the slots by pages of 1 << SNAPSHOT_PAGE_SHIFT slots.
+#define SNAPSHOT_PAGE_SHIFT 9
+#define SNAPSHOT_PAGE_SLOTS (1u << SNAPSHOT_PAGE_SHIFT)
+
+// The length of keys, which end with NUL, for the functions with `length`.
+#define KEY_NUL SIZE_MAX
+
+// The values of the `index` slots of `TB_COMPACT` tables.
+// Other values are positions in `entries`.
+#define INDEX_EMPTY -1
+#define INDEX_DUMMY -2
+
+/*
+    The item of a `TB_LRU` or a `TB_TTL` table.
+    `prev` is a more recently used item, `next` is a less recently used item.
+    `expires` is the time of expiration in milliseconds, 0 is never.
+ */
+typedef struct tb_cache_item {
+    tb_hash_table_item item;
+    struct tb_cache_item *prev;
+    struct tb_cache_item *next;
+    uint64_t expires;
+} tb_cache_item;
+
+/*
+    The item of a `TB_MULTI` table. `val` of the item is the run of 
+    `capacity` values, the first `count` of them are used, the key 
+    follows the run in the same block.
+ */
+typedef struct {
+    tb_hash_table_item item;
+    uint32_t count;
+    uint32_t capacity;
+} tb_multi_item;
+
+/*
+    The bucket of a `TB_CUCKOO` table, it is one cache line.
+    `tags` are 16 bits of the hashes of the keys, 0 is a free slot.
+ */
+typedef struct {
+    _Alignas(64) uint16_t tags[CUCKOO_SLOTS];
+    tb_hash_table_item *items[CUCKOO_SLOTS];
+} tb_cuckoo_bucket;
+
+#ifdef USDT_PROBES
+// The semaphores of the probes, they are the counters of attached tracers.
+static volatile unsigned short tb_usdt_insert_semaphore __attribute__((section(".probes"), used));
+static volatile unsigned short tb_usdt_get_semaphore __attribute__((section(".probes"), used));
+static volatile unsigned short tb_usdt_delete_semaphore __attribute__((section(".probes"), used));
+static volatile unsigned short tb_usdt_resize_semaphore __attribute__((section(".probes"), used));
+
+#define USDT_ACTIVE(name) (tb_usdt_##name##_semaphore != 0)
+
+// The probe `name` with the arguments: the table, the key, 
+// the number of probes and the cycles.
+#define USDT_PROBE(name, table, key, probes, cycles) \
+    __asm__ __volatile__ ( \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt, \"?\", \"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f - 991f, 994f - 993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte tb_usdt_" #name "_semaphore\n" \
+        ".asciz \"hashtable\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"8@%0 8@%1 4@%2 8@%3\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base, \"aG\", \"progbits\", .stapsdt.base, comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n" \
+        : : "nor"((uint64_t)(uintptr_t)(table)), "nor"((uint64_t)(uintptr_t)(key)), \
+            "nor"((uint32_t)(probes)), "nor"((uint64_t)(cycles)))
+#else
+#define USDT_ACTIVE(name) 0
+#define USDT_PROBE(name, table, key, probes, cycles) ((void)0)
+#endif
+
+// Operations are timed, if the table has a callback or a tracer is attached.
+#ifdef TB_NO_TRACING
+#define TRACE_ACTIVE(table, name) 0
+#else
+#define TRACE_ACTIVE(table, name) __builtin_expect((table)->trace != NULL || USDT_ACTIVE(name), 0)
+#endif
+
 /* 
     A variable EMPTY_ITEM, for check all EMPTY_ITEM items in table.
     Key and val must be null.
@@ -25,307 +223,4663 @@ tb_hash_table_item * EMPTY_ITEM = &(tb_hash_table_item){NULL, NULL};
 /*
 
  */
-static uint64_t get_hash(const char *key);
-static uint64_t get_hash_additional(const char *key);
+static uint64_t get_hash(const char *key, size_t length);
+
+/*
+    A static function, the size of the pages of memory with `memory` flags.
+    Returns the number of bytes.
+ */
+static size_t region_page(uint32_t memory) {
+    if (memory & TB_MEMORY_HUGE_1GB) {
+        return MEMORY_HUGE_1GB;
+    }
+    if (memory & (TB_MEMORY_HUGE_2MB | TB_MEMORY_THP)) {
+        return MEMORY_HUGE_2MB;
+    }
+    return MEMORY_PAGE;
+}
+
+/*
+    A static function, allocates zeroed memory of `bytes` with `memory` flags, 
+    aligned to a cache line. Without flags it is `aligned_alloc`, otherwise 
+    the memory is mapped by pages, `numa_nodes` is the mask of NUMA nodes.
+    Returns a pointer to the memory, or NULL.
+ */
+static void *region_alloc(uint32_t memory, uint64_t numa_nodes, size_t bytes) {
+    bytes = bytes ? bytes : 1;
+#ifdef __linux__
+    if (memory) {
+        size_t page = region_page(memory);
+        size_t size = (bytes + page - 1) / page * page;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        void *region = MAP_FAILED;
+        if (memory & (TB_MEMORY_HUGE_2MB | TB_MEMORY_HUGE_1GB)) {
+            int huge = memory & TB_MEMORY_HUGE_1GB ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+            region = mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | huge, -1, 0);
+        }
+        if (region == MAP_FAILED) {
+            // no reserved huge pages, transparent ones need the memory aligned to them, 
+            // they are 2 MB, so the memory is rounded to 2 MB, not to 1 GB
+            size_t align = page > MEMORY_PAGE ? MEMORY_HUGE_2MB : 0;
+            if (align) {
+                size = (bytes + align - 1) / align * align;
+            }
+            uint8_t *mapped = (uint8_t *)mmap(NULL, size + align, PROT_READ | PROT_WRITE, 
+                    flags, -1, 0);
+            if (mapped == MAP_FAILED) {
+                return NULL;
+            }
+            region = mapped;
+            if (align) {
+                uint8_t *start = (uint8_t *)(((uintptr_t)mapped + align - 1) & ~(uintptr_t)(align - 1));
+                if (start != mapped) {
+                    munmap(mapped, (size_t)(start - mapped));
+                }
+                munmap(start + size, (size_t)(mapped + align - start));
+                madvise(start, size, MADV_HUGEPAGE);
+                region = start;
+            }
+        }
+        if (memory & (TB_MEMORY_NUMA_BIND | TB_MEMORY_NUMA_INTERLEAVE)) {
+            // before the first touch, the pages are placed when they are faulted
+            unsigned long nodes = (unsigned long)numa_nodes;
+            int mode = memory & TB_MEMORY_NUMA_INTERLEAVE ? MEMORY_MPOL_INTERLEAVE : MEMORY_MPOL_BIND;
+            syscall(SYS_mbind, region, size, mode, &nodes, sizeof(nodes) * 8, 0);
+        }
+        if (memory & TB_MEMORY_PREFAULT) {
+            // only the requested bytes, the rest of a 1 GB page may never be used
+            for (size_t offset = 0; offset < bytes; offset += MEMORY_PAGE) {
+                ((volatile uint8_t *)region)[offset] = 0;
+            }
+        }
+        return region;
+    }
+#else
+    (void)memory;
+    (void)numa_nodes;
+#endif
+    void *region = aligned_alloc(64, (bytes + 63) & ~(size_t)63);
+    if (region != NULL) {
+        memset(region, 0, bytes);
+    }
+    return region;
+}
+
+/*
+    A static function, frees the memory of `region_alloc`, `memory` and 
+    `bytes` are the same as for `region_alloc`. NULL is ignored.
+    Nothing to returns.
+ */
+static void region_free(uint32_t memory, void *region, size_t bytes) {
+    if (region == NULL) {
+        return;
+    }
+#ifdef __linux__
+    if (memory) {
+        size_t page = region_page(memory);
+        bytes = bytes ? bytes : 1;
+        // 1 GB pages fall back to 2 MB ones, a part of 1 GB pages 
+        // is not unmapped, `munmap` fails for them
+        if (page == MEMORY_HUGE_1GB && munmap(region, 
+                (bytes + MEMORY_HUGE_2MB - 1) / MEMORY_HUGE_2MB * MEMORY_HUGE_2MB) == 0) {
+            return;
+        }
+        munmap(region, (bytes + page - 1) / page * page);
+        return;
+    }
+#else
+    (void)memory;
+#endif
+    (void)bytes;
+    free(region);
+}
+
+/*
+    A static function, the memory flags of the chunks of the arena, 
+    1 GB pages are too big for them.
+    Returns the flags.
+ */
+static inline uint32_t arena_memory(const tb_hash_table * const table) {
+    return table->memory & TB_MEMORY_HUGE_1GB 
+        ? (table->memory & ~(uint32_t)TB_MEMORY_HUGE_1GB) | TB_MEMORY_HUGE_2MB : table->memory;
+}
+
+/*
+    A static function, carves a block from the arena of the table, 
+    a new chunk is mapped if the last one is full. A chunk starts with 
+    the pointer to the previous chunk and the number of its used bytes.
+    Returns a pointer to the block, or NULL.
+ */
+static void *arena_alloc(tb_hash_table *table, size_t bytes) {
+    uint8_t *chunk = (uint8_t *)table->arena;
+    if (chunk == NULL || *(size_t *)(chunk + sizeof(void *)) + bytes > ARENA_CHUNK) {
+        uint8_t *next = (uint8_t *)region_alloc(arena_memory(table), table->numa_nodes, ARENA_CHUNK);
+        if (next == NULL) {
+            return NULL;
+        }
+        *(void **)next = chunk;
+        *(size_t *)(next + sizeof(void *)) = POOL_GRANULE;
+        table->arena = chunk = next;
+    }
+    size_t *used = (size_t *)(chunk + sizeof(void *));
+    void *block = chunk + *used;
+    *used += bytes;
+    return block;
+}
+
+/*
+    A static function, allocates a block of memory for items.
+    Small blocks are taken from the pool of the table, if it has one 
+    of the same size class, so recycled tables do not call `malloc`.
+    Returns a pointer to the block, or NULL.
+ */
+static void *pool_alloc(tb_hash_table *table, size_t bytes) {
+    size_t class = (bytes + POOL_GRANULE - 1) / POOL_GRANULE;
+    if (class >= TB_POOL_CLASSES) {
+        return malloc(bytes);
+    }
+    void *block = table->pool[class];
+    if (block != NULL) {
+        table->pool[class] = *(void **)block;
+        --table->pooled;
+        return block;
+    }
+    if (table->memory) {
+        return arena_alloc(table, class * POOL_GRANULE);
+    }
+    return malloc(class * POOL_GRANULE);
+}
+
+/*
+    A static function, returns a block of `pool_alloc` to the pool of 
+    the table, big blocks are freed. `bytes` is the size of `pool_alloc`.
+    The pool keeps at most `size` blocks from `malloc`, more are freed, 
+    blocks of the arena are freed with its chunks only.
+    Nothing to returns.
+ */
+static void pool_free(tb_hash_table *table, void *block, size_t bytes) {
+    size_t class = (bytes + POOL_GRANULE - 1) / POOL_GRANULE;
+    if (class >= TB_POOL_CLASSES || (!table->memory && table->pooled >= table->size)) {
+        free(block);
+        return;
+    }
+    *(void **)block = table->pool[class];
+    table->pool[class] = block;
+    ++table->pooled;
+}
+
+/*
+    A static function, frees all blocks in the pool of the table.
+    Blocks of the arena are freed with its chunks.
+    Nothing to returns.
+ */
+static void pool_release(tb_hash_table *table) {
+    table->pooled = 0;
+    if (table->memory) {
+        memset(table->pool, 0, sizeof(table->pool));
+        while (table->arena != NULL) {
+            void *chunk = table->arena;
+            table->arena = *(void **)chunk;
+            region_free(arena_memory(table), chunk, ARENA_CHUNK);
+        }
+        return;
+    }
+    for (uint32_t class = 0; class < TB_POOL_CLASSES; ++class) {
+        while (table->pool[class] != NULL) {
+            void *block = table->pool[class];
+            table->pool[class] = *(void **)block;
+            free(block);
+        }
+    }
+}
+
+/*
+    A static function, the number of bytes, which the table copies of a key.
+    `TB_INTERNED` tables do not copy keys.
+    Returns the number of bytes.
+ */
+static inline size_t key_size(const tb_hash_table * const table, const char *key) {
+    return table->flags & TB_INTERNED ? 0 : strlen(key) + 1;
+}
+
+/*
+    A static function, the number of bytes, which the table copies of 
+    a key of `length` bytes, see `key_size`.
+    Returns the number of bytes.
+ */
+static inline size_t key_size_n(const tb_hash_table * const table, const char *key, size_t length) {
+    return length == KEY_NUL ? key_size(table, key) : table->flags & TB_INTERNED ? 0 : length + 1;
+}
+
+/*
+    A static function, compares a key of the table with a key of `length` 
+    bytes, or with a key that ends with NUL, if `length` is KEY_NUL.
+    `TB_INTERNED` tables compare pointers only.
+    Returns 1 if the keys are equal, otherwise 0.
+ */
+static inline int keys_equal(const tb_hash_table * const table, const char *item_key, 
+        const char *key, size_t length) {
+    if (table->flags & TB_INTERNED) {
+        return item_key == key;
+    }
+    if (length == KEY_NUL) {
+        return strcmp(item_key, key) == 0;
+    }
+    return strncmp(item_key, key, length) == 0 && item_key[length] == '\0';
+}
+
+/*
+    A static function, fills an allocated `tb_hash_table_item`.
+    Copies the value and the key into `block`, the value is first,
+    `size` is `key_size_n` of the key, `block` has `sizeof(void *) + size` bytes.
+    Nothing to returns.
+ */
+static void init_table_item(const tb_hash_table * const table, tb_hash_table_item *item, 
+        char *block, const char *key, size_t size, const void *val) {
+    item->val = block;
+    memcpy(item->val, val, sizeof(void *));
+    if (table->flags & TB_INTERNED) {
+        item->key = (char *)key;
+        return;
+    }
+    item->key = block + sizeof(void *);
+    memcpy(item->key, key, size - 1);
+    item->key[size - 1] = '\0';
+}
+
+/*
+    A static function, fills an entry of a `TB_COMPACT` table, 
+    `length` is the length of the key, or KEY_NUL.
+    The value and the key are one block of the pool.
+    Nothing to returns.
+ */
+static void init_table_entry(tb_hash_table *table, tb_hash_table_item *item, const char *key, 
+        size_t length, const void *val) {
+    size_t size = key_size_n(table, key, length);
+    char *block = (char *)pool_alloc(table, sizeof(void *) + size);
+    init_table_item(table, item, block, key, size, val);
+}
+
+/*
+    A static function, frees the key and the value of an entry of 
+    a `TB_COMPACT` table.
+    The key is set to NULL, it marks a deleted entry.
+    Nothing to returns.
+ */
+static void clear_table_item(tb_hash_table *table, tb_hash_table_item *item) {
+    pool_free(table, item->val, sizeof(void *) + key_size(table, item->key));
+    item->key = NULL;
+    item->val = NULL;
+}
+
+/*
+    A static function, the size of the items of the table without 
+    the value and the key.
+    `TB_LRU` and `TB_TTL` tables have `tb_cache_item`, `TB_MULTI` tables 
+    have `tb_multi_item`, the item is their first member.
+    Returns the size.
+ */
+static inline size_t item_header_size(const tb_hash_table * const table) {
+    if (table->flags & TB_MULTI) {
+        return sizeof(tb_multi_item);
+    }
+    return table->flags & (TB_LRU | TB_TTL) ? sizeof(tb_cache_item) : sizeof(tb_hash_table_item);
+}
+
+/*
+    A static function, the size of the values of an item, 
+    the run of a `TB_MULTI` item, otherwise one value.
+    Returns the size.
+ */
+static inline size_t item_values_size(const tb_hash_table * const table, const tb_hash_table_item *item) {
+    if (table->flags & TB_MULTI) {
+        return (size_t)((const tb_multi_item *)item)->capacity * sizeof(void *);
+    }
+    return sizeof(void *);
+}
 
 /* 
     A static function, creates a new `tb_hash_table_item`.
     Puts a value by key in the table and returns pointer to item.
     Item example: {'key' : value} .
-
-    `strdup` is not ANSI function. 
-    `strdup` call malloc function, allocates memory for a string, 
-	copies string in this place and returns a pointer to the string.
+    The item, the value and the key are one block of the pool.
 */
-static tb_hash_table_item *tb_new_table_item(const char *key, const void *val) {
-    tb_hash_table_item *item = (tb_hash_table_item *)malloc(sizeof(tb_hash_table_item));
-    item->key = strdup(key); 
-    item->val = malloc(sizeof(void *));
-    memcpy(item->val, val, sizeof(void *));
+static tb_hash_table_item *tb_new_table_item_n(tb_hash_table *table, const char *key, 
+        size_t length, const void *val) {
+    size_t header = item_header_size(table);
+    size_t size = key_size_n(table, key, length);
+    char *block = (char *)pool_alloc(table, header + sizeof(void *) + size);
+    tb_hash_table_item *item = (tb_hash_table_item *)block;
+    init_table_item(table, item, block + header, key, size, val);
+    if (table->flags & TB_MULTI) {
+        ((tb_multi_item *)item)->count = ((tb_multi_item *)item)->capacity = 1;
+    }
     return item;
 }
 
+/*
+    A static function, creates a new `tb_hash_table_item` of a key, 
+    which ends with NUL, see `tb_new_table_item_n`.
+    Returns pointer to item.
+ */
+static inline tb_hash_table_item *tb_new_table_item(tb_hash_table *table, const char *key, const void *val) {
+    return tb_new_table_item_n(table, key, KEY_NUL, val);
+}
+
+/*
+    A static function, copies an item of a `TB_MULTI` table into a new 
+    block with the run of `capacity` values, it is not less than `count`.
+    Returns pointer to the new item.
+ */
+static tb_multi_item *multi_item_copy(tb_hash_table *table, const tb_multi_item *old, uint32_t capacity) {
+    size_t size = key_size(table, old->item.key);
+    size_t values = (size_t)capacity * sizeof(void *);
+    char *block = (char *)pool_alloc(table, sizeof(tb_multi_item) + values + size);
+    tb_multi_item *multi = (tb_multi_item *)block;
+    multi->item.val = block + sizeof(tb_multi_item);
+    memcpy(multi->item.val, old->item.val, (size_t)old->count * sizeof(void *));
+    if (table->flags & TB_INTERNED) {
+        multi->item.key = old->item.key;
+    } else {
+        multi->item.key = block + sizeof(tb_multi_item) + values;
+        memcpy(multi->item.key, old->item.key, size);
+    }
+    multi->count = old->count;
+    multi->capacity = capacity;
+    return multi;
+}
+
 /*
     A static function, removes `tb_hash_table_item` from memory.
     Nothing to returns.
  */
-static void tb_delete_table_item(tb_hash_table_item *item) {
-    free(item->key);
-    free(item->val);
-    free(item);
+static void tb_delete_table_item(tb_hash_table *table, tb_hash_table_item *item) {
+    pool_free(table, item, item_header_size(table) + item_values_size(table, item) 
+            + key_size(table, item->key));
 }
 
 /*
-    The `djb2` funciton.
+    The `djb2` funciton, over `length` bytes or to NUL.
     More information: http://www.cse.yorku.ca/~oz/hash.html.
  */
-static uint64_t get_hash(const char *key) {
+static uint64_t get_hash(const char *key, size_t length) {
     uint64_t h = 5381;
     int c;
-    while ((c = *key++)) {
+    while (length-- && (c = *key++)) {
         h = h * 33 + (uint64_t)c;
     }
     return h;
 }
 
-/* 
-    A static funtion, returns a new hash for strings.
+// One SipHash round.
+#define SIP_ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIP_ROUND(v0, v1, v2, v3) { \
+    v0 += v1; v1 = SIP_ROTL(v1, 13); v1 ^= v0; v0 = SIP_ROTL(v0, 32); \
+    v2 += v3; v3 = SIP_ROTL(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = SIP_ROTL(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = SIP_ROTL(v1, 17); v1 ^= v2; v2 = SIP_ROTL(v2, 32); \
+}
+
+/*
+    A static function, the keyed hash of `TB_SEEDED` and frozen tables, 
+    SipHash-1-3 with the key `seed`, `length` is KEY_NUL for keys with NUL.
+    More information: https://en.wikipedia.org/wiki/SipHash .
+    Returns the hash.
+ */
+static uint64_t seeded_hash(const uint64_t seed[2], const char *key, size_t length) {
+    uint64_t v0 = seed[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = seed[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = seed[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = seed[1] ^ 0x7465646279746573ULL;
+    length = length == KEY_NUL ? strlen(key) : length;
+    const unsigned char *data = (const unsigned char *)key;
+    const unsigned char *end = data + (length & ~(size_t)7);
+    for (; data != end; data += 8) {
+        uint64_t m = 0;
+        for (int i = 0; i < 8; ++i) {
+            m |= (uint64_t)data[i] << (8 * i);
+        }
+        v3 ^= m;
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    uint64_t m = (uint64_t)length << 56;
+    for (size_t i = 0; i < (length & 7); ++i) {
+        m |= (uint64_t)data[i] << (8 * i);
+    }
+    v3 ^= m;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= m;
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+    A static function, fills `seed` with random bytes from `/dev/urandom`.
+    If it can not be read, the seed is mixed from the time and addresses.
+    Nothing to returns.
+ */
+static void random_seed(uint64_t seed[2]) {
+    FILE *file = fopen("/dev/urandom", "rb");
+    size_t read = 0;
+    if (file != NULL) {
+        read = fread(seed, sizeof(uint64_t), 2, file);
+        fclose(file);
+    }
+    if (read != 2) {
+        seed[0] = (uint64_t)time(NULL) ^ ((uint64_t)(uintptr_t)seed << 16);
+        seed[1] = (uint64_t)clock() ^ (uint64_t)(uintptr_t)&random_seed;
+        SIP_ROUND(seed[0], seed[1], seed[0], seed[1]);
+    }
+}
+
+/*
+    A static function, the hash of a key, it is computed once per operation,
+    `probe_index` gives all the slots of the probe sequence from it.
+    The `djb2` hash is mixed by the `fmix64` finalizer of MurmurHash3, 
+    so the lower bits, which select the slot, depend on the whole key.
+    `TB_SEEDED` tables use the keyed hash. `TB_INTERNED` tables hash 
+    the pointer, the bytes of the key are not read.
+    `length` is the length of the key, or KEY_NUL.
+    Returns the hash.
  */
-static uint64_t get_hash_additional(const char *key) {
-    uint64_t h = 0;
-    for (uint32_t i = 0; i < (uint32_t)strlen(key); i++) {
-        h = ((h * 31) + (uint64_t)key[i]);
+static uint64_t key_hash_n(const tb_hash_table * const table, const char *key, size_t length) {
+    uint64_t h;
+    if (table->flags & TB_INTERNED) {
+        h = (uint64_t)(uintptr_t)key ^ table->seed[0];
+    } else if (table->flags & TB_SEEDED) {
+        return seeded_hash(table->seed, key, length);
+    } else {
+        h = get_hash(key, length);
     }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
     return h;
 }
 
-/* 
-    The double hashing function for resolving hash collisions.
-    More information: https://en.wikipedia.org/wiki/Double_hashing .
+/*
+    A static function, the hash of a key, which ends with NUL, see `key_hash_n`.
     Returns the hash.
-*/ 
-static uint32_t hash(const char *key, const uint32_t num, const uint32_t try) {
-    uint64_t hash_a = get_hash(key);
-    uint64_t hash_b = get_hash_additional(key);
-    // variables: try is attempts, num is array size
-    // formula: `hash_a(key) + try + (hash_b(key) + 1) mod size`
-    return (uint32_t)(hash_a + (try + (hash_b + 1))) % num;
-} 
+ */
+static inline uint64_t key_hash(const tb_hash_table * const table, const char *key) {
+    return key_hash_n(table, key, KEY_NUL);
+}
 
 /* 
-    The function creates a new table in memory.
-    Returns a pointer to the table.
-*/
-tb_hash_table *tb_create_hash_table(uint32_t size) {
-    if (size > 0) {
-        tb_hash_table *table = (tb_hash_table *)malloc(sizeof(tb_hash_table));
-        // size_t is unsigned int
-        table->size = size;
-        table->count = 0;
-        table->allocated = (uint32_t)(size * (1 + PERCENT_FREE_BACKETS));
-        // returns a pointer to the allocated memory for all items
-        table->items = (tb_hash_table_item **)malloc(table->allocated * sizeof(tb_hash_table_item));
-        if (table->items != NULL) {
-            memset(table->items, 0, table->allocated  * sizeof(tb_hash_table_item));
-            table->empty = 1;
-        }
-        return table;
+    The probing function for resolving hash collisions.
+    `allocated` is a power of two, so the slot is the lower bits of 
+    the hash and every sequence visits all slots in `allocated` tries:
+    `TB_PROBE_DOUBLE` - the odd step is the upper half of the hash,
+    more information: https://en.wikipedia.org/wiki/Double_hashing .
+    `TB_PROBE_QUADRATIC` - triangular numbers, `h + try * (try + 1) / 2`.
+    `TB_PROBE_LINEAR` - the next slot.
+    `probing` is the strategy, `allocated` is the number of slots.
+    Returns the slot.
+*/ 
+static inline uint32_t probe_index_in(uint32_t probing, uint32_t allocated, uint64_t h, const uint32_t try) {
+    const uint64_t mask = allocated - 1;
+    switch (probing) {
+    case TB_PROBE_QUADRATIC:
+        return (uint32_t)((h + (uint64_t)try * (try + 1) / 2) & mask);
+    case TB_PROBE_LINEAR:
+        return (uint32_t)((h + try) & mask);
+    default:
+        return (uint32_t)((h + (uint64_t)try * ((h >> 32) | 1)) & mask);
     }
-    return NULL;
 }
 
 /*
-    Returns the `tb_hash_table_item` object, if an item with this key exists. 
-    Otherwise returns NULL.
+    A static function, the slot of the try `try` of the hash `h` 
+    in the slots of the table, see `probe_index_in`.
+    Returns the slot.
  */
-tb_hash_table_item *tb_find_item(const tb_hash_table * const table, const char *key) {
-    if (table->size) {
-        int64_t index = hash(key, table->allocated, 0);
-        uint32_t try = 1;
-        tb_hash_table_item *item = table->items[index];
-        while (item != NULL) {
-            // check if an item is not EMPTY_ITEM ( if an item exists )
-            if (item != EMPTY_ITEM) {
-                if (strcmp(item->key, key) == 0) {
-                    return item;
-                }
-            }
-            // get a new hash
-            index = hash(key, table->allocated, try);
-            // get a new current item
-            item = table->items[index];
-            // +1 attempts
-            ++try;
+static inline uint32_t probe_index(const tb_hash_table * const table, uint64_t h, const uint32_t try) {
+    return probe_index_in(table->probing, table->allocated, h, try);
+}
+
+/*
+    A static function, the hash of the filter of `TB_FILTER` tables.
+    The key hash is mixed again, so the counters do not depend on 
+    the same bits as the slot.
+    Returns the hash.
+ */
+static inline uint64_t filter_hash(uint64_t h) {
+    h = (h ^ (h >> 29)) * 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 32);
+}
+
+/*
+    A static function, finds the block of a key in the filter.
+    The upper bits of the hash select the block, the lower bits 
+    select the counters inside the block.
+    Returns the pointer to the block.
+ */
+static inline uint8_t *filter_block(const tb_hash_table * const table, uint64_t h) {
+    uint64_t block = ((h >> 32) * table->filter_blocks) >> 32;
+    return table->filter + block * FILTER_BLOCK_BYTES;
+}
+
+/*
+    A static function, checks a key in the filter of a `TB_FILTER` table.
+    Returns 0 if the key is surely not in the table, otherwise 1.
+ */
+static int filter_test(const tb_hash_table * const table, uint64_t h) {
+    h = filter_hash(h);
+    const uint8_t *block = filter_block(table, h);
+    for (int i = 0; i < FILTER_COUNTERS; ++i, h >>= 7) {
+        uint32_t counter = h & 127;
+        if (!((block[counter >> 1] >> ((counter & 1) * 4)) & 0xf)) {
+            return 0;
         }
     }
-    return NULL;
+    return 1;
 }
 
-/* 
-    The function inserts a value by key into the table.
-    Returns the position of the item.
-*/
-void tb_insert_item(tb_hash_table *table, const char *key, const void *val) {
-    // get a new item
-    tb_hash_table_item *new_item = tb_new_table_item(key, val);
-    // get hash
-    int64_t index = hash(new_item->key, table->allocated, 0);
-    // number of attemps
-    uint32_t try = 1;
-    // get a current item
-    tb_hash_table_item *current_item = table->items[index];
-    while (current_item != NULL) {
-        // check if an item is not EMPTY_ITEM ( if an item exists )
-        if (current_item != EMPTY_ITEM) {
-            // if an item exists, replace a value by key
-            if (strcmp(current_item->key, key) == 0) {
-                // delete a current value by key, set a new value by key
-                tb_delete_table_item(current_item);
-                table->items[index] = new_item;
-                return;
-            }
-            if (table->size == table->count) {
-                printf("Error: hastable is full! Skip insert operation!");
-                return;
-            }
-        // if an item is EMPTY_ITEM, stop cycle
-        } else {
-            break;
+/*
+    A static function, adds a key to or removes a key from the filter 
+    of a `TB_FILTER` table. `delta` is 1 or -1.
+    Saturated counters are never changed, so the filter has no false negatives.
+    Nothing to returns.
+ */
+static void filter_update(tb_hash_table *table, const char *key, int delta) {
+    uint64_t h = filter_hash(key_hash(table, key));
+    uint8_t *block = filter_block(table, h);
+    for (int i = 0; i < FILTER_COUNTERS; ++i, h >>= 7) {
+        uint32_t counter = h & 127;
+        uint32_t shift = (counter & 1) * 4;
+        uint32_t value = (block[counter >> 1] >> shift) & 0xf;
+        if (value == FILTER_MAX_COUNT || (delta < 0 && value == 0)) {
+            continue;
         }
-        // get a new hash
-        index = hash(new_item->key, table->allocated, try);
-        // get a new current item
-        current_item = table->items[index];
-        // +1 attempts
-        ++try;
+        value = (uint32_t)((int)value + delta);
+        block[counter >> 1] = (uint8_t)((block[counter >> 1] & ~(0xf << shift)) | (value << shift));
     }
-    // set a new item and count
-    table->items[index] = new_item;
-    ++table->count;
-    table->empty = 0;
-    return;
 }
 
-/* 
-    The function gets a value by key.
-    Returns the pointer to a value, if the value by key exists. 
-    Otherwise returns NULL
-*/
-void *tb_get_value(const tb_hash_table * const table, const char *key) {
-    if (table->empty) {
-        return NULL;
+/*
+    A static function, adds a new key to the filter, if the table has it.
+    Nothing to returns.
+ */
+static inline void filter_add(tb_hash_table *table, const char *key) {
+    if (table->flags & TB_FILTER) {
+        filter_update(table, key, 1);
     }
-    uint32_t ch = 0;
-    // number of attempts
-    uint32_t try = 1;
-    // get a new hash
-    int64_t index = hash(key, table->allocated, 0);
-    // get an item
-    tb_hash_table_item *item = table->items[index];
-    while (item != NULL) {
-        // check if an item is not EMPTY_ITEM
-        if (item != EMPTY_ITEM) {
-            // check key and item.key
-            if (strcmp(item->key, key) == 0) {
-                // return a value by key
-                return item->val;
-            }
-            ch++;
-        }
-        if (ch == table->count) {
-            break;
-        }
-        // get a new item, +1 attempts
-        index = hash(key, table->allocated, try);
-        item = table->items[index];
-        ++try;
+}
+
+/*
+    A static function, removes a key from the filter, if the table has it.
+    Nothing to returns.
+ */
+static inline void filter_remove(tb_hash_table *table, const char *key) {
+    if (table->flags & TB_FILTER) {
+        filter_update(table, key, -1);
     }
-    // if nothing if found, return NULL
-    return NULL;
 }
 
-/* 
-    The function gets the item by key.
-    Returns the pointer to the item, if the item with this key exists. 
-    Otherwise returns NULL
-*/
-tb_hash_table_item *tb_get_item(const tb_hash_table * const table, const char *key) {
+/*
+    A static function, checks a key before a lookup, `h` is its hash.
+    Returns 0 if the key is surely not in the table, otherwise 1.
+ */
+static inline int filter_may_contain(const tb_hash_table * const table, uint64_t h) {
+    return !(table->flags & TB_FILTER) || filter_test(table, h);
+}
+
+/*
+    A static function, reads a slot of the `index` of a `TB_COMPACT` table.
+    Returns a position in `entries`, INDEX_EMPTY or INDEX_DUMMY.
+ */
+static inline int32_t index_get(const tb_hash_table * const table, int64_t slot) {
+    switch (table->index_width) {
+    case 1:
+        return ((int8_t *)table->index)[slot];
+    case 2:
+        return ((int16_t *)table->index)[slot];
+    default:
+        return ((int32_t *)table->index)[slot];
+    }
+}
+
+/*
+    A static function, writes a slot of the `index` of a `TB_COMPACT` table.
+    Nothing to returns.
+ */
+static inline void index_set(tb_hash_table *table, int64_t slot, int32_t position) {
+    switch (table->index_width) {
+    case 1:
+        ((int8_t *)table->index)[slot] = (int8_t)position;
+        break;
+    case 2:
+        ((int16_t *)table->index)[slot] = (int16_t)position;
+        break;
+    default:
+        ((int32_t *)table->index)[slot] = position;
+    }
+}
+
+/*
+    A static function, searches a key in a `TB_COMPACT` table, `h` is its hash.
+    If the key is found, writes its `index` slot into `slot`.
+    Otherwise writes the first free slot of the probe sequence, or -1.
+    Returns a position in `entries`, or INDEX_EMPTY.
+ */
+static int32_t compact_lookup(const tb_hash_table * const table, const char *key, 
+        size_t length, uint64_t h, int64_t *slot) {
+    int64_t free_slot = -1;
+    for (uint32_t try = 0; try < table->allocated; ++try) {
+        int64_t index = probe_index(table, h, try);
+        int32_t position = index_get(table, index);
+        if (position == INDEX_EMPTY) {
+            if (free_slot < 0) {
+                free_slot = index;
+            }
+            break;
+        }
+        if (position == INDEX_DUMMY) {
+            if (free_slot < 0) {
+                free_slot = index;
+            }
+        } else if (keys_equal(table, table->entries[position].key, key, length)) {
+            *slot = index;
+            return position;
+        }
+    }
+    *slot = free_slot;
+    return INDEX_EMPTY;
+}
+
+/*
+    A static function, removes deleted entries from a `TB_COMPACT` table.
+    Live entries keep insertion order, the `index` is built again.
+    Nothing to returns.
+ */
+static void compact_rebuild(tb_hash_table *table) {
+    uint32_t used = 0;
+    for (uint32_t position = 0; position < table->used; ++position) {
+        if (table->entries[position].key != NULL) {
+            table->entries[used++] = table->entries[position];
+        }
+    }
+    table->used = used;
+    // all bytes 0xff is INDEX_EMPTY for any width
+    memset(table->index, 0xff, (size_t)table->allocated * table->index_width);
+    for (uint32_t position = 0; position < used; ++position) {
+        int64_t slot;
+        const char *key = table->entries[position].key;
+        compact_lookup(table, key, KEY_NUL, key_hash(table, key), &slot);
+        index_set(table, slot, (int32_t)position);
+    }
+}
+
+/*
+    A static function, inserts a value by key into a `TB_COMPACT` table.
+    A new key is appended to `entries`, an existing key gets a new value,
+    its old value is written into `old`, if it is not NULL.
+    Returns the item, or NULL if the table is full.
+ */
+static tb_hash_table_item *compact_insert(tb_hash_table *table, const char *key, 
+        size_t length, const void *val, void *old) {
+    int64_t slot;
+    uint64_t h = key_hash_n(table, key, length);
+    int32_t position = compact_lookup(table, key, length, h, &slot);
+    if (position >= 0) {
+        if (old != NULL) {
+            memcpy(old, table->entries[position].val, sizeof(void *));
+        }
+        memcpy(table->entries[position].val, val, sizeof(void *));
+        return &table->entries[position];
+    }
+    if (table->size == table->count) {
+        printf("Error: hastable is full! Skip insert operation!");
+        return NULL;
+    }
+    // no room at the end of `entries`, squeeze out deleted ones
+    if (table->used == table->allocated || slot < 0) {
+        compact_rebuild(table);
+        compact_lookup(table, key, length, h, &slot);
+    }
+    position = (int32_t)table->used++;
+    tb_hash_table_item *item = &table->entries[position];
+    init_table_entry(table, item, key, length, val);
+    filter_add(table, item->key);
+    index_set(table, slot, position);
+    ++table->count;
+    table->empty = 0;
+    return item;
+}
+
+/*
+    A static function, removes a value by key from a `TB_COMPACT` table.
+    The removed value is written into `val`, if it is not NULL.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+static int compact_delete(tb_hash_table *table, const char *key, size_t length, void *val) {
+    int64_t slot;
+    int32_t position = compact_lookup(table, key, length, key_hash_n(table, key, length), &slot);
+    if (position < 0) {
+        return 0;
+    }
+    if (val != NULL) {
+        memcpy(val, table->entries[position].val, sizeof(void *));
+    }
+    filter_remove(table, table->entries[position].key);
+    clear_table_item(table, &table->entries[position]);
+    index_set(table, slot, INDEX_DUMMY);
+    --table->count;
+    if (!table->count) {
+        // nothing is alive, start from the beginning
+        table->used = 0;
+        memset(table->index, 0xff, (size_t)table->allocated * table->index_width);
+        table->empty = 1;
+    }
+    return 1;
+}
+
+/*
+    A static function, gets the item by key from a `TB_COMPACT` table.
+    Returns the pointer to the item, or NULL.
+ */
+static tb_hash_table_item *compact_get_item(const tb_hash_table * const table, 
+        const char *key, size_t length) {
+    uint64_t h = key_hash_n(table, key, length);
+    if (!filter_may_contain(table, h)) {
+        return NULL;
+    }
+    int64_t slot;
+    int32_t position = compact_lookup(table, key, length, h, &slot);
+    return position >= 0 ? &table->entries[position] : NULL;
+}
+
+/*
+    A static function, searches the slot of a key, `h` is its hash.
+    If `free_slot` is not NULL, writes the first NULL or EMPTY_ITEM slot 
+    of the probe sequence into it, an insertion uses it.
+    Returns the slot, or -1 if the key is not in the table.
+ */
+static int64_t probe_slot(const tb_hash_table * const table, const char *key, 
+        size_t length, uint64_t h, int64_t *free_slot) {
     uint32_t ch = 0;
     // number of attempts
     uint32_t try = 1;
-    // get a new hash
-    int64_t index = hash(key, table->allocated, 0);
+    int64_t first_free = -1;
     // get an item
+    int64_t index = probe_index(table, h, 0);
     tb_hash_table_item *item = table->items[index];
-    while (item != NULL) {
+    while (item != NULL && try <= table->allocated) {
         // check if an item is not EMPTY_ITEM
         if (item != EMPTY_ITEM) {
             // check key and item.key
-            if (strcmp(item->key, key) == 0) {
-                // return a value by key
-                return item;
+            if (keys_equal(table, item->key, key, length)) {
+                return index;
             }
             ch++;
+        } else if (first_free < 0) {
+            first_free = index;
         }
         if (ch == table->count) {
             break;
         }
         // get a new item, +1 attempts
-        index = hash(key, table->allocated, try);
+        index = probe_index(table, h, try);
         item = table->items[index];
         ++try;
     }
-    // if nothing if found, return NULL
-    return NULL;
+    if (free_slot != NULL) {
+        // all items are seen, but the free slot is further
+        while (first_free < 0 && item != NULL && item != EMPTY_ITEM && try <= table->allocated) {
+            index = probe_index(table, h, try);
+            item = table->items[index];
+            ++try;
+        }
+        if (first_free < 0 && (item == NULL || item == EMPTY_ITEM)) {
+            first_free = index;
+        }
+        *free_slot = first_free;
+    }
+    // if nothing if found, return -1
+    return -1;
 }
 
-/* 
-    The function removes a value by key from table.
-    Returns 1 if the deletion is successful, otherwise returns 0.
-    Also, if the key is not in the table, returns 0.
-*/
-int tb_delete_item(tb_hash_table *table, const char *key) {
-    if (table->count) {
-        uint32_t ch = 0;
-        // number of attempts
-        uint32_t try = 1;
-        // get a new hash
-        int64_t index = hash(key, table->allocated, 0);
-        // get an item
-        tb_hash_table_item *item = table->items[index];
-        while (item != NULL) {
-            if (item != EMPTY_ITEM) {
-                if (strcmp(item->key, key) == 0) {
-                    // remove an item from memory
-                    tb_delete_table_item(item);
-                    // set this item is EMPTY_ITEM to table
-                    table->items[index] = EMPTY_ITEM;
-                    // set a new count of items into table
-                    --table->count;
-                    if (!table->count) {
-                        table->empty = 1;
-                    }
-                    // stop iteration
-                    return 1;
-                }
-                ch++;
+/*
+    A static function, searches the slot of a key, `h` is its hash.
+    Returns the slot, or -1 if the key is not in the table.
+ */
+static int64_t find_slot_at(const tb_hash_table * const table, const char *key, 
+        size_t length, uint64_t h) {
+    return probe_slot(table, key, length, h, NULL);
+}
+
+/*
+    A static function, searches the slot of a key.
+    Returns the slot, or -1 if the key is not in the table.
+ */
+static int64_t find_slot(const tb_hash_table * const table, const char *key) {
+    return find_slot_at(table, key, KEY_NUL, key_hash(table, key));
+}
+
+/*
+    A static function, moves an item to the head of the `TB_LRU` list.
+    Nothing to returns.
+ */
+static void lru_push_front(tb_hash_table *table, tb_cache_item *item) {
+    item->prev = NULL;
+    item->next = table->lru_head;
+    if (table->lru_head != NULL) {
+        ((tb_cache_item *)table->lru_head)->prev = item;
+    } else {
+        table->lru_tail = item;
+    }
+    table->lru_head = item;
+}
+
+/*
+    A static function, removes an item from the `TB_LRU` list.
+    Nothing to returns.
+ */
+static void lru_unlink(tb_hash_table *table, tb_cache_item *item) {
+    if (item->prev != NULL) {
+        item->prev->next = item->next;
+    } else {
+        table->lru_head = item->next;
+    }
+    if (item->next != NULL) {
+        item->next->prev = item->prev;
+    } else {
+        table->lru_tail = item->prev;
+    }
+}
+
+/*
+    A static function, makes an item the most recently used one.
+    Nothing to returns.
+ */
+static void lru_touch(tb_hash_table *table, tb_hash_table_item *item) {
+    if (table->lru_head != item) {
+        lru_unlink(table, (tb_cache_item *)item);
+        lru_push_front(table, (tb_cache_item *)item);
+    }
+}
+
+/*
+    A static function, saves the page of a slot into every snapshot 
+    of the table, which has not saved it yet. It is called before 
+    the slot is changed, so snapshots keep the slots of their time.
+    The page is published before the slot changes, a reader of 
+    the new slot sees the saved page.
+    Returns 1 if success, otherwise 0, if a page can not be saved.
+ */
+static int snapshot_touch(tb_hash_table *table, uint32_t index) {
+    uint32_t page = index >> SNAPSHOT_PAGE_SHIFT;
+    for (tb_table_snapshot *snapshot = table->snapshots; snapshot != NULL; snapshot = snapshot->next) {
+        if (snapshot->pages[page] != NULL) {
+            continue;
+        }
+        uint32_t first = page << SNAPSHOT_PAGE_SHIFT;
+        uint32_t slots = table->allocated - first < SNAPSHOT_PAGE_SLOTS 
+            ? table->allocated - first : SNAPSHOT_PAGE_SLOTS;
+        tb_hash_table_item **copy = (tb_hash_table_item **)malloc(slots * sizeof(tb_hash_table_item *));
+        if (copy == NULL) {
+            return 0;
+        }
+        memcpy(copy, table->items + first, slots * sizeof(tb_hash_table_item *));
+        __atomic_store_n(&snapshot->pages[page], copy, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+/*
+    A static function, puts an item into the new slots of a rehash, 
+    see `tb_rehash_step`. If `old` is not NULL, it is searched there 
+    and replaced by `item`, EMPTY_ITEM `item` removes it.
+    Nothing to returns.
+ */
+static void rehash_put(tb_hash_table *table, tb_hash_table_item *old, tb_hash_table_item *item) {
+    uint64_t h = key_hash(table, old != NULL ? old->key : item->key);
+    int64_t first_free = -1;
+    for (uint32_t try = 0; try < table->rehash_allocated; ++try) {
+        uint32_t index = probe_index_in(table->probing, table->rehash_allocated, h, try);
+        tb_hash_table_item *slot = table->rehash[index];
+        if (old != NULL && slot == old) {
+            table->rehash[index] = item;
+            table->rehash_tombstones += item == EMPTY_ITEM;
+            return;
+        }
+        if (slot == NULL || slot == EMPTY_ITEM) {
+            if (first_free < 0) {
+                first_free = index;
             }
-            if (ch == table->count) {
+            if (slot == NULL) {
                 break;
             }
-            // get a new item, +1 attempts
-            index = hash(key, table->allocated, try);
-            item = table->items[index];
-            ++try;
         }
     }
+    if (item != EMPTY_ITEM && first_free >= 0) {
+        table->rehash_tombstones -= table->rehash[first_free] == EMPTY_ITEM;
+        table->rehash[first_free] = item;
+    }
+}
+
+/*
+    A static function, writes a slot of the table.
+    If the table has snapshots, the page is saved first. 
+    The tombstones are counted, a running rehash gets the change, 
+    if the slot is moved already.
+    Returns 1 if success, otherwise 0, if the page can not be saved, 
+    then the table is not changed.
+ */
+static inline int set_slot(tb_hash_table *table, uint32_t index, tb_hash_table_item *item) {
+    if (table->snapshots != NULL && !snapshot_touch(table, index)) {
+        return 0;
+    }
+    tb_hash_table_item *old = table->items[index];
+    if (old == EMPTY_ITEM) {
+        --table->tombstones;
+    }
+    if (item == EMPTY_ITEM) {
+        ++table->tombstones;
+    }
+    if (table->rehash != NULL && index < table->rehash_cursor) {
+        // the slot is moved already, the new slots get the change
+        int known = old != NULL && old != EMPTY_ITEM;
+        if (known || (item != NULL && item != EMPTY_ITEM)) {
+            rehash_put(table, known ? old : NULL, item != NULL ? item : EMPTY_ITEM);
+        }
+    }
+    if (table->snapshots != NULL) {
+        __atomic_store_n(&table->items[index], item, __ATOMIC_RELEASE);
+        return 1;
+    }
+    table->items[index] = item;
+    return 1;
+}
+
+/*
+    A static function, makes room for `count` more removed items, 
+    which snapshots of the table can read, see `release_item`.
+    Returns 1 if success, otherwise 0.
+ */
+static int defer_reserve(tb_hash_table *table, uint32_t count) {
+    if (table->snapshots == NULL || table->deferred_capacity - table->deferred_count >= count) {
+        return 1;
+    }
+    uint64_t capacity = table->deferred_capacity ? table->deferred_capacity : 64;
+    while (capacity - table->deferred_count < count) {
+        capacity *= 2;
+    }
+    if (capacity > UINT32_MAX) {
+        return 0;
+    }
+    tb_hash_table_item **deferred = (tb_hash_table_item **)realloc(table->deferred, 
+            (size_t)capacity * sizeof(tb_hash_table_item *));
+    if (deferred == NULL) {
+        return 0;
+    }
+    table->deferred = deferred;
+    table->deferred_capacity = (uint32_t)capacity;
+    return 1;
+}
+
+/*
+    A static function, frees a removed item. If the table has snapshots, 
+    they can still read it, so it is freed with the last snapshot, 
+    the room for it is made by `defer_reserve` before the removal.
+    Nothing to returns.
+ */
+static void release_item(tb_hash_table *table, tb_hash_table_item *item) {
+    if (table->snapshots == NULL) {
+        tb_delete_table_item(table, item);
+        return;
+    }
+    table->deferred[table->deferred_count++] = item;
+}
+
+/*
+    A static function, puts `item`, a new copy of the item in `slot`, 
+    into the slot, snapshots read the old item, the caller releases it.
+    If the memory of the snapshots can not be allocated, the copy is freed.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+static int replace_slot(tb_hash_table *table, int64_t slot, tb_hash_table_item *item) {
+    if (!defer_reserve(table, 1) || !set_slot(table, (uint32_t)slot, item)) {
+        tb_delete_table_item(table, item);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+    A static function, the bookkeeping of a lookup in a `TB_LRU` table.
+    A found item becomes the most recently used one.
+    Nothing to returns.
+ */
+static void cache_access(tb_hash_table *table, tb_hash_table_item *item) {
+    if (item == NULL) {
+        ++table->misses;
+        return;
+    }
+    ++table->hits;
+    lru_touch(table, item);
+}
+
+/*
+    A static function, removes the item in `slot` from the table.
+    Returns 1 if success, otherwise 0, if the memory of snapshots 
+    can not be allocated, then the table is not changed.
+ */
+static int remove_slot(tb_hash_table *table, int64_t slot) {
+    tb_hash_table_item *item = table->items[slot];
+    // set this item is EMPTY_ITEM to table
+    if (!defer_reserve(table, 1) || !set_slot(table, (uint32_t)slot, EMPTY_ITEM)) {
+        return 0;
+    }
+    if (table->flags & TB_LRU) {
+        lru_unlink(table, (tb_cache_item *)item);
+    }
+    filter_remove(table, item->key);
+    // remove an item from memory
+    release_item(table, item);
+    // set a new count of items into table
+    --table->count;
+    if (!table->count) {
+        table->empty = 1;
+    }
+    return 1;
+}
+
+/*
+    A static function, removes the least recently used item 
+    from a full `TB_LRU` table.
+    Returns 1 if success, otherwise 0, see `remove_slot`.
+ */
+static int cache_evict(tb_hash_table *table) {
+    tb_cache_item *victim = (tb_cache_item *)table->lru_tail;
+    if (!remove_slot(table, find_slot(table, victim->item.key))) {
+        return 0;
+    }
+    ++table->evictions;
+    return 1;
+}
+
+/*
+    A static function, the default clock of `TB_TTL` tables.
+    Returns the monotonic time in milliseconds.
+ */
+static uint64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/*
+    A static function, checks an item of a `TB_TTL` table.
+    Returns 1 if the item is expired at `now`, otherwise 0.
+ */
+static inline int is_expired(const tb_hash_table_item *item, uint64_t now) {
+    uint64_t expires = ((const tb_cache_item *)item)->expires;
+    return expires && expires <= now;
+}
+
+/*
+    A static function, the clock of traced operations.
+    Returns the time stamp counter on x86, the virtual counter on ARM64, 
+    otherwise the monotonic time in nanoseconds.
+ */
+static inline uint64_t trace_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/*
+    A static function, reports a traced operation to the callback 
+    of the table and to the USDT probe of the operation.
+    `length` is the length of the key, or KEY_NUL.
+    Nothing to returns.
+ */
+static void trace_emit(const tb_hash_table * const table, uint32_t operation, const char *key, 
+        size_t length, uint32_t probes, uint64_t cycles) {
+    switch (operation) {
+    case TB_TRACE_INSERT:
+        USDT_PROBE(insert, table, key, probes, cycles);
+        break;
+    case TB_TRACE_GET:
+        USDT_PROBE(get, table, key, probes, cycles);
+        break;
+    case TB_TRACE_DELETE:
+        USDT_PROBE(delete, table, key, probes, cycles);
+        break;
+    default:
+        USDT_PROBE(resize, table, key, probes, cycles);
+        break;
+    }
+    if (table->trace != NULL) {
+        tb_trace_event event = {operation, probes, cycles, key, 
+            key == NULL ? 0 : length == KEY_NUL ? strlen(key) : length};
+        table->trace(table, &event, table->trace_context);
+    }
+}
+
+/*
+    A static function, removes expired items from a `TB_TTL` table.
+    Checks at most `slots` slots, starting after the previous call.
+    Returns the number of removed items.
+ */
+static uint32_t expire_step(tb_hash_table *table, uint32_t slots) {
+    uint32_t removed = 0;
+    uint64_t now = table->clock();
+    if (slots > table->allocated) {
+        slots = table->allocated;
+    }
+    for (uint32_t i = 0; i < slots && table->count; ++i) {
+        uint32_t slot = table->expire_cursor;
+        table->expire_cursor = slot + 1 < table->allocated ? slot + 1 : 0;
+        tb_hash_table_item *item = table->items[slot];
+        if (item != NULL && item != EMPTY_ITEM && is_expired(item, now)) {
+            if (!remove_slot(table, slot)) {
+                break;
+            }
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+/*
+    A static function, drops the new slots of a running rehash, 
+    the table keeps its slots.
+    Nothing to returns.
+ */
+static void rehash_abort(tb_hash_table *table) {
+    if (table->rehash != NULL) {
+        region_free(table->memory, table->rehash, 
+                table->rehash_allocated * sizeof(tb_hash_table_item *));
+        table->rehash = NULL;
+    }
+    table->rehash_allocated = table->rehash_cursor = table->rehash_tombstones = 0;
+}
+
+/*
+    A static function, starts a rehash of the table into `allocated` new slots.
+    The slots of the table are moved by `rehash_step`.
+    Returns 1 if the rehash is started, otherwise returns 0.
+ */
+static int rehash_start(tb_hash_table *table, uint32_t allocated) {
+    rehash_abort(table);
+    table->rehash = (tb_hash_table_item **)region_alloc(table->memory, table->numa_nodes, 
+            allocated * sizeof(tb_hash_table_item *));
+    if (table->rehash == NULL) {
+        return 0;
+    }
+    table->rehash_allocated = allocated;
+    return 1;
+}
+
+/*
+    A static function, moves at most `slots` slots of the table into 
+    the new slots of the rehash. The last step replaces the slots of the table
+    by the new ones, they have no tombstones, except of removals of the rehash.
+    Returns the number of slots, which are left to move.
+ */
+static uint32_t rehash_step(tb_hash_table *table, uint32_t slots) {
+    for (; slots && table->rehash_cursor < table->allocated; --slots) {
+        tb_hash_table_item *item = table->items[table->rehash_cursor++];
+        if (item != NULL && item != EMPTY_ITEM) {
+            rehash_put(table, NULL, item);
+        }
+    }
+    if (table->rehash_cursor < table->allocated) {
+        return table->allocated - table->rehash_cursor;
+    }
+    region_free(table->memory, table->items, table->allocated * sizeof(tb_hash_table_item *));
+    table->items = table->rehash;
+    table->allocated = table->rehash_allocated;
+    table->tombstones = table->rehash_tombstones;
+    table->expire_cursor = 0;
+    table->rehash = NULL;
+    rehash_abort(table);
     return 0;
 }
 
 /*
-    The function assign NULL to the pointer to the table.
-    Nothing of returns.
+    A static function, the rehash work of an insertion or a deletion:
+    the next slots of a running rehash are moved, otherwise a purge 
+    of tombstones starts, if they are too many.
+    Nothing to returns.
  */
-static void delete_table(tb_hash_table **ptr) {
-    free((*ptr)->items);
-    free(*ptr);
-    *ptr = NULL;
+static inline void rehash_maintain(tb_hash_table *table) {
+    if (table->rehash != NULL) {
+        rehash_step(table, REHASH_STEP_SLOTS);
+    } else if (table->tombstones > table->allocated / PURGE_TOMBSTONES_SHARE 
+            && table->snapshots == NULL) {
+        rehash_start(table, table->allocated);
+    }
 }
 
-/* 
-    The function removes the table from memory.
-    Nothing of returns.
-*/
-void tb_delete_hash_table(tb_hash_table *table) {
-    // iteration over all items
-    for (uint32_t index = 0; index < table->size; ++index) {
-        tb_hash_table_item * item = table->items[index];
-        // check if an item is not EMPTY_ITEM or an item is not NULL
-        if (item && item != EMPTY_ITEM) {
-            // remove an item from memory
-            tb_delete_table_item(item);
+/*
+    A static function, gets the item by key, `h` is its hash.
+    `TB_LRU` tables count hits and misses and update the recency,
+    so this function changes them through a cast of the const table,
+    the lookups of `TB_LRU` tables are writes, see hashtable.h.
+    Expired items of `TB_TTL` tables are not returned.
+    Returns the pointer to the item, or NULL.
+ */
+static tb_hash_table_item *lookup_item(const tb_hash_table * const table, const char *key, 
+        size_t length, uint64_t h) {
+    int64_t slot = filter_may_contain(table, h) ? find_slot_at(table, key, length, h) : -1;
+    tb_hash_table_item *item = slot >= 0 ? table->items[slot] : NULL;
+    if (item && (table->flags & TB_TTL) && is_expired(item, table->clock())) {
+        item = NULL;
+    }
+    if (table->flags & TB_LRU) {
+        cache_access((tb_hash_table *)table, item);
+    }
+    return item;
+}
+
+/*
+    A static function, the tag of a key in a `TB_CUCKOO` table.
+    Returns the upper 16 bits of the hash, never 0.
+ */
+static inline uint16_t cuckoo_tag(uint64_t h) {
+    uint16_t tag = (uint16_t)(h >> 48);
+    return tag ? tag : 1;
+}
+
+/*
+    A static function, the other bucket of a key in a `TB_CUCKOO` table.
+    It depends only on the bucket and the tag, so an item can be moved 
+    without the hash of its key, and the other bucket of the result is `bucket`.
+    Returns the bucket.
+ */
+static inline uint32_t cuckoo_alt(const tb_hash_table * const table, uint32_t bucket, uint16_t tag) {
+    return (bucket ^ (tag * 0x5bd1e995u)) & table->bucket_mask;
+}
+
+/*
+    A static function, searches a key in a `TB_CUCKOO` table, `h` is its hash.
+    Only two buckets are read, and the stash, if it is not empty.
+    Writes the bucket and the slot of the key, the bucket is NULL for the stash.
+    Returns 1 if the key is found, otherwise 0.
+ */
+static int cuckoo_find(const tb_hash_table * const table, const char *key, size_t length, 
+        uint64_t h, tb_cuckoo_bucket **bucket, uint32_t *slot) {
+    tb_cuckoo_bucket *buckets = (tb_cuckoo_bucket *)table->buckets;
+    uint16_t tag = cuckoo_tag(h);
+    uint32_t first = (uint32_t)h & table->bucket_mask;
+    uint32_t second = cuckoo_alt(table, first, tag);
+    __builtin_prefetch(&buckets[second]);
+    tb_cuckoo_bucket *candidates[2] = {&buckets[first], &buckets[second]};
+    for (int i = 0; i < 2; ++i) {
+        for (uint32_t s = 0; s < CUCKOO_SLOTS; ++s) {
+            if (candidates[i]->tags[s] == tag && keys_equal(table, candidates[i]->items[s]->key, key, length)) {
+                *bucket = candidates[i];
+                *slot = s;
+                return 1;
+            }
         }
     }
-    // remove the table from memory
-    delete_table(&table);
-}   
+    for (uint32_t s = 0; s < table->stash_count; ++s) {
+        if (keys_equal(table, table->stash[s]->key, key, length)) {
+            *bucket = NULL;
+            *slot = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+    A static function, gets the item by key from a `TB_CUCKOO` table.
+    Returns the pointer to the item, or NULL.
+ */
+static tb_hash_table_item *cuckoo_get_item(const tb_hash_table * const table, 
+        const char *key, size_t length) {
+    tb_cuckoo_bucket *bucket;
+    uint32_t slot;
+    if (!cuckoo_find(table, key, length, key_hash_n(table, key, length), &bucket, &slot)) {
+        return NULL;
+    }
+    return bucket ? bucket->items[slot] : table->stash[slot];
+}
+
+/*
+    A static function, puts an item into a free slot of a bucket.
+    Returns 1 if the bucket has a free slot, otherwise 0.
+ */
+static inline int cuckoo_put(tb_cuckoo_bucket *bucket, uint16_t tag, tb_hash_table_item *item) {
+    for (uint32_t s = 0; s < CUCKOO_SLOTS; ++s) {
+        if (!bucket->tags[s]) {
+            bucket->tags[s] = tag;
+            bucket->items[s] = item;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void cuckoo_place(tb_hash_table *table, tb_hash_table_item *item, uint64_t h);
+
+/*
+    A static function, doubles the buckets of a `TB_CUCKOO` table 
+    and places all items again. The stash becomes empty.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+static int cuckoo_grow(tb_hash_table *table) {
+    uint32_t count = table->bucket_mask + 1;
+    tb_cuckoo_bucket *old = (tb_cuckoo_bucket *)table->buckets;
+    tb_cuckoo_bucket *buckets = (tb_cuckoo_bucket *)region_alloc(table->memory, table->numa_nodes, 
+            (size_t)count * 2 * sizeof(tb_cuckoo_bucket));
+    if (buckets == NULL) {
+        return 0;
+    }
+    tb_hash_table_item *stash[CUCKOO_STASH];
+    uint32_t stash_count = table->stash_count;
+    memcpy(stash, table->stash, stash_count * sizeof(tb_hash_table_item *));
+    table->buckets = buckets;
+    table->bucket_mask = count * 2 - 1;
+    table->allocated = count * 2 * CUCKOO_SLOTS;
+    table->stash_count = 0;
+    for (uint32_t b = 0; b < count; ++b) {
+        for (uint32_t s = 0; s < CUCKOO_SLOTS; ++s) {
+            if (old[b].tags[s]) {
+                tb_hash_table_item *item = old[b].items[s];
+                cuckoo_place(table, item, key_hash(table, item->key));
+            }
+        }
+    }
+    for (uint32_t s = 0; s < stash_count; ++s) {
+        cuckoo_place(table, stash[s], key_hash(table, stash[s]->key));
+    }
+    region_free(table->memory, old, (size_t)count * sizeof(tb_cuckoo_bucket));
+    return 1;
+}
+
+/*
+    A static function, places a new item into a `TB_CUCKOO` table, `h` is 
+    the hash of its key. If both buckets are full, the items are moved 
+    to their other buckets, at most CUCKOO_MAX_KICKS times. 
+    The last moved item goes to the stash, if the stash is full, 
+    the buckets are doubled.
+    Nothing to returns.
+ */
+static void cuckoo_place(tb_hash_table *table, tb_hash_table_item *item, uint64_t h) {
+    tb_cuckoo_bucket *buckets = (tb_cuckoo_bucket *)table->buckets;
+    uint16_t tag = cuckoo_tag(h);
+    uint32_t bucket = (uint32_t)h & table->bucket_mask;
+    uint32_t other = cuckoo_alt(table, bucket, tag);
+    if (cuckoo_put(&buckets[bucket], tag, item) || cuckoo_put(&buckets[other], tag, item)) {
+        return;
+    }
+    // a random walk, the victims are chosen by xorshift from the hash
+    uint64_t random = h | 1;
+    bucket = (h >> 32) & 1 ? other : bucket;
+    for (uint32_t kick = 0; kick < CUCKOO_MAX_KICKS; ++kick) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        uint32_t victim = (uint32_t)(random >> 32) % CUCKOO_SLOTS;
+        uint16_t victim_tag = buckets[bucket].tags[victim];
+        tb_hash_table_item *victim_item = buckets[bucket].items[victim];
+        buckets[bucket].tags[victim] = tag;
+        buckets[bucket].items[victim] = item;
+        tag = victim_tag;
+        item = victim_item;
+        bucket = cuckoo_alt(table, bucket, tag);
+        if (cuckoo_put(&buckets[bucket], tag, item)) {
+            return;
+        }
+    }
+    if (table->stash_count < CUCKOO_STASH) {
+        table->stash[table->stash_count++] = item;
+        return;
+    }
+    uint64_t begin = TRACE_ACTIVE(table, resize) ? trace_cycles() : 0;
+    if (!cuckoo_grow(table)) {
+        // it must not lose an item of the table
+        printf("Error: can not allocate memory for the hashtable!");
+        SEGV;
+    }
+    if (TRACE_ACTIVE(table, resize)) {
+        trace_emit(table, TB_TRACE_RESIZE, NULL, 0, table->allocated, trace_cycles() - begin);
+    }
+    cuckoo_place(table, item, key_hash(table, item->key));
+}
+
+/*
+    A static function, inserts a value by key into a `TB_CUCKOO` table.
+    An existing key gets a new value, its old value is written into `old`,
+    if it is not NULL.
+    Returns the item, or NULL if the table is full.
+ */
+static tb_hash_table_item *cuckoo_insert(tb_hash_table *table, const char *key, 
+        size_t length, const void *val, void *old) {
+    uint64_t h = key_hash_n(table, key, length);
+    tb_cuckoo_bucket *bucket;
+    uint32_t slot;
+    if (cuckoo_find(table, key, length, h, &bucket, &slot)) {
+        tb_hash_table_item *item = bucket ? bucket->items[slot] : table->stash[slot];
+        if (old != NULL) {
+            memcpy(old, item->val, sizeof(void *));
+        }
+        memcpy(item->val, val, sizeof(void *));
+        return item;
+    }
+    if (table->size == table->count) {
+        printf("Error: hastable is full! Skip insert operation!");
+        return NULL;
+    }
+    tb_hash_table_item *item = tb_new_table_item_n(table, key, length, val);
+    cuckoo_place(table, item, h);
+    ++table->count;
+    table->empty = 0;
+    return item;
+}
+
+/*
+    A static function, removes a value by key from a `TB_CUCKOO` table.
+    The removed value is written into `val`, if it is not NULL.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+static int cuckoo_delete(tb_hash_table *table, const char *key, size_t length, void *val) {
+    tb_cuckoo_bucket *bucket;
+    uint32_t slot;
+    if (!cuckoo_find(table, key, length, key_hash_n(table, key, length), &bucket, &slot)) {
+        return 0;
+    }
+    if (val != NULL) {
+        memcpy(val, (bucket ? bucket->items[slot] : table->stash[slot])->val, sizeof(void *));
+    }
+    if (bucket) {
+        tb_delete_table_item(table, bucket->items[slot]);
+        bucket->tags[slot] = 0;
+        bucket->items[slot] = NULL;
+    } else {
+        tb_delete_table_item(table, table->stash[slot]);
+        table->stash[slot] = table->stash[--table->stash_count];
+    }
+    if (!--table->count) {
+        table->empty = 1;
+    }
+    return 1;
+}
+
+/*
+    A static function, gets the item at an iteration position of 
+    a `TB_CUCKOO` table. The slots of the buckets are followed by the stash.
+    Returns the item, or NULL if the slot is free.
+ */
+static inline tb_hash_table_item *cuckoo_item_at(const tb_hash_table * const table, uint32_t position) {
+    if (position >= table->allocated) {
+        return table->stash[position - table->allocated];
+    }
+    tb_cuckoo_bucket *bucket = (tb_cuckoo_bucket *)table->buckets + position / CUCKOO_SLOTS;
+    return bucket->tags[position % CUCKOO_SLOTS] ? bucket->items[position % CUCKOO_SLOTS] : NULL;
+}
+
+/*
+    A static function, the number of slots of a table of `size` items.
+    It is a power of two, the slot is a mask of the hash.
+    Returns the number of slots, or 0 if it is too big.
+ */
+static uint32_t capacity_for(uint32_t size) {
+    uint64_t needed = (uint64_t)(size * (1 + PERCENT_FREE_BACKETS));
+    uint64_t allocated = 1;
+    while (allocated < needed) {
+        allocated <<= 1;
+    }
+    return allocated > ((uint64_t)1 << 31) ? 0 : (uint32_t)allocated;
+}
+
+/*
+    A static function, moves the items of an open addressing table into 
+    `allocated` new slots at once, tombstones are dropped.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+static int rebuild_slots(tb_hash_table *table, uint32_t allocated) {
+    tb_hash_table_item **items = (tb_hash_table_item **)region_alloc(table->memory, 
+            table->numa_nodes, allocated * sizeof(tb_hash_table_item *));
+    if (items == NULL) {
+        return 0;
+    }
+    // the rebuild replaces a running rehash
+    rehash_abort(table);
+    tb_hash_table_item **old = table->items;
+    uint32_t old_allocated = table->allocated;
+    table->items = items;
+    table->allocated = allocated;
+    for (uint32_t index = 0; index < old_allocated; ++index) {
+        tb_hash_table_item *item = old[index];
+        if (item != NULL && item != EMPTY_ITEM) {
+            uint64_t h = key_hash(table, item->key);
+            uint32_t try = 0;
+            while (items[probe_index(table, h, try)] != NULL) {
+                ++try;
+            }
+            items[probe_index(table, h, try)] = item;
+        }
+    }
+    region_free(table->memory, old, old_allocated * sizeof(tb_hash_table_item *));
+    table->expire_cursor = 0;
+    table->tombstones = 0;
+    return 1;
+}
+
+/*
+    A static function, makes room for one more item in the slots of 
+    a table, which `tb_shrink_to_fit` made smaller than its size. 
+    The slots grow for twice the items, at most for the size. 
+    A table with snapshots can not grow.
+    Returns 1 if success, otherwise 0.
+ */
+static int grow_slots(tb_hash_table *table) {
+    if (table->snapshots != NULL) {
+        return 0;
+    }
+    uint64_t size = ((uint64_t)table->count + 1) * 2;
+    uint32_t allocated = capacity_for(size < table->size ? (uint32_t)size : table->size);
+    return allocated && rebuild_slots(table, allocated);
+}
+
+/*
+    A static function, allocates the filter of a `TB_FILTER` table 
+    for `size` keys and adds all keys of the table to it.
+    Expired items are added too, their removal removes them from the filter.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+static int filter_rebuild(tb_hash_table *table, uint32_t size) {
+    uint32_t blocks = (size + FILTER_KEYS_PER_BLOCK - 1) / FILTER_KEYS_PER_BLOCK;
+    uint8_t *filter = (uint8_t *)aligned_alloc(FILTER_BLOCK_BYTES, (size_t)blocks * FILTER_BLOCK_BYTES);
+    if (filter == NULL) {
+        return 0;
+    }
+    memset(filter, 0, (size_t)blocks * FILTER_BLOCK_BYTES);
+    free(table->filter);
+    table->filter = filter;
+    table->filter_blocks = blocks;
+    if (table->flags & TB_COMPACT) {
+        for (uint32_t position = 0; position < table->used; ++position) {
+            if (table->entries[position].key != NULL) {
+                filter_add(table, table->entries[position].key);
+            }
+        }
+    } else {
+        for (uint32_t index = 0; index < table->allocated; ++index) {
+            tb_hash_table_item *item = table->items[index];
+            if (item != NULL && item != EMPTY_ITEM) {
+                filter_add(table, item->key);
+            }
+        }
+    }
+    return 1;
+}
+
+/* 
+    The function creates a new table in memory.
+    Returns a pointer to the table.
+*/
+tb_hash_table *tb_create_hash_table(uint32_t size) {
+    return tb_create_hash_table_ex(size, NULL);
+}
+
+/*
+    The function creates a new table in memory with options.
+    `options` can be NULL, then it is the same as `tb_create_hash_table`.
+    Returns a pointer to the table, or NULL.
+ */
+tb_hash_table *tb_create_hash_table_ex(uint32_t size, const tb_hash_table_options *options) {
+    if (size > 0) {
+        tb_hash_table *table = (tb_hash_table *)calloc(1, sizeof(tb_hash_table));
+        if (table == NULL) {
+            return NULL;
+        }
+        // size_t is unsigned int
+        table->size = size;
+        table->count = 0;
+        table->empty = 1;
+        table->flags = options ? options->flags : 0;
+        table->memory = options ? options->memory : 0;
+        table->numa_nodes = options ? options->numa_nodes : 0;
+        if ((table->flags & (TB_LRU | TB_TTL)) && (table->flags & TB_COMPACT)) {
+            free(table);
+            return NULL;
+        }
+        if ((table->flags & TB_CUCKOO) 
+                && (table->flags & (TB_COMPACT | TB_LRU | TB_TTL | TB_FILTER))) {
+            free(table);
+            return NULL;
+        }
+        if ((table->flags & TB_MULTI) 
+                && (table->flags & (TB_COMPACT | TB_CUCKOO | TB_LRU | TB_TTL))) {
+            free(table);
+            return NULL;
+        }
+        if (table->flags & TB_FILTER) {
+            table->filter_blocks = (size + FILTER_KEYS_PER_BLOCK - 1) / FILTER_KEYS_PER_BLOCK;
+            table->filter = (uint8_t *)aligned_alloc(FILTER_BLOCK_BYTES, 
+                    (size_t)table->filter_blocks * FILTER_BLOCK_BYTES);
+            if (table->filter == NULL) {
+                free(table);
+                return NULL;
+            }
+            memset(table->filter, 0, (size_t)table->filter_blocks * FILTER_BLOCK_BYTES);
+        }
+        if (table->flags & TB_SEEDED) {
+            if (options->seed[0] || options->seed[1]) {
+                table->seed[0] = options->seed[0];
+                table->seed[1] = options->seed[1];
+            } else {
+                random_seed(table->seed);
+            }
+        }
+        if (table->flags & TB_TTL) {
+            table->ttl = options->ttl;
+            table->clock = options->clock ? options->clock : monotonic_ms;
+        }
+        table->probing = options ? options->probing : TB_PROBE_DOUBLE;
+        if (table->probing > TB_PROBE_LINEAR) {
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+        table->allocated = capacity_for(size);
+        if (!table->allocated) {
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+        if (table->flags & TB_CUCKOO) {
+            table->allocated = table->allocated < CUCKOO_SLOTS ? CUCKOO_SLOTS : table->allocated;
+            table->bucket_mask = table->allocated / CUCKOO_SLOTS - 1;
+            size_t bytes = (size_t)(table->bucket_mask + 1) * sizeof(tb_cuckoo_bucket);
+            table->buckets = region_alloc(table->memory, table->numa_nodes, bytes);
+            table->stash = (tb_hash_table_item **)malloc(CUCKOO_STASH * sizeof(tb_hash_table_item *));
+            if (table->buckets == NULL || table->stash == NULL) {
+                region_free(table->memory, table->buckets, bytes);
+                free(table->stash);
+                free(table);
+                return NULL;
+            }
+            return table;
+        }
+        if (table->flags & TB_COMPACT) {
+            // the positions are less than `allocated`
+            table->index_width = table->allocated - 1 <= INT8_MAX ? 1 
+                : table->allocated - 1 <= INT16_MAX ? 2 : 4;
+            table->entries = (tb_hash_table_item *)region_alloc(table->memory, table->numa_nodes, 
+                    table->allocated * sizeof(tb_hash_table_item));
+            table->index = region_alloc(table->memory, table->numa_nodes, 
+                    (size_t)table->allocated * table->index_width);
+            if (table->entries == NULL || table->index == NULL) {
+                region_free(table->memory, table->entries, table->allocated * sizeof(tb_hash_table_item));
+                region_free(table->memory, table->index, (size_t)table->allocated * table->index_width);
+                free(table->filter);
+                free(table);
+                return NULL;
+            }
+            memset(table->index, 0xff, (size_t)table->allocated * table->index_width);
+            return table;
+        }
+        // returns a pointer to the allocated memory for all items
+        table->items = (tb_hash_table_item **)region_alloc(table->memory, table->numa_nodes, 
+                table->allocated * sizeof(tb_hash_table_item *));
+        if (table->items == NULL) {
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+        return table;
+    }
+    return NULL;
+}
+
+/*
+    The function creates a copy of the table.
+    The slot array is cloned as is, items stay in the same positions,
+    so nothing is hashed or probed again.
+    Returns a pointer to the new table, or NULL.
+ */
+tb_hash_table *tb_copy_hash_table(const tb_hash_table * const table) {
+    tb_hash_table *copy = (tb_hash_table *)malloc(sizeof(tb_hash_table));
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, table, sizeof(tb_hash_table));
+    memset(copy->pool, 0, sizeof(copy->pool));
+    copy->pooled = 0;
+    copy->snapshots = NULL;
+    copy->deferred = NULL;
+    copy->deferred_count = copy->deferred_capacity = 0;
+    copy->arena = NULL;
+    copy->rehash = NULL;
+    copy->rehash_allocated = copy->rehash_cursor = copy->rehash_tombstones = 0;
+    if (table->flags & TB_FILTER) {
+        size_t bytes = (size_t)table->filter_blocks * FILTER_BLOCK_BYTES;
+        copy->filter = (uint8_t *)aligned_alloc(FILTER_BLOCK_BYTES, bytes);
+        if (copy->filter == NULL) {
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy->filter, table->filter, bytes);
+    }
+    if (table->flags & TB_CUCKOO) {
+        size_t bytes = (size_t)(table->bucket_mask + 1) * sizeof(tb_cuckoo_bucket);
+        copy->buckets = region_alloc(table->memory, table->numa_nodes, bytes);
+        copy->stash = (tb_hash_table_item **)malloc(CUCKOO_STASH * sizeof(tb_hash_table_item *));
+        if (copy->buckets == NULL || copy->stash == NULL) {
+            region_free(table->memory, copy->buckets, bytes);
+            free(copy->stash);
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy->buckets, table->buckets, bytes);
+        tb_cuckoo_bucket *buckets = (tb_cuckoo_bucket *)copy->buckets;
+        for (uint32_t b = 0; b <= table->bucket_mask; ++b) {
+            for (uint32_t s = 0; s < CUCKOO_SLOTS; ++s) {
+                if (buckets[b].tags[s]) {
+                    tb_hash_table_item *item = buckets[b].items[s];
+                    buckets[b].items[s] = tb_new_table_item(copy, item->key, item->val);
+                }
+            }
+        }
+        for (uint32_t s = 0; s < table->stash_count; ++s) {
+            copy->stash[s] = tb_new_table_item(copy, table->stash[s]->key, table->stash[s]->val);
+        }
+        return copy;
+    }
+    if (table->flags & TB_COMPACT) {
+        copy->entries = (tb_hash_table_item *)region_alloc(table->memory, table->numa_nodes, 
+                table->allocated * sizeof(tb_hash_table_item));
+        copy->index = region_alloc(table->memory, table->numa_nodes, 
+                (size_t)table->allocated * table->index_width);
+        if (copy->entries == NULL || copy->index == NULL) {
+            region_free(table->memory, copy->entries, table->allocated * sizeof(tb_hash_table_item));
+            region_free(table->memory, copy->index, (size_t)table->allocated * table->index_width);
+            free(copy->filter);
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy->index, table->index, (size_t)table->allocated * table->index_width);
+        for (uint32_t position = 0; position < table->used; ++position) {
+            tb_hash_table_item *item = &table->entries[position];
+            if (item->key != NULL) {
+                init_table_entry(copy, &copy->entries[position], item->key, KEY_NUL, item->val);
+            } else {
+                copy->entries[position] = *item;
+            }
+        }
+        return copy;
+    }
+    copy->items = (tb_hash_table_item **)region_alloc(table->memory, table->numa_nodes, 
+            table->allocated * sizeof(tb_hash_table_item *));
+    if (copy->items == NULL) {
+        free(copy->filter);
+        free(copy);
+        return NULL;
+    }
+    for (uint32_t index = 0; index < table->allocated; ++index) {
+        tb_hash_table_item *item = table->items[index];
+        // EMPTY_ITEM is kept, it is a part of probe sequences
+        if (item && item != EMPTY_ITEM) {
+            tb_hash_table_item *new_item = table->flags & TB_MULTI 
+                ? &multi_item_copy(copy, (tb_multi_item *)item, ((tb_multi_item *)item)->capacity)->item 
+                : tb_new_table_item(copy, item->key, item->val);
+            if (table->flags & TB_TTL) {
+                ((tb_cache_item *)new_item)->expires = ((tb_cache_item *)item)->expires;
+            }
+            item = new_item;
+        }
+        copy->items[index] = item;
+    }
+    if (table->flags & TB_LRU) {
+        // the same recency order, from the least recently used item
+        copy->lru_head = copy->lru_tail = NULL;
+        for (tb_cache_item *item = table->lru_tail; item != NULL; item = item->prev) {
+            lru_push_front(copy, (tb_cache_item *)copy->items[find_slot(copy, item->item.key)]);
+        }
+    }
+    return copy;
+}
+
+/*
+    Returns the `tb_hash_table_item` object, if an item with this key exists. 
+    Otherwise returns NULL.
+ */
+tb_hash_table_item *tb_find_item(const tb_hash_table * const table, const char *key) {
+    return tb_get_item_n(table, key, KEY_NUL);
+}
+
+/*
+    A static function, sets the expiration of an item of a `TB_TTL` table.
+    `ttl` is in milliseconds, 0 is never.
+    Nothing to returns.
+ */
+static void set_expires(tb_hash_table *table, tb_hash_table_item *item, uint64_t ttl) {
+    ((tb_cache_item *)item)->expires = ttl ? table->clock() + ttl : 0;
+}
+
+static tb_hash_table_item *insert_item(tb_hash_table *table, const char *key, size_t length, 
+        const void *val, uint64_t ttl, void *old);
+
+/* 
+    The function inserts a value by key into the table.
+    If the key exists, the value is replaced in place.
+    If the table is full, `TB_TTL` tables remove expired items first,
+    `TB_LRU` tables evict the least recently used item,
+    other tables skip the insertion.
+    `TB_TTL` tables use the default `ttl` of the table.
+*/
+void tb_insert_item(tb_hash_table *table, const char *key, const void *val) {
+    tb_insert_item_ttl(table, key, val, table->ttl);
+}
+
+/*
+    The function inserts a value by key into the table, see `tb_insert_item`.
+    `ttl` is the time to live in milliseconds, 0 is never.
+    `ttl` is used only by `TB_TTL` tables.
+ */
+void tb_insert_item_ttl(tb_hash_table *table, const char *key, const void *val, uint64_t ttl) {
+    insert_item(table, key, KEY_NUL, val, ttl, NULL);
+}
+
+/*
+    The function inserts a value by the key of `length` bytes, see `tb_insert_item`.
+    The key does not need NUL at the end, but it has no NUL bytes, 
+    the table keeps it with NUL.
+    Returns the inserted or the changed item, or NULL if the table is full.
+ */
+tb_hash_table_item *tb_insert_item_n(tb_hash_table *table, const char *key, 
+        size_t length, const void *val) {
+    return insert_item(table, key, length, val, table->ttl, NULL);
+}
+
+/*
+    The function inserts a value by the key of `length` bytes, see `tb_insert_item_n`.
+    If the key exists, its old value is written into `old` before 
+    the replacement, so the caller can release it with one lookup.
+    `old` is not changed for a new key.
+    Returns the inserted or the changed item, or NULL if the table is full.
+ */
+tb_hash_table_item *tb_exchange_item_n(tb_hash_table *table, const char *key, 
+        size_t length, const void *val, void *old) {
+    return insert_item(table, key, length, val, table->ttl, old);
+}
+
+/*
+    A static function, inserts a value by key into the table, 
+    `length` is the length of the key, or KEY_NUL, see `tb_insert_item_ttl`.
+    The old value of an existing key is written into `old`, if it is not NULL.
+    Returns the item, or NULL if the table is full.
+ */
+static tb_hash_table_item *insert_item_untraced(tb_hash_table *table, const char *key, size_t length, 
+        const void *val, uint64_t ttl, void *old) {
+    if (table->flags & TB_COMPACT) {
+        return compact_insert(table, key, length, val, old);
+    }
+    if (table->flags & TB_CUCKOO) {
+        return cuckoo_insert(table, key, length, val, old);
+    }
+    if (table->flags & TB_TTL) {
+        expire_step(table, EXPIRE_STEP_SLOTS);
+    }
+    rehash_maintain(table);
+    // get hash
+    uint64_t h = key_hash_n(table, key, length);
+    // if an item exists, replace a value by key
+    int64_t free_slot;
+    int64_t slot = probe_slot(table, key, length, h, &free_slot);
+    if (slot >= 0) {
+        tb_hash_table_item *item = table->items[slot];
+        if (old != NULL) {
+            memcpy(old, item->val, sizeof(void *));
+        }
+        if (table->snapshots != NULL) {
+            // snapshots read the old item, the new value is a new item
+            tb_hash_table_item *old = item;
+            if (table->flags & TB_MULTI) {
+                // the first value is set, the others are kept
+                item = &multi_item_copy(table, (tb_multi_item *)old, 
+                        ((tb_multi_item *)old)->capacity)->item;
+                memcpy(item->val, val, sizeof(void *));
+            } else {
+                item = tb_new_table_item(table, old->key, val);
+            }
+            if (!replace_slot(table, slot, item)) {
+                return NULL;
+            }
+            if (table->flags & TB_LRU) {
+                lru_unlink(table, (tb_cache_item *)old);
+                lru_push_front(table, (tb_cache_item *)item);
+            }
+            release_item(table, old);
+        } else {
+            memcpy(item->val, val, sizeof(void *));
+        }
+        if (table->flags & TB_TTL) {
+            set_expires(table, item, ttl);
+        }
+        if (table->flags & TB_LRU) {
+            lru_touch(table, item);
+        }
+        return item;
+    }
+    if (table->size == table->count && (table->flags & TB_TTL)) {
+        // a full sweep, it is rare, only if the table is full
+        expire_step(table, table->allocated);
+    }
+    if (table->size == table->count) {
+        if (!(table->flags & TB_LRU)) {
+            printf("Error: hastable is full! Skip insert operation!");
+            return NULL;
+        }
+        if (!cache_evict(table)) {
+            return NULL;
+        }
+    }
+    uint32_t slots = table->rehash != NULL ? table->rehash_allocated : table->allocated;
+    if ((uint64_t)((table->count + 1) * (1 + PERCENT_FREE_BACKETS)) > slots) {
+        // the slots of `tb_shrink_to_fit` grow back to the size
+        if (!grow_slots(table)) {
+            return NULL;
+        }
+        probe_slot(table, key, length, h, &free_slot);
+    } else if (table->flags & (TB_LRU | TB_TTL)) {
+        // the removed slots can be earlier in the probe sequence
+        probe_slot(table, key, length, h, &free_slot);
+    }
+    int64_t index = free_slot;
+    // set a new item and count
+    tb_hash_table_item *item = tb_new_table_item_n(table, key, length, val);
+    if (!set_slot(table, (uint32_t)index, item)) {
+        tb_delete_table_item(table, item);
+        return NULL;
+    }
+    filter_add(table, item->key);
+    if (table->flags & TB_TTL) {
+        set_expires(table, item, ttl);
+    }
+    if (table->flags & TB_LRU) {
+        lru_push_front(table, (tb_cache_item *)item);
+    }
+    ++table->count;
+    table->empty = 0;
+    return item;
+}
+
+static uint32_t probe_length_n(const tb_hash_table * const table, const char *key, size_t length);
+
+/*
+    A static function, inserts a value by key into the table, 
+    see `insert_item_untraced`, the insertion is traced, if it is on.
+    Returns the item, or NULL if the table is full.
+ */
+static tb_hash_table_item *insert_item(tb_hash_table *table, const char *key, size_t length, 
+        const void *val, uint64_t ttl, void *old) {
+    if (TRACE_ACTIVE(table, insert)) {
+        uint64_t begin = trace_cycles();
+        tb_hash_table_item *item = insert_item_untraced(table, key, length, val, ttl, old);
+        uint64_t cycles = trace_cycles() - begin;
+        trace_emit(table, TB_TRACE_INSERT, key, length, probe_length_n(table, key, length), cycles);
+        return item;
+    }
+    return insert_item_untraced(table, key, length, val, ttl, old);
+}
+
+/*
+    A static function, searches a value by key, `h` is its hash.
+    Returns the pointer to a value, or NULL.
+ */
+static void *get_value_at(const tb_hash_table * const table, const char *key, 
+        size_t length, uint64_t h) {
+    tb_hash_table_item *item = lookup_item(table, key, length, h);
+    return item ? item->val : NULL;
+}
+
+/* 
+    The function gets a value by key.
+    A lookup of a `TB_LRU` table changes its recency and counters.
+    Returns the pointer to a value, if the value by key exists. 
+    Otherwise returns NULL
+*/
+void *tb_get_value(const tb_hash_table * const table, const char *key) {
+    return tb_get_value_n(table, key, KEY_NUL);
+}
+
+/*
+    A static function, gets a value by the key of `length` bytes, 
+    see `tb_get_value_n`, without tracing.
+    Returns the pointer to a value, or NULL.
+ */
+static void *get_value_untraced(const tb_hash_table * const table, const char *key, size_t length) {
+    if (table->empty) {
+        if (table->flags & TB_LRU) {
+            ++((tb_hash_table *)table)->misses;
+        }
+        return NULL;
+    }
+    if (table->flags & (TB_COMPACT | TB_CUCKOO)) {
+        tb_hash_table_item *item = table->flags & TB_COMPACT 
+            ? compact_get_item(table, key, length) : cuckoo_get_item(table, key, length);
+        return item ? item->val : NULL;
+    }
+    return get_value_at(table, key, length, key_hash_n(table, key, length));
+}
+
+/*
+    The function gets a value by the key of `length` bytes, see `tb_get_value`.
+    The key does not need NUL at the end, but it has no NUL bytes.
+    Returns the pointer to a value, or NULL.
+ */
+void *tb_get_value_n(const tb_hash_table * const table, const char *key, size_t length) {
+    if (TRACE_ACTIVE(table, get)) {
+        uint64_t begin = trace_cycles();
+        void *value = get_value_untraced(table, key, length);
+        uint64_t cycles = trace_cycles() - begin;
+        trace_emit(table, TB_TRACE_GET, key, length, probe_length_n(table, key, length), cycles);
+        return value;
+    }
+    return get_value_untraced(table, key, length);
+}
+
+/*
+    The function gets values by `count` keys.
+    Writes the pointer to a value or NULL for each key into `values`.
+    The first slots of the next keys are prefetched, 
+    so the cache misses of several lookups overlap.
+    The lookups of a `TB_LRU` table change it, see `tb_get_value`.
+    Returns the number of found keys.
+ */
+uint32_t tb_get_values(const tb_hash_table * const table, const char * const *keys, 
+        uint32_t count, void **values) {
+    if (table->empty) {
+        memset(values, 0, count * sizeof(void *));
+        return 0;
+    }
+    uint64_t window[BATCH_PREFETCH];
+    uint32_t found = 0;
+    if (table->flags & (TB_COMPACT | TB_LRU | TB_TTL | TB_FILTER | TB_CUCKOO)) {
+        for (uint32_t i = 0; i < count; ++i) {
+            values[i] = tb_get_value(table, keys[i]);
+            found += values[i] != NULL;
+        }
+        return found;
+    }
+    for (uint32_t i = 0; i < count && i < BATCH_PREFETCH; ++i) {
+        window[i] = key_hash(table, keys[i]);
+        __builtin_prefetch(&table->items[probe_index(table, window[i], 0)]);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t h = window[i % BATCH_PREFETCH];
+        uint32_t next = i + BATCH_PREFETCH;
+        if (next < count) {
+            window[next % BATCH_PREFETCH] = key_hash(table, keys[next]);
+            __builtin_prefetch(&table->items[probe_index(table, window[next % BATCH_PREFETCH], 0)]);
+        }
+        values[i] = get_value_at(table, keys[i], KEY_NUL, h);
+        if (values[i] != NULL) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+/* 
+    The function gets the item by key.
+    A lookup of a `TB_LRU` table changes its recency and counters.
+    Returns the pointer to the item, if the item with this key exists. 
+    Otherwise returns NULL
+*/
+tb_hash_table_item *tb_get_item(const tb_hash_table * const table, const char *key) {
+    return tb_get_item_n(table, key, KEY_NUL);
+}
+
+/*
+    A static function, gets the item by the key of `length` bytes, 
+    see `tb_get_item_n`, without tracing.
+    Returns the pointer to the item, or NULL.
+ */
+static tb_hash_table_item *get_item_untraced(const tb_hash_table * const table, 
+        const char *key, size_t length) {
+    if (table->flags & TB_COMPACT) {
+        return compact_get_item(table, key, length);
+    }
+    if (table->flags & TB_CUCKOO) {
+        return cuckoo_get_item(table, key, length);
+    }
+    return lookup_item(table, key, length, key_hash_n(table, key, length));
+}
+
+/*
+    The function gets the item by the key of `length` bytes, see `tb_get_item`.
+    The key does not need NUL at the end, but it has no NUL bytes.
+    Returns the pointer to the item, or NULL.
+ */
+tb_hash_table_item *tb_get_item_n(const tb_hash_table * const table, const char *key, size_t length) {
+    if (TRACE_ACTIVE(table, get)) {
+        uint64_t begin = trace_cycles();
+        tb_hash_table_item *item = get_item_untraced(table, key, length);
+        uint64_t cycles = trace_cycles() - begin;
+        trace_emit(table, TB_TRACE_GET, key, length, probe_length_n(table, key, length), cycles);
+        return item;
+    }
+    return get_item_untraced(table, key, length);
+}
+
+/* 
+    The function removes a value by key from table.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+    Also, if the key is not in the table, returns 0.
+*/
+int tb_delete_item(tb_hash_table *table, const char *key) {
+    return tb_delete_item_n(table, key, KEY_NUL);
+}
+
+/*
+    A static function, removes a value by the key of `length` bytes, 
+    see `tb_delete_item_n`, without tracing.
+    The removed value is written into `val`, if it is not NULL.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+static int delete_item_untraced(tb_hash_table *table, const char *key, size_t length, void *val) {
+    if (table->flags & TB_COMPACT) {
+        return compact_delete(table, key, length, val);
+    }
+    if (table->flags & TB_CUCKOO) {
+        return cuckoo_delete(table, key, length, val);
+    }
+    if (table->flags & TB_TTL) {
+        expire_step(table, EXPIRE_STEP_SLOTS);
+    }
+    rehash_maintain(table);
+    uint64_t h = key_hash_n(table, key, length);
+    if (table->count && filter_may_contain(table, h)) {
+        int64_t slot = find_slot_at(table, key, length, h);
+        if (slot >= 0) {
+            void *removed;
+            memcpy(&removed, table->items[slot]->val, sizeof(void *));
+            if (!remove_slot(table, slot)) {
+                return 0;
+            }
+            if (val != NULL) {
+                memcpy(val, &removed, sizeof(void *));
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+    A static function, removes a value by the key of `length` bytes, 
+    see `delete_item_untraced`, the deletion is traced, if it is on.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+static int delete_item(tb_hash_table *table, const char *key, size_t length, void *val) {
+    if (TRACE_ACTIVE(table, delete)) {
+        // the key is removed, its probes are counted first
+        uint32_t probes = probe_length_n(table, key, length);
+        uint64_t begin = trace_cycles();
+        int deleted = delete_item_untraced(table, key, length, val);
+        trace_emit(table, TB_TRACE_DELETE, key, length, probes, trace_cycles() - begin);
+        return deleted;
+    }
+    return delete_item_untraced(table, key, length, val);
+}
+
+/*
+    The function removes a value by the key of `length` bytes, see `tb_delete_item`.
+    The key does not need NUL at the end, but it has no NUL bytes.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+int tb_delete_item_n(tb_hash_table *table, const char *key, size_t length) {
+    return delete_item(table, key, length, NULL);
+}
+
+/*
+    The function removes a value by the key of `length` bytes, see `tb_delete_item_n`.
+    The removed value is written into `val` first, so the caller can 
+    release it with one lookup. `val` is not changed for a missing key.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+int tb_pop_item_n(tb_hash_table *table, const char *key, size_t length, void *val) {
+    return delete_item(table, key, length, val);
+}
+
+/*
+    The function removes expired items from a `TB_TTL` table.
+    Checks at most `slots` slots, the next call continues after them,
+    so a full pass takes `allocated / slots` calls.
+    Insertions and deletions call it for a few slots themselves.
+    Returns the number of removed items.
+ */
+uint32_t tb_expire_step(tb_hash_table *table, uint32_t slots) {
+    if (!(table->flags & TB_TTL)) {
+        return 0;
+    }
+    return expire_step(table, slots);
+}
+
+/*
+    The function removes values by `count` keys from the table.
+    If `deleted` is not NULL, writes 1 or 0 for each key into it.
+    Returns the number of removed items.
+ */
+uint32_t tb_delete_items(tb_hash_table *table, const char * const *keys, 
+        uint32_t count, int *deleted) {
+    uint32_t removed = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        int del = tb_delete_item(table, keys[i]);
+        if (deleted != NULL) {
+            deleted[i] = del;
+        }
+        removed += (uint32_t)del;
+    }
+    return removed;
+}
+
+/*
+    A static function, appends a value to the run of the key, 
+    see `tb_append_value_n`, without tracing.
+    Returns the number of values of the key, or 0.
+ */
+static uint32_t append_value_untraced(tb_hash_table *table, const char *key, size_t length, 
+        const void *val) {
+    if (!(table->flags & TB_MULTI)) {
+        return 0;
+    }
+    rehash_maintain(table);
+    uint64_t h = key_hash_n(table, key, length);
+    int64_t free_slot;
+    int64_t slot = probe_slot(table, key, length, h, &free_slot);
+    if (slot < 0) {
+        // the first value is a new item
+        return insert_item_untraced(table, key, length, val, 0, NULL) != NULL;
+    }
+    tb_multi_item *multi = (tb_multi_item *)table->items[slot];
+    if (multi->count == multi->capacity || table->snapshots != NULL) {
+        if (multi->count == UINT32_MAX) {
+            return 0;
+        }
+        // a bigger run, snapshots read the old one
+        uint32_t capacity = multi->count < multi->capacity ? multi->capacity 
+            : multi->capacity <= UINT32_MAX / 2 ? multi->capacity * 2 : UINT32_MAX;
+        tb_multi_item *grown = multi_item_copy(table, multi, capacity);
+        if (!replace_slot(table, slot, &grown->item)) {
+            return 0;
+        }
+        release_item(table, &multi->item);
+        multi = grown;
+    }
+    memcpy(TB_VALUE_AT(multi->item.val, multi->count), val, sizeof(void *));
+    return ++multi->count;
+}
+
+/*
+    The function appends a value to the values of the key in 
+    a `TB_MULTI` table, a new key gets its first value.
+    The values of `sizeof(void *)` bytes are copied.
+    Returns the number of values of the key, or 0, if the table is full 
+    or it is not `TB_MULTI`.
+ */
+uint32_t tb_append_value(tb_hash_table *table, const char *key, const void *val) {
+    return tb_append_value_n(table, key, KEY_NUL, val);
+}
+
+/*
+    The function appends a value by the key of `length` bytes, see `tb_append_value`.
+    The key does not need NUL at the end, but it has no NUL bytes.
+    Returns the number of values of the key, or 0.
+ */
+uint32_t tb_append_value_n(tb_hash_table *table, const char *key, size_t length, const void *val) {
+    if (TRACE_ACTIVE(table, insert)) {
+        uint64_t begin = trace_cycles();
+        uint32_t count = append_value_untraced(table, key, length, val);
+        uint64_t cycles = trace_cycles() - begin;
+        trace_emit(table, TB_TRACE_INSERT, key, length, probe_length_n(table, key, length), cycles);
+        return count;
+    }
+    return append_value_untraced(table, key, length, val);
+}
+
+/*
+    The function gets all values of the key by one lookup. The values are 
+    `count` values of `sizeof(void *)` bytes one after another, the value 
+    `i` is `TB_VALUE_AT(values, i)`. Tables without `TB_MULTI` have 
+    one value of a key. The values are valid until the next change of the key.
+    Returns the pointer to the first value, or NULL, then `count` is 0.
+ */
+void *tb_get_all_values(const tb_hash_table * const table, const char *key, uint32_t *count) {
+    return tb_get_all_values_n(table, key, KEY_NUL, count);
+}
+
+/*
+    The function gets all values by the key of `length` bytes, see `tb_get_all_values`.
+    The key does not need NUL at the end, but it has no NUL bytes.
+    Returns the pointer to the first value, or NULL.
+ */
+void *tb_get_all_values_n(const tb_hash_table * const table, const char *key, 
+        size_t length, uint32_t *count) {
+    return tb_item_values(table, tb_get_item_n(table, key, length), count);
+}
+
+/*
+    The function gets all values of an item of the table, e.g. of 
+    `tb_next_item`, see `tb_get_all_values`. `item` can be NULL.
+    Returns the pointer to the first value, or NULL, then `count` is 0.
+ */
+void *tb_item_values(const tb_hash_table * const table, const tb_hash_table_item *item, 
+        uint32_t *count) {
+    if (item == NULL) {
+        *count = 0;
+        return NULL;
+    }
+    *count = table->flags & TB_MULTI ? ((const tb_multi_item *)item)->count : 1;
+    return item->val;
+}
+
+/*
+    The function removes the first value of the key in a `TB_MULTI` table, 
+    which is equal to `val`, the order of the other values is kept. 
+    The key is removed with its last value. The run is halved, 
+    when a quarter of it is used.
+    Returns 1 if the value is removed, otherwise returns 0.
+ */
+int tb_delete_value(tb_hash_table *table, const char *key, const void *val) {
+    if (!(table->flags & TB_MULTI) || !table->count) {
+        return 0;
+    }
+    rehash_maintain(table);
+    int64_t slot = find_slot_at(table, key, KEY_NUL, key_hash(table, key));
+    if (slot < 0) {
+        return 0;
+    }
+    tb_multi_item *multi = (tb_multi_item *)table->items[slot];
+    for (uint32_t i = 0; i < multi->count; ++i) {
+        if (memcmp(TB_VALUE_AT(multi->item.val, i), val, sizeof(void *)) != 0) {
+            continue;
+        }
+        if (multi->count == 1) {
+            return remove_slot(table, slot);
+        }
+        uint32_t capacity = multi->count - 1 <= multi->capacity / 4 ? multi->capacity / 2 
+            : multi->capacity;
+        if (capacity != multi->capacity || table->snapshots != NULL) {
+            // snapshots read the old run
+            tb_multi_item *copy = multi_item_copy(table, multi, capacity);
+            if (!replace_slot(table, slot, &copy->item)) {
+                return 0;
+            }
+            release_item(table, &multi->item);
+            multi = copy;
+        }
+        memmove(TB_VALUE_AT(multi->item.val, i), TB_VALUE_AT(multi->item.val, i + 1), 
+                (size_t)(multi->count - i - 1) * sizeof(void *));
+        --multi->count;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    The function assign NULL to the pointer to the table.
+    Nothing of returns.
+ */
+static void delete_table(tb_hash_table **ptr) {
+    tb_hash_table *table = *ptr;
+    rehash_abort(table);
+    region_free(table->memory, table->items, table->allocated * sizeof(tb_hash_table_item *));
+    region_free(table->memory, table->entries, table->allocated * sizeof(tb_hash_table_item));
+    region_free(table->memory, table->index, (size_t)table->allocated * table->index_width);
+    free((*ptr)->filter);
+    region_free(table->memory, table->buckets, 
+            (size_t)(table->bucket_mask + 1) * sizeof(tb_cuckoo_bucket));
+    free((*ptr)->stash);
+    pool_release(*ptr);
+    free((*ptr)->deferred);
+    free(*ptr);
+    *ptr = NULL;
+}
+
+/* 
+    The function removes the table from memory.
+    Nothing of returns.
+*/
+void tb_delete_hash_table(tb_hash_table *table) {
+    if (table->flags & TB_COMPACT) {
+        for (uint32_t position = 0; position < table->used; ++position) {
+            if (table->entries[position].key != NULL) {
+                clear_table_item(table, &table->entries[position]);
+            }
+        }
+        delete_table(&table);
+        return;
+    }
+    if (table->flags & TB_CUCKOO) {
+        for (uint32_t position = 0; position < table->allocated + table->stash_count; ++position) {
+            tb_hash_table_item *item = cuckoo_item_at(table, position);
+            if (item != NULL) {
+                tb_delete_table_item(table, item);
+            }
+        }
+        delete_table(&table);
+        return;
+    }
+    // iteration over all items
+    for (uint32_t index = 0; index < table->allocated; ++index) {
+        tb_hash_table_item * item = table->items[index];
+        // check if an item is not EMPTY_ITEM or an item is not NULL
+        if (item && item != EMPTY_ITEM) {
+            // remove an item from memory
+            tb_delete_table_item(table, item);
+        }
+    }
+    // remove the table from memory
+    delete_table(&table);
+}
+
+/*
+    The function iterates over all items of the table.
+    `position` must be 0 before the first call, the function moves it.
+    `TB_COMPACT` tables return items in insertion order, 
+    other tables in the order of slots. Expired items are skipped.
+    Returns the next item, or NULL at the end.
+ */
+tb_hash_table_item *tb_next_item(const tb_hash_table * const table, uint32_t *position) {
+    if (table->flags & TB_COMPACT) {
+        while (*position < table->used) {
+            tb_hash_table_item *item = &table->entries[(*position)++];
+            if (item->key != NULL) {
+                return item;
+            }
+        }
+        return NULL;
+    }
+    if (table->flags & TB_CUCKOO) {
+        while (*position < table->allocated + table->stash_count) {
+            tb_hash_table_item *item = cuckoo_item_at(table, (*position)++);
+            if (item != NULL) {
+                return item;
+            }
+        }
+        return NULL;
+    }
+    uint64_t now = table->flags & TB_TTL ? table->clock() : 0;
+    while (*position < table->allocated) {
+        tb_hash_table_item *item = table->items[(*position)++];
+        if (item != NULL && item != EMPTY_ITEM 
+                && !((table->flags & TB_TTL) && is_expired(item, now))) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/*
+    The function gets the iteration position of an item of the table, 
+    `tb_next_item` from it returns the items after this item.
+    Returns the position.
+ */
+uint32_t tb_item_position(const tb_hash_table * const table, const tb_hash_table_item *item) {
+    if (table->flags & TB_COMPACT) {
+        return (uint32_t)(item - table->entries) + 1;
+    }
+    if (table->flags & TB_CUCKOO) {
+        tb_cuckoo_bucket *bucket;
+        uint32_t slot;
+        cuckoo_find(table, item->key, KEY_NUL, key_hash(table, item->key), &bucket, &slot);
+        return bucket ? (uint32_t)(bucket - (tb_cuckoo_bucket *)table->buckets) * CUCKOO_SLOTS + slot + 1 
+            : table->allocated + slot + 1;
+    }
+    return (uint32_t)find_slot(table, item->key) + 1;
+}
+
+/*
+    A static function, counts the slots, which a lookup of the key of 
+    `length` bytes checks, see `tb_probe_length`.
+    Returns the number of slots.
+ */
+static uint32_t probe_length_n(const tb_hash_table * const table, const char *key, size_t length) {
+    uint64_t h = key_hash_n(table, key, length);
+    if (table->flags & TB_CUCKOO) {
+        tb_cuckoo_bucket *bucket;
+        uint32_t slot;
+        uint32_t first = (uint32_t)h & table->bucket_mask;
+        int found = cuckoo_find(table, key, length, h, &bucket, &slot);
+        if (found && bucket == (tb_cuckoo_bucket *)table->buckets + first) {
+            return 1;
+        }
+        return 2 + (table->stash_count && (!found || bucket == NULL));
+    }
+    uint32_t try = 0;
+    while (try < table->allocated) {
+        int64_t index = probe_index(table, h, try++);
+        if (table->flags & TB_COMPACT) {
+            int32_t position = index_get(table, index);
+            if (position == INDEX_EMPTY 
+                    || (position >= 0 && keys_equal(table, table->entries[position].key, key, length))) {
+                break;
+            }
+        } else {
+            tb_hash_table_item *item = table->items[index];
+            if (item == NULL || (item != EMPTY_ITEM && keys_equal(table, item->key, key, length))) {
+                break;
+            }
+        }
+    }
+    return try;
+}
+
+/*
+    The function counts the slots, which a lookup of the key checks.
+    For a key in the table it is the length of its probe sequence, 
+    for other keys it is the sequence to the first NULL slot.
+    Expired items and the filter are not taken into account.
+    For `TB_CUCKOO` tables it is the number of buckets, 1 or 2, 
+    and 1 more if the stash is not empty.
+    Returns the number of slots.
+ */
+uint32_t tb_probe_length(const tb_hash_table * const table, const char *key) {
+    return probe_length_n(table, key, KEY_NUL);
+}
+
+/*
+    The function sets the callback of a table, it gets every insertion, 
+    lookup, deletion and resize of the table, see `tb_trace_event`, 
+    and `context`. NULL `trace` removes the callback.
+    Without the callback and attached USDT probes, the operations are 
+    not timed, a traced table is slower, the probes are counted by 
+    one more lookup. Batch functions are not traced.
+    Nothing to returns.
+ */
+void tb_set_trace(tb_hash_table *table, 
+        void (*trace)(const tb_hash_table *table, const tb_trace_event *event, void *context), 
+        void *context) {
+    table->trace = trace;
+    table->trace_context = context;
+}
+
+/*
+    The header of the buffer of a frozen table. 
+    It is followed by `buckets` pilots of 16 bits, rounded up to 
+    4 pilots, so the next arrays and the records stay aligned, `positions - count`
+    slots of the remapped positions and `count` offsets of 32 bits 
+    and the records. A record is the value of 8 bytes and the key 
+    with NUL, records are aligned to 8 bytes.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t buckets;
+    uint32_t positions;
+    uint64_t seed[2];
+    uint64_t size;
+} tb_frozen_header;
+
+/*
+    A static function, the slot of a key in a frozen table.
+    `h` is the hash of the key, `pilot` is the pilot of its bucket.
+    Returns the position, less than `positions`.
+ */
+static inline uint32_t frozen_position(uint64_t h, uint32_t pilot, uint32_t positions) {
+    uint64_t x = h ^ ((pilot + 1) * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)(((x >> 32) * positions) >> 32);
+}
+
+/*
+    A static function, the bucket of a key in a frozen table.
+    Returns the bucket, less than `buckets`.
+ */
+static inline uint32_t frozen_bucket(uint64_t h, uint32_t buckets) {
+    return (uint32_t)(((h >> 32) * buckets) >> 32);
+}
+
+/*
+    A static function, compares buckets by size for `qsort`, 
+    the largest buckets are placed first.
+    Returns the result of the comparison.
+ */
+static int frozen_compare_buckets(const void *a, const void *b) {
+    const uint32_t *x = (const uint32_t *)a;
+    const uint32_t *y = (const uint32_t *)b;
+    return x[1] != y[1] ? (x[1] < y[1] ? 1 : -1) : (x[0] > y[0]) - (x[0] < y[0]);
+}
+
+/*
+    A static function, searches the pilots of all buckets, PTHash-like:
+    the largest buckets first, a pilot places all keys of its bucket 
+    into free positions. There are `positions` positions, a bit more than 
+    `count`, so the last buckets find free positions fast. Keys in 
+    the positions after `count` are moved to the free slots before it, 
+    `remap` gets these slots.
+    `hashes` are the hashes of `count` keys, `slots` gets the slot of each key.
+    Returns 1 if success, otherwise 0, then another seed is needed.
+ */
+static int frozen_search_pilots(const uint64_t *hashes, uint32_t count, uint32_t positions, 
+        uint32_t buckets, uint16_t *pilots, uint32_t *remap, uint32_t *slots) {
+    int result = 0;
+    // the first key of each bucket in `order`, like counting sort
+    uint32_t *start = (uint32_t *)calloc((size_t)buckets + 1, sizeof(uint32_t));
+    uint32_t *order = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    uint32_t *sizes = (uint32_t *)malloc((size_t)buckets * 2 * sizeof(uint32_t));
+    uint8_t *taken = (uint8_t *)calloc((size_t)positions / 8 + 1, 1);
+    uint32_t *candidates = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    if (!start || !order || !sizes || !taken || !candidates) {
+        goto finally;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        ++start[frozen_bucket(hashes[i], buckets) + 1];
+    }
+    for (uint32_t b = 0; b < buckets; ++b) {
+        sizes[2 * b] = b;
+        sizes[2 * b + 1] = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        order[start[frozen_bucket(hashes[i], buckets)]++] = i;
+    }
+    // `start` is the end of each bucket now
+    qsort(sizes, buckets, 2 * sizeof(uint32_t), frozen_compare_buckets);
+    for (uint32_t n = 0; n < buckets; ++n) {
+        uint32_t bucket = sizes[2 * n], size = sizes[2 * n + 1];
+        const uint32_t *keys = order + start[bucket] - size;
+        uint32_t pilot = 0;
+        for (; pilot <= FROZEN_MAX_PILOT && size; ++pilot) {
+            uint32_t placed = 0;
+            for (; placed < size; ++placed) {
+                uint32_t slot = frozen_position(hashes[keys[placed]], pilot, positions);
+                if (taken[slot >> 3] & (1 << (slot & 7))) {
+                    break;
+                }
+                // keys of the same bucket must not collide too
+                taken[slot >> 3] |= (uint8_t)(1 << (slot & 7));
+                candidates[placed] = slot;
+            }
+            if (placed == size) {
+                break;
+            }
+            for (uint32_t i = 0; i < placed; ++i) {
+                taken[candidates[i] >> 3] &= (uint8_t)~(1 << (candidates[i] & 7));
+            }
+        }
+        if (pilot > FROZEN_MAX_PILOT) {
+            goto finally;
+        }
+        pilots[bucket] = (uint16_t)(size ? pilot : 0);
+        for (uint32_t i = 0; i < size; ++i) {
+            slots[keys[i]] = candidates[i];
+        }
+    }
+    // as many slots before `count` are free, as keys are after it
+    memset(remap, 0, (size_t)(positions - count) * sizeof(uint32_t));
+    uint32_t hole = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (slots[i] >= count) {
+            while (taken[hole >> 3] & (1 << (hole & 7))) {
+                ++hole;
+            }
+            remap[slots[i] - count] = hole;
+            slots[i] = hole++;
+        }
+    }
+    result = 1;
+finally:
+    free(start);
+    free(order);
+    free(sizes);
+    free(taken);
+    free(candidates);
+    return result;
+}
+
+/*
+    A static function, sets the pointers of a frozen table to its buffer.
+    Nothing to returns.
+ */
+static void frozen_attach(tb_frozen_table *frozen, const void *data) {
+    const tb_frozen_header *header = (const tb_frozen_header *)data;
+    frozen->data = data;
+    frozen->size = header->size;
+    frozen->count = header->count;
+    frozen->positions = header->positions;
+    frozen->buckets = header->buckets;
+    frozen->seed[0] = header->seed[0];
+    frozen->seed[1] = header->seed[1];
+    frozen->pilots = (const uint16_t *)(header + 1);
+    frozen->remap = (const uint32_t *)(frozen->pilots + (((uint64_t)header->buckets + 3) & ~(uint64_t)3));
+    frozen->offsets = frozen->remap + (header->positions - header->count);
+}
+
+/*
+    A static function, the size of the header, the pilots, the remapped 
+    positions and the offsets of a frozen table, aligned to 8 bytes.
+    Returns the size in bytes.
+ */
+static inline uint64_t frozen_header_size(uint32_t positions, uint32_t buckets) {
+    return sizeof(tb_frozen_header) + (((uint64_t)buckets + 3) & ~(uint64_t)3) * sizeof(uint16_t) 
+        + (((uint64_t)positions * sizeof(uint32_t) + 7) & ~(uint64_t)7);
+}
+
+/*
+    The function builds a frozen, read-only copy of the table with 
+    minimal perfect hashing: `count` slots for `count` keys, a lookup is 
+    one hash and one key comparison. Like PTHash, the keys are placed 
+    into `count` / FROZEN_LOAD_FACTOR positions, the few keys after 
+    `count` are remapped to the free slots, so large tables are built 
+    fast. All data is in one buffer `data` 
+    of `size` bytes with offsets instead of pointers, so it can be written 
+    to a file and opened by `tb_open_frozen_table`, e.g. after `mmap`.
+    Values are copied as `sizeof(void *)` bytes.
+    Returns a pointer to the frozen table, or NULL.
+ */
+tb_frozen_table *tb_freeze(const tb_hash_table * const table) {
+    uint32_t count = 0, position = 0;
+    while (tb_next_item(table, &position) != NULL) {
+        ++count;
+    }
+    uint32_t buckets = count / FROZEN_KEYS_PER_BUCKET + 1;
+    uint32_t positions = (uint32_t)(count / FROZEN_LOAD_FACTOR) + 1;
+    uint64_t records = 0;
+    const tb_hash_table_item **items = (const tb_hash_table_item **)malloc(
+            ((size_t)count + 1) * sizeof(tb_hash_table_item *));
+    uint64_t *hashes = (uint64_t *)malloc(((size_t)count + 1) * sizeof(uint64_t));
+    uint16_t *pilots = (uint16_t *)malloc((size_t)buckets * sizeof(uint16_t));
+    uint32_t *remap = (uint32_t *)malloc((size_t)(positions - count) * sizeof(uint32_t));
+    uint32_t *slots = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    tb_frozen_table *frozen = (tb_frozen_table *)calloc(1, sizeof(tb_frozen_table));
+    uint8_t *data = NULL;
+    if (!items || !hashes || !pilots || !remap || !slots || !frozen) {
+        goto error;
+    }
+    position = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        items[i] = tb_next_item(table, &position);
+        records += (sizeof(uint64_t) + strlen(items[i]->key) + 1 + 7) & ~(uint64_t)7;
+    }
+    uint64_t seed[2];
+    int seeds = 0;
+    do {
+        if (++seeds > FROZEN_MAX_SEEDS) {
+            goto error;
+        }
+        random_seed(seed);
+        for (uint32_t i = 0; i < count; ++i) {
+            hashes[i] = seeded_hash(seed, items[i]->key, KEY_NUL);
+        }
+    } while (!frozen_search_pilots(hashes, count, positions, buckets, pilots, remap, slots));
+
+    uint64_t header_size = frozen_header_size(positions, buckets);
+    uint64_t size = header_size + records;
+    if (size > UINT32_MAX) {
+        goto error;
+    }
+    data = (uint8_t *)calloc(1, size);
+    if (data == NULL) {
+        goto error;
+    }
+    tb_frozen_header *header = (tb_frozen_header *)data;
+    header->magic = FROZEN_MAGIC;
+    header->version = FROZEN_VERSION;
+    header->count = count;
+    header->positions = positions;
+    header->buckets = buckets;
+    header->seed[0] = seed[0];
+    header->seed[1] = seed[1];
+    header->size = size;
+    memcpy(header + 1, pilots, (size_t)buckets * sizeof(uint16_t));
+    frozen_attach(frozen, data);
+    memcpy((uint32_t *)frozen->remap, remap, (size_t)(positions - count) * sizeof(uint32_t));
+    uint32_t *offsets = (uint32_t *)frozen->offsets;
+    uint64_t offset = header_size;
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t key_length = strlen(items[i]->key) + 1;
+        offsets[slots[i]] = (uint32_t)offset;
+        memcpy(data + offset, items[i]->val, sizeof(void *));
+        memcpy(data + offset + sizeof(uint64_t), items[i]->key, key_length);
+        offset += (sizeof(uint64_t) + key_length + 7) & ~(uint64_t)7;
+    }
+    frozen->owner = 1;
+    free(items);
+    free(hashes);
+    free(pilots);
+    free(remap);
+    free(slots);
+    return frozen;
+error:
+    free(items);
+    free(hashes);
+    free(pilots);
+    free(remap);
+    free(slots);
+    free(frozen);
+    free(data);
+    return NULL;
+}
+
+/*
+    The function opens a frozen table from the buffer of `tb_freeze`.
+    The buffer is not copied, it must be valid until the table is deleted,
+    it must be aligned to 8 bytes, `mmap` gives such buffers.
+    The remapped positions and the records are checked, so a broken 
+    buffer is not read out of its bounds, it takes one pass over the records.
+    Returns a pointer to the frozen table, or NULL if the buffer is broken.
+ */
+tb_frozen_table *tb_open_frozen_table(const void *data, uint64_t size) {
+    const tb_frozen_header *header = (const tb_frozen_header *)data;
+    if (size < sizeof(tb_frozen_header) || header->magic != FROZEN_MAGIC 
+            || header->version != FROZEN_VERSION || header->size != size
+            || header->positions <= header->count || !header->buckets
+            || frozen_header_size(header->positions, header->buckets) > size) {
+        return NULL;
+    }
+    tb_frozen_table *frozen = (tb_frozen_table *)calloc(1, sizeof(tb_frozen_table));
+    if (frozen == NULL) {
+        return NULL;
+    }
+    frozen_attach(frozen, data);
+    uint64_t header_size = frozen_header_size(header->positions, header->buckets);
+    for (uint32_t i = 0; i < header->positions - header->count; ++i) {
+        if (frozen->remap[i] >= header->count) {
+            goto error;
+        }
+    }
+    for (uint32_t slot = 0; slot < header->count; ++slot) {
+        // the value, the key and its NUL must be in the buffer
+        uint64_t offset = frozen->offsets[slot];
+        if (offset < header_size || (offset & 7) || offset + sizeof(uint64_t) >= size
+                || memchr((const uint8_t *)data + offset + sizeof(uint64_t), 0, 
+                    size - offset - sizeof(uint64_t)) == NULL) {
+            goto error;
+        }
+    }
+    return frozen;
+error:
+    free(frozen);
+    return NULL;
+}
+
+/*
+    The function gets a value by key from a frozen table.
+    Returns the pointer to a value in the buffer, if the key exists. 
+    Otherwise returns NULL
+ */
+void *tb_frozen_get_value(const tb_frozen_table * const table, const char *key) {
+    if (!table->count) {
+        return NULL;
+    }
+    uint64_t h = seeded_hash(table->seed, key, KEY_NUL);
+    uint32_t pilot = table->pilots[frozen_bucket(h, table->buckets)];
+    uint32_t slot = frozen_position(h, pilot, table->positions);
+    if (slot >= table->count) {
+        slot = table->remap[slot - table->count];
+    }
+    uint8_t *record = (uint8_t *)table->data + table->offsets[slot];
+    return strcmp((const char *)record + sizeof(uint64_t), key) == 0 ? record : NULL;
+}
+
+/*
+    The function gets the key of a slot of a frozen table, for the iteration.
+    `slot` is less than `count`, the value is written into `val`, if it is not NULL.
+    Returns the key.
+ */
+const char *tb_frozen_key_at(const tb_frozen_table * const table, uint32_t slot, void **val) {
+    uint8_t *record = (uint8_t *)table->data + table->offsets[slot];
+    if (val != NULL) {
+        *val = record;
+    }
+    return (const char *)record + sizeof(uint64_t);
+}
+
+/*
+    The function removes a frozen table from memory.
+    The buffer is freed only if it is made by `tb_freeze`.
+    Nothing to returns.
+ */
+void tb_delete_frozen_table(tb_frozen_table *table) {
+    if (table->owner) {
+        free((void *)table->data);
+    }
+    free(table);
+}
+
+/*
+    The function removes all items from the table, the table can be 
+    filled again. The slot arrays are kept, only occupied slots are written, 
+    the blocks of items go to the pool of the table, so the next 
+    insertions reuse them without `malloc`.
+    Returns 1 if success, otherwise 0, if the memory of snapshots 
+    can not be allocated, then the table is not changed.
+ */
+int tb_clear(tb_hash_table *table) {
+    if (table->flags & TB_COMPACT) {
+        for (uint32_t position = 0; position < table->used; ++position) {
+            if (table->entries[position].key != NULL) {
+                clear_table_item(table, &table->entries[position]);
+            }
+        }
+        table->used = 0;
+        memset(table->index, 0xff, (size_t)table->allocated * table->index_width);
+    } else if (table->flags & TB_CUCKOO) {
+        tb_cuckoo_bucket *buckets = (tb_cuckoo_bucket *)table->buckets;
+        // stop after the last item in the buckets
+        uint32_t left = table->count - table->stash_count;
+        for (uint32_t b = 0; b <= table->bucket_mask && left; ++b) {
+            for (uint32_t s = 0; s < CUCKOO_SLOTS; ++s) {
+                if (buckets[b].tags[s]) {
+                    tb_delete_table_item(table, buckets[b].items[s]);
+                    buckets[b].tags[s] = 0;
+                    buckets[b].items[s] = NULL;
+                    --left;
+                }
+            }
+        }
+        for (uint32_t s = 0; s < table->stash_count; ++s) {
+            tb_delete_table_item(table, table->stash[s]);
+        }
+        table->stash_count = 0;
+    } else {
+        if (table->snapshots != NULL) {
+            // the pages and the removed items of snapshots first, nothing fails then
+            if (!defer_reserve(table, table->count)) {
+                return 0;
+            }
+            for (uint32_t index = 0; index < table->allocated; ++index) {
+                if (table->items[index] != NULL && !snapshot_touch(table, index)) {
+                    return 0;
+                }
+            }
+        }
+        rehash_abort(table);
+        for (uint32_t index = 0; index < table->allocated; ++index) {
+            tb_hash_table_item *item = table->items[index];
+            if (item != NULL) {
+                set_slot(table, index, NULL);
+                if (item != EMPTY_ITEM) {
+                    release_item(table, item);
+                }
+            }
+        }
+    }
+    if (table->flags & TB_FILTER) {
+        memset(table->filter, 0, (size_t)table->filter_blocks * FILTER_BLOCK_BYTES);
+    }
+    table->count = 0;
+    table->empty = 1;
+    table->hits = table->misses = table->evictions = 0;
+    table->lru_head = table->lru_tail = NULL;
+    table->expire_cursor = 0;
+    return 1;
+}
+
+/*
+    A static function, makes room for `size` items, see `tb_reserve`, 
+    without tracing.
+    Returns 1 if success, otherwise 0.
+ */
+static int reserve_untraced(tb_hash_table *table, uint32_t size) {
+    // the slots of `tb_shrink_to_fit` can be too small for the size
+    uint32_t slots = table->rehash != NULL ? table->rehash_allocated : table->allocated;
+    if (size <= table->size && ((table->flags & (TB_COMPACT | TB_CUCKOO)) || capacity_for(size) <= slots)) {
+        return 1;
+    }
+    if (table->snapshots != NULL) {
+        // snapshots read the slot array
+        return 0;
+    }
+    uint32_t allocated = capacity_for(size);
+    if (!allocated) {
+        return 0;
+    }
+    if (table->flags & TB_CUCKOO) {
+        while (table->allocated < allocated) {
+            if (!cuckoo_grow(table)) {
+                return 0;
+            }
+        }
+    } else if (table->flags & TB_COMPACT) {
+        uint32_t width = allocated - 1 <= INT8_MAX ? 1 : allocated - 1 <= INT16_MAX ? 2 : 4;
+        void *index = region_alloc(table->memory, table->numa_nodes, (size_t)allocated * width);
+        tb_hash_table_item *entries = (tb_hash_table_item *)region_alloc(table->memory, 
+                table->numa_nodes, allocated * sizeof(tb_hash_table_item));
+        if (index == NULL || entries == NULL) {
+            region_free(table->memory, index, (size_t)allocated * width);
+            region_free(table->memory, entries, allocated * sizeof(tb_hash_table_item));
+            return 0;
+        }
+        memcpy(entries, table->entries, table->used * sizeof(tb_hash_table_item));
+        region_free(table->memory, table->entries, table->allocated * sizeof(tb_hash_table_item));
+        region_free(table->memory, table->index, (size_t)table->allocated * table->index_width);
+        table->entries = entries;
+        table->index = index;
+        table->index_width = width;
+        table->allocated = allocated;
+        compact_rebuild(table);
+    } else if (!rebuild_slots(table, allocated)) {
+        return 0;
+    }
+    if (size <= table->size) {
+        return 1;
+    }
+    table->size = size;
+    if (table->flags & TB_FILTER) {
+        // if it fails, the old filter is still right, but more loaded
+        filter_rebuild(table, size);
+    }
+    return 1;
+}
+
+/*
+    The function makes room for `size` items, the items are moved 
+    to the new slots, tombstones are dropped. A smaller `size` does nothing, 
+    but the slots of `tb_shrink_to_fit` grow for it.
+    A table with snapshots can not be resized.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+int tb_reserve(tb_hash_table *table, uint32_t size) {
+    if (TRACE_ACTIVE(table, resize) && size > table->size) {
+        uint64_t begin = trace_cycles();
+        int done = reserve_untraced(table, size);
+        if (done) {
+            trace_emit(table, TB_TRACE_RESIZE, NULL, 0, table->allocated, trace_cycles() - begin);
+        }
+        return done;
+    }
+    return reserve_untraced(table, size);
+}
+
+/*
+    The function shrinks the slots of the table to its items, the size 
+    of the table is kept. The items are rehashed into the smaller slots 
+    step by step: every insertion and deletion moves a few slots, 
+    `tb_rehash_step` moves more of them, the old slots are freed after 
+    the last step. New items grow the slots back at once, twice every time, 
+    up to the slots of the size, see `tb_reserve`, the slots of a table 
+    with snapshots can not grow, new keys are not inserted then. 
+    If the slots can not be smaller, only tombstones are purged. A table 
+    with snapshots, a `TB_COMPACT` or a `TB_CUCKOO` table is not shrunk.
+    The blocks of removed items in the pool are freed, blocks of the arena 
+    are kept, they are freed with the table.
+    Returns 1 if success, otherwise 0, then the table is not changed.
+ */
+int tb_shrink_to_fit(tb_hash_table *table) {
+    if ((table->flags & (TB_COMPACT | TB_CUCKOO)) || table->snapshots != NULL) {
+        return 0;
+    }
+    if (!table->memory) {
+        pool_release(table);
+    }
+    uint32_t allocated = capacity_for(table->count ? table->count : 1);
+    if (allocated < table->allocated || table->tombstones) {
+        if (!rehash_start(table, allocated < table->allocated ? allocated : table->allocated)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+    The function moves at most `slots` slots of a running rehash, 
+    of `tb_shrink_to_fit` or of a purge of tombstones, the next call 
+    continues after them. A purge starts by itself, when tombstones are 
+    more than 1 / 8 of the slots, insertions and deletions move a few slots.
+    Returns the number of slots, which are left to move, 0 if it is done.
+ */
+uint32_t tb_rehash_step(tb_hash_table *table, uint32_t slots) {
+    if (table->rehash == NULL) {
+        return 0;
+    }
+    return rehash_step(table, slots);
+}
+
+/*
+    A static function, checks if the items of `src` can be moved into `dst`.
+    Items are moved, if both tables have items of the same layout from 
+    `malloc`, and no snapshots read them.
+    Returns 1 if the items can be moved, otherwise 0.
+ */
+static int merge_movable(const tb_hash_table * const dst, const tb_hash_table * const src) {
+    const uint32_t layouts = TB_COMPACT | TB_CUCKOO | TB_LRU | TB_MULTI;
+    return dst != src && !((dst->flags | src->flags) & layouts) && !dst->memory && !src->memory 
+        && dst->snapshots == NULL && src->snapshots == NULL
+        && (dst->flags & (TB_TTL | TB_INTERNED)) == (src->flags & (TB_TTL | TB_INTERNED));
+}
+
+/*
+    A static function, makes room in `dst` for `count` more items.
+    The size is at least doubled, so merges of many tables one by one 
+    do not move the items of `dst` every time.
+    `TB_LRU` tables keep their size, they evict items.
+    Returns 1 if success, otherwise 0.
+ */
+static int merge_reserve(tb_hash_table *dst, uint64_t count) {
+    if (dst->flags & TB_LRU) {
+        return 0;
+    }
+    uint64_t size = (uint64_t)dst->count + count;
+    if (size <= dst->size) {
+        // the slots of `tb_shrink_to_fit` can be smaller
+        return tb_reserve(dst, (uint32_t)size);
+    }
+    if (size < (uint64_t)dst->size * 2) {
+        size = (uint64_t)dst->size * 2;
+    }
+    return size <= UINT32_MAX && tb_reserve(dst, (uint32_t)size);
+}
+
+/*
+    A static function, merges the value of `item` of a source table 
+    into `target` of the destination table with the same key.
+    Without `combine` the value of the source replaces the value.
+    Nothing to returns.
+ */
+static inline void merge_value(tb_hash_table_item *target, const tb_hash_table_item *item, 
+        void (*combine)(const char *, void *, const void *)) {
+    if (combine != NULL) {
+        combine(target->key, target->val, item->val);
+    } else {
+        memcpy(target->val, item->val, sizeof(void *));
+    }
+}
+
+/*
+    A static function, `src` is empty after its items are moved, 
+    its slots are NULL already.
+    Nothing to returns.
+ */
+static void merge_finish(tb_hash_table *src) {
+    if (src->flags & TB_FILTER) {
+        memset(src->filter, 0, (size_t)src->filter_blocks * FILTER_BLOCK_BYTES);
+    }
+    src->count = 0;
+    src->empty = 1;
+    src->expire_cursor = 0;
+    src->tombstones = 0;
+}
+
+/*
+    A pair of an item of a source table and the hash of its key for `dst`.
+ */
+typedef struct {
+    tb_hash_table_item *item;
+    uint64_t h;
+} tb_merge_entry;
+
+/*
+    A static function, takes the next item of `src` from the slot `index`,
+    the slots before it are cleared, expired items are freed.
+    The item after next is prefetched, its key is hashed soon.
+    Returns the item, or NULL at the end of the slots.
+ */
+static tb_hash_table_item *merge_take(tb_hash_table *src, uint32_t *index, uint64_t now) {
+    while (*index < src->allocated) {
+        tb_hash_table_item *item = src->items[*index];
+        src->items[(*index)++] = NULL;
+        if (*index + BATCH_PREFETCH < src->allocated) {
+            __builtin_prefetch(src->items[*index + BATCH_PREFETCH]);
+        }
+        if (item == NULL || item == EMPTY_ITEM) {
+            continue;
+        }
+        if ((src->flags & TB_TTL) && is_expired(item, now)) {
+            tb_delete_table_item(src, item);
+            continue;
+        }
+        return item;
+    }
+    return NULL;
+}
+
+/*
+    A static function, moves the items of `src` into `dst`, see `merge_movable`, 
+    `dst` has room for all of them. Every key is hashed once, a new key 
+    takes the item of `src`, the item of a known key is freed.
+    The first slots of the next keys are prefetched, as in `tb_get_values`.
+    Nothing to returns.
+ */
+static void merge_move(tb_hash_table *dst, tb_hash_table *src, 
+        void (*combine)(const char *, void *, const void *)) {
+    uint64_t now = src->flags & TB_TTL ? src->clock() : 0;
+    tb_merge_entry window[BATCH_PREFETCH];
+    // the slots of `src` are cleared directly, `dst` writes them by `set_slot`
+    rehash_abort(src);
+    uint32_t index = 0, head = 0, filled = 0;
+    for (;;) {
+        tb_hash_table_item *next;
+        while (filled < BATCH_PREFETCH && (next = merge_take(src, &index, now)) != NULL) {
+            tb_merge_entry *entry = &window[(head + filled++) % BATCH_PREFETCH];
+            entry->item = next;
+            entry->h = key_hash(dst, next->key);
+            __builtin_prefetch(&dst->items[probe_index(dst, entry->h, 0)]);
+        }
+        if (!filled) {
+            break;
+        }
+        tb_merge_entry entry = window[head];
+        head = (head + 1) % BATCH_PREFETCH;
+        --filled;
+        int64_t free_slot;
+        int64_t slot = probe_slot(dst, entry.item->key, KEY_NUL, entry.h, &free_slot);
+        if (slot >= 0) {
+            merge_value(dst->items[slot], entry.item, combine);
+            tb_delete_table_item(src, entry.item);
+        } else {
+            set_slot(dst, (uint32_t)free_slot, entry.item);
+            filter_add(dst, entry.item->key);
+            ++dst->count;
+        }
+    }
+    dst->empty = !dst->count;
+    merge_finish(src);
+}
+
+/*
+    A static function, copies the items of `src` into `dst` by insertions, 
+    for the tables, which items can not be moved.
+    Returns 1 if success, otherwise 0, if `dst` is full.
+ */
+static int merge_copy(tb_hash_table *dst, tb_hash_table *src, 
+        void (*combine)(const char *, void *, const void *)) {
+    uint32_t position = 0;
+    tb_hash_table_item *item;
+    while ((item = tb_next_item(src, &position)) != NULL) {
+        if (dst->flags & TB_MULTI) {
+            // the values of `src` are appended to the runs
+            uint32_t count;
+            void *values = tb_item_values(src, item, &count);
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!append_value_untraced(dst, item->key, KEY_NUL, TB_VALUE_AT(values, i))) {
+                    return 0;
+                }
+            }
+            continue;
+        }
+        void *value;
+        memcpy(&value, item->val, sizeof(void *));
+        tb_hash_table_item *target = combine != NULL ? tb_get_item(dst, item->key) : NULL;
+        if (target != NULL) {
+            memcpy(&value, target->val, sizeof(void *));
+            combine(item->key, &value, item->val);
+        }
+        if (insert_item(dst, item->key, KEY_NUL, &value, dst->ttl, NULL) == NULL) {
+            return 0;
+        }
+    }
+    tb_clear(src);
+    return 1;
+}
+
+/*
+    The function merges all items of `src` into `dst`, `src` is empty after it.
+    If a key is in both tables, `combine` gets the key, the pointer to 
+    the value of `dst` and the pointer to the value of `src`, it writes 
+    the merged value of `sizeof(void *)` bytes into the value of `dst`. 
+    NULL `combine` takes the value of `src`. `TB_TTL` items keep the time 
+    to live of `dst`, if the key is in `dst`. A `TB_MULTI` `dst` appends 
+    the values of `src` to its runs, `combine` is not used.
+    `dst` is presized for all items, unless it is a `TB_LRU` cache. 
+    The items of `src` are moved into `dst`, not copied, and every key 
+    is hashed once, if the tables have the same flags of items, without 
+    `TB_COMPACT`, `TB_CUCKOO`, `TB_LRU`, `TB_MULTI`, `memory` and snapshots. 
+    Other tables are merged by insertions.
+    Returns 1 if success, otherwise 0, if `dst` is full, then the items 
+    merged so far are in `dst` and `src` is not changed.
+ */
+int tb_merge(tb_hash_table *dst, tb_hash_table *src, 
+        void (*combine)(const char *key, void *dst_val, const void *src_val)) {
+    if (dst == src || src->empty) {
+        return 1;
+    }
+    int reserved = merge_reserve(dst, src->count);
+    if (reserved && merge_movable(dst, src)) {
+        merge_move(dst, src, combine);
+        return 1;
+    }
+    return merge_copy(dst, src, combine);
+}
+
+/*
+    The work of a thread of `tb_merge_many`. The thread hashes the keys 
+    of the sources `thread`, `thread + threads` ..., then it places 
+    the keys of its part of hashes into `dst`, `added` is the number 
+    of its new keys, `reused` is the number of tombstones they take. 
+    The entries of a source are grouped by parts, `parts` of a source 
+    are `threads + 1` offsets of the groups, `next` is the room of 
+    `threads` offsets for the grouping. If `dst` is full, the thread 
+    stops at the entry `stop_index` of the source `stop_source`, 
+    otherwise `stop_source` is `sources`.
+ */
+typedef struct {
+    tb_hash_table *dst;
+    tb_hash_table * const *srcs;
+    tb_merge_entry **entries;
+    uint32_t **parts;
+    uint32_t *next;
+    uint32_t sources;
+    uint32_t threads;
+    uint32_t thread;
+    void (*combine)(const char *, void *, const void *);
+    uint32_t added;
+    uint32_t reused;
+    uint32_t stop_source;
+    uint32_t stop_index;
+} tb_merge_task;
+
+/*
+    A static function, the part of the keys of `tb_merge_many` by a hash.
+    The bits of the slot are not used, so parts do not follow slots.
+    Returns the number of the thread.
+ */
+static inline uint32_t merge_part(uint64_t h, uint32_t threads) {
+    return (uint32_t)(h >> 48) % threads;
+}
+
+/*
+    A static function, the first stage of a thread of `tb_merge_many`.
+    Takes the items of its sources with the hashes of their keys, 
+    see `merge_take`, and groups them by parts in order. The entries 
+    of a source have room for its items twice, the second half is 
+    the items before grouping.
+    Returns NULL.
+ */
+static void *merge_hash_worker(void *arg) {
+    tb_merge_task *task = (tb_merge_task *)arg;
+    for (uint32_t s = task->thread; s < task->sources; s += task->threads) {
+        tb_hash_table *src = task->srcs[s];
+        uint64_t now = src->flags & TB_TTL ? src->clock() : 0;
+        tb_merge_entry *taken = task->entries[s] + src->count;
+        uint32_t *parts = task->parts[s];
+        uint32_t count = 0, index = 0;
+        tb_hash_table_item *item;
+        while ((item = merge_take(src, &index, now)) != NULL) {
+            taken[count].item = item;
+            taken[count].h = key_hash(task->dst, item->key);
+            ++parts[merge_part(taken[count].h, task->threads) + 1];
+            ++count;
+        }
+        for (uint32_t t = 0; t < task->threads; ++t) {
+            parts[t + 1] += parts[t];
+        }
+        uint32_t *next = task->next;
+        memcpy(next, parts, task->threads * sizeof(uint32_t));
+        for (uint32_t i = 0; i < count; ++i) {
+            task->entries[s][next[merge_part(taken[i].h, task->threads)]++] = taken[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+    A static function, places an item into `dst` while other threads 
+    place items with other keys. A key is placed only by one thread, 
+    so the thread which finds it, owns it; a free slot is taken 
+    by compare-and-swap, if another key took it, the probe is repeated. 
+    A taken tombstone is counted in `reused`.
+    Returns 1 if the item is placed, 0 if its value is merged, 
+    -1 if `dst` is full.
+ */
+static int merge_place(tb_hash_table *dst, tb_hash_table_item *item, uint64_t h, 
+        void (*combine)(const char *, void *, const void *), uint32_t *reused) {
+    for (;;) {
+        int64_t first_free = -1;
+        tb_hash_table_item *expected = NULL;
+        for (uint32_t try = 0; try < dst->allocated; ++try) {
+            uint32_t index = probe_index(dst, h, try);
+            tb_hash_table_item *slot = __atomic_load_n(&dst->items[index], __ATOMIC_ACQUIRE);
+            if (slot == NULL || slot == EMPTY_ITEM) {
+                if (first_free < 0) {
+                    first_free = index;
+                    expected = slot;
+                }
+                if (slot == NULL) {
+                    break;
+                }
+            } else if (keys_equal(dst, slot->key, item->key, KEY_NUL)) {
+                merge_value(slot, item, combine);
+                return 0;
+            }
+        }
+        if (first_free < 0) {
+            return -1;
+        }
+        if (__atomic_compare_exchange_n(&dst->items[first_free], &expected, item, 0, 
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            *reused += expected == EMPTY_ITEM;
+            return 1;
+        }
+    }
+}
+
+/*
+    A static function, the second stage of a thread of `tb_merge_many`.
+    Places the items of its part of hashes, the sources are read in order, 
+    so `combine` gets the values in the order of the sources.
+    A placed item is taken from its entry. If `dst` is full, the thread 
+    stops, see `tb_merge_task`.
+    Returns NULL.
+ */
+static void *merge_insert_worker(void *arg) {
+    tb_merge_task *task = (tb_merge_task *)arg;
+    for (uint32_t s = 0; s < task->sources; ++s) {
+        tb_merge_entry *entries = task->entries[s];
+        uint32_t last = task->parts[s][task->thread + 1];
+        for (uint32_t i = task->parts[s][task->thread]; i < last; ++i) {
+            int placed = merge_place(task->dst, entries[i].item, entries[i].h, task->combine, &task->reused);
+            if (placed < 0) {
+                task->stop_source = s;
+                task->stop_index = i;
+                return NULL;
+            }
+            if (placed) {
+                entries[i].item = NULL;
+                ++task->added;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+    A static function, puts an item, which is not placed into `dst`, 
+    back into the cleared slots of its source `src`.
+    Nothing to returns.
+ */
+static void merge_restore(tb_hash_table *src, tb_hash_table_item *item) {
+    uint64_t h = key_hash(src, item->key);
+    uint32_t try = 0;
+    while (src->items[probe_index(src, h, try)] != NULL) {
+        ++try;
+    }
+    src->items[probe_index(src, h, try)] = item;
+    filter_add(src, item->key);
+    ++src->count;
+    src->empty = 0;
+}
+
+/*
+    A static function, runs a stage of `tb_merge_many` in threads, 
+    the first task runs in this thread.
+    Nothing to returns.
+ */
+static void merge_run(tb_merge_task *tasks, uint32_t threads, void *(*worker)(void *)) {
+    pthread_t *ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    int *started = (int *)calloc(threads, sizeof(int));
+    for (uint32_t t = 1; t < threads; ++t) {
+        if (ids != NULL && started != NULL && pthread_create(&ids[t], NULL, worker, &tasks[t]) == 0) {
+            started[t] = 1;
+        } else {
+            worker(&tasks[t]);
+        }
+    }
+    worker(&tasks[0]);
+    for (uint32_t t = 1; t < threads; ++t) {
+        if (started != NULL && started[t]) {
+            pthread_join(ids[t], NULL);
+        }
+    }
+    free(ids);
+    free(started);
+}
+
+/*
+    The function merges `count` tables `srcs` into `dst`, see `tb_merge`, 
+    the sources are merged in order. If `threads` is more than 1 and 
+    the items of all sources can be moved, the merge is parallel: 
+    the threads hash the keys of the sources, then every thread places 
+    the keys of its part of hashes into the slots of `dst` by 
+    compare-and-swap, so the threads do not lock. `dst` must not be 
+    a `TB_FILTER` table for it. Otherwise the sources are merged one by one.
+    The sources must be different tables.
+    Returns 1 if success, otherwise 0, if `dst` is full, then the items 
+    merged so far are in `dst`, a parallel merge leaves the other items 
+    in their sources.
+ */
+int tb_merge_many(tb_hash_table *dst, tb_hash_table * const *srcs, uint32_t count, 
+        void (*combine)(const char *key, void *dst_val, const void *src_val), uint32_t threads) {
+    uint64_t total = 0;
+    int parallel = threads > 1 && !(dst->flags & TB_FILTER);
+    for (uint32_t s = 0; s < count; ++s) {
+        total += srcs[s]->count;
+        parallel = parallel && merge_movable(dst, srcs[s]);
+    }
+    int reserved = merge_reserve(dst, total);
+    tb_merge_entry **entries = NULL;
+    uint32_t **parts = NULL;
+    uint32_t *next = NULL;
+    tb_merge_task *tasks = NULL;
+    if (parallel && reserved) {
+        entries = (tb_merge_entry **)calloc(count, sizeof(tb_merge_entry *));
+        parts = (uint32_t **)calloc(count, sizeof(uint32_t *));
+        next = (uint32_t *)malloc((size_t)threads * threads * sizeof(uint32_t));
+        tasks = (tb_merge_task *)calloc(threads, sizeof(tb_merge_task));
+        parallel = entries != NULL && parts != NULL && next != NULL && tasks != NULL;
+        for (uint32_t s = 0; s < count && parallel; ++s) {
+            entries[s] = (tb_merge_entry *)malloc(((size_t)srcs[s]->count * 2 + 1) * sizeof(tb_merge_entry));
+            parts[s] = (uint32_t *)calloc((size_t)threads + 1, sizeof(uint32_t));
+            parallel = entries[s] != NULL && parts[s] != NULL;
+        }
+    }
+    if (!parallel || !reserved) {
+        for (uint32_t s = 0; s < count && entries != NULL && parts != NULL; ++s) {
+            free(entries[s]);
+            free(parts[s]);
+        }
+        free(entries);
+        free(parts);
+        free(next);
+        free(tasks);
+        for (uint32_t s = 0; s < count; ++s) {
+            if (!tb_merge(dst, srcs[s], combine)) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (uint32_t t = 0; t < threads; ++t) {
+        tb_merge_task task = {dst, srcs, entries, parts, next + (size_t)t * threads, count, threads, t, 
+            combine, 0, 0, count, 0};
+        tasks[t] = task;
+    }
+    // the threads write the slots directly
+    rehash_abort(dst);
+    for (uint32_t s = 0; s < count; ++s) {
+        rehash_abort(srcs[s]);
+    }
+    merge_run(tasks, threads, merge_hash_worker);
+    merge_run(tasks, threads, merge_insert_worker);
+    for (uint32_t t = 0; t < threads; ++t) {
+        dst->count += tasks[t].added;
+        dst->tombstones -= tasks[t].reused;
+    }
+    dst->empty = !dst->count;
+    int done = 1;
+    for (uint32_t s = 0; s < count; ++s) {
+        merge_finish(srcs[s]);
+        // the items of known keys are left in the entries, and the items 
+        // after the stop of a thread
+        for (uint32_t t = 0; t < threads; ++t) {
+            for (uint32_t i = parts[s][t]; i < parts[s][t + 1]; ++i) {
+                tb_hash_table_item *item = entries[s][i].item;
+                if (item == NULL) {
+                    continue;
+                }
+                if (s < tasks[t].stop_source || (s == tasks[t].stop_source && i < tasks[t].stop_index)) {
+                    tb_delete_table_item(srcs[s], item);
+                } else {
+                    merge_restore(srcs[s], item);
+                    done = 0;
+                }
+            }
+        }
+        free(entries[s]);
+        free(parts[s]);
+    }
+    free(entries);
+    free(parts);
+    free(next);
+    free(tasks);
+    return done;
+}
+
+/*
+    The function creates a read-only snapshot of the table, it shares 
+    the slots with the table. The table can be changed, the snapshot 
+    keeps the items of its time: before a slot is written, the table 
+    saves the page of slots into its snapshots, so only the pages, 
+    which the writes touch, are copied. Removed items are freed with 
+    the last snapshot. Expired items are judged by the time of the snapshot.
+    Snapshots can be read by other threads while one thread changes 
+    the table. Snapshots must be created and deleted by the writer 
+    and deleted before the table.
+    Only tables without `TB_COMPACT` and `TB_CUCKOO` have snapshots.
+    Returns a pointer to the snapshot, or NULL.
+ */
+tb_table_snapshot *tb_snapshot(tb_hash_table *table) {
+    if (table->flags & (TB_COMPACT | TB_CUCKOO)) {
+        return NULL;
+    }
+    tb_table_snapshot *snapshot = (tb_table_snapshot *)malloc(sizeof(tb_table_snapshot));
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    uint32_t pages = (table->allocated + SNAPSHOT_PAGE_SLOTS - 1) >> SNAPSHOT_PAGE_SHIFT;
+    snapshot->pages = (tb_hash_table_item ***)calloc(pages, sizeof(tb_hash_table_item **));
+    if (snapshot->pages == NULL) {
+        free(snapshot);
+        return NULL;
+    }
+    // the snapshot reads the slots, a rehash would free them
+    rehash_abort(table);
+    snapshot->table = table;
+    snapshot->view = *table;
+    snapshot->now = table->flags & TB_TTL ? table->clock() : 0;
+    snapshot->next = table->snapshots;
+    table->snapshots = snapshot;
+    return snapshot;
+}
+
+/*
+    A static function, reads a slot of a snapshot.
+    The saved page is checked after the slot of the table, if the table 
+    has changed the slot, the page is saved before it.
+    Returns the item of the slot at the time of the snapshot.
+ */
+static tb_hash_table_item *snapshot_slot(const tb_table_snapshot * const snapshot, uint32_t index) {
+    tb_hash_table_item *item = __atomic_load_n(&snapshot->view.items[index], __ATOMIC_ACQUIRE);
+    tb_hash_table_item **page = __atomic_load_n(&snapshot->pages[index >> SNAPSHOT_PAGE_SHIFT], 
+            __ATOMIC_ACQUIRE);
+    return page != NULL ? page[index & (SNAPSHOT_PAGE_SLOTS - 1)] : item;
+}
+
+/*
+    The function gets the item by key from a snapshot.
+    Returns the pointer to the item, or NULL.
+ */
+const tb_hash_table_item *tb_snapshot_get_item(const tb_table_snapshot * const snapshot, const char *key) {
+    const tb_hash_table *view = &snapshot->view;
+    uint64_t h = key_hash(view, key);
+    for (uint32_t try = 0; try < view->allocated; ++try) {
+        tb_hash_table_item *item = snapshot_slot(snapshot, probe_index(view, h, try));
+        if (item == NULL) {
+            break;
+        }
+        if (item != EMPTY_ITEM && keys_equal(view, item->key, key, KEY_NUL)) {
+            return (view->flags & TB_TTL) && is_expired(item, snapshot->now) ? NULL : item;
+        }
+    }
+    return NULL;
+}
+
+/*
+    The function gets a value by key from a snapshot.
+    Returns the pointer to a value, or NULL.
+ */
+const void *tb_snapshot_get_value(const tb_table_snapshot * const snapshot, const char *key) {
+    const tb_hash_table_item *item = tb_snapshot_get_item(snapshot, key);
+    return item ? item->val : NULL;
+}
+
+/*
+    The function iterates over all items of a snapshot, see `tb_next_item`.
+    Returns the next item, or NULL at the end.
+ */
+const tb_hash_table_item *tb_snapshot_next_item(const tb_table_snapshot * const snapshot, uint32_t *position) {
+    while (*position < snapshot->view.allocated) {
+        tb_hash_table_item *item = snapshot_slot(snapshot, (*position)++);
+        if (item != NULL && item != EMPTY_ITEM 
+                && !((snapshot->view.flags & TB_TTL) && is_expired(item, snapshot->now))) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/*
+    The function removes a snapshot from memory. The items removed 
+    from the table are freed with the last snapshot.
+    Nothing to returns.
+ */
+void tb_delete_snapshot(tb_table_snapshot *snapshot) {
+    tb_hash_table *table = snapshot->table;
+    tb_table_snapshot **link = (tb_table_snapshot **)&table->snapshots;
+    while (*link != snapshot) {
+        link = &(*link)->next;
+    }
+    *link = snapshot->next;
+    uint32_t pages = (snapshot->view.allocated + SNAPSHOT_PAGE_SLOTS - 1) >> SNAPSHOT_PAGE_SHIFT;
+    for (uint32_t page = 0; page < pages; ++page) {
+        free(snapshot->pages[page]);
+    }
+    free(snapshot->pages);
+    free(snapshot);
+    if (table->snapshots == NULL) {
+        for (uint32_t i = 0; i < table->deferred_count; ++i) {
+            tb_delete_table_item(table, table->deferred[i]);
+        }
+        table->deferred_count = 0;
+    }
+}
+
+/*
+    The header of the segment of a shared table. It is followed by 
+    `allocated` slots of 64 bits and the records. `heap_used` is the end 
+    of the records, `free` are the lists of removed records, linked 
+    by offsets in their values. Writers hold `lock`.
+    `deleted` is the number of removed slots, when they are too many, 
+    the slots are rebuilt, `generation` is odd while they are rebuilt.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t allocated;
+    uint32_t size;
+    uint32_t count;
+    uint32_t deleted;
+    uint32_t generation;
+    uint64_t seed[2];
+    uint64_t heap_used;
+    uint64_t free[SHARED_FREE_LISTS];
+    pthread_mutex_t lock;
+} tb_shared_header;
+
+/*
+    The record of an item of a shared table, aligned to 8 bytes.
+    `bytes` is the size of the record, it never changes. `seq` is even, 
+    while the record keeps an item, and odd, while it is free or written, 
+    readers check that it is the same after they read the record.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t bytes;
+    uint64_t value;
+    char key[];
+} tb_shared_record;
+
+// The slots follow the header from the next cache line.
+#define SHARED_SLOTS_OFFSET ((sizeof(tb_shared_header) + 63) & ~(size_t)63)
+
+/*
+    A static function, the header of a shared table.
+    Returns the header.
+ */
+static inline tb_shared_header *shared_header(const tb_shared_table * const table) {
+    return (tb_shared_header *)table->base;
+}
+
+/*
+    A static function, the record at `offset` of a shared table.
+    Returns the record.
+ */
+static inline tb_shared_record *shared_record(const tb_shared_table * const table, uint64_t offset) {
+    return (tb_shared_record *)(table->base + offset);
+}
+
+/*
+    A static function, the tag of a key in the slots of a shared table.
+    Returns the upper 16 bits of the hash in the upper bits of a slot, never 0.
+ */
+static inline uint64_t shared_tag(uint64_t h) {
+    uint64_t tag = h >> 48;
+    return (tag ? tag : 1) << 48;
+}
+
+/*
+    A static function, searches a key of `length` bytes in a shared table, 
+    `h` is its hash. Readers do not lock, every slot is read once by 
+    an acquire load, a record, which is freed while it is read, 
+    does not match, its key is removed.
+    If the key is found, writes its slot into `found` and its value 
+    into `value`, if it is not NULL.
+    If `free_slot` is not NULL, writes the first free or removed slot 
+    of the probe sequence into it, or -1.
+    Returns the index of the slot, or -1 if the key is not in the table.
+ */
+static int64_t shared_probe(const tb_shared_table * const table, const char *key, size_t length, 
+        uint64_t h, uint64_t *found, uint64_t *value, int64_t *free_slot) {
+    const uint64_t mask = table->allocated - 1;
+    const uint64_t step = (h >> 32) | 1;
+    const uint64_t tag = shared_tag(h);
+    int64_t first_free = -1;
+    for (uint32_t try = 0; try < table->allocated; ++try) {
+        uint32_t index = (uint32_t)((h + try * step) & mask);
+        uint64_t slot = __atomic_load_n(&table->slots[index], __ATOMIC_ACQUIRE);
+        if (slot == 0 || slot == SHARED_DELETED) {
+            if (first_free < 0) {
+                first_free = index;
+            }
+            if (slot == 0) {
+                break;
+            }
+        } else if ((slot & ~SHARED_OFFSET_MASK) == tag) {
+            const tb_shared_record *record = shared_record(table, slot & SHARED_OFFSET_MASK);
+            uint32_t seq = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+            if (!(seq & 1) && length < record->bytes - sizeof(tb_shared_record) 
+                    && memcmp(record->key, key, length + 1) == 0) {
+                uint64_t current = __atomic_load_n(&record->value, __ATOMIC_ACQUIRE);
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&record->seq, __ATOMIC_RELAXED) == seq) {
+                    *found = slot;
+                    if (value != NULL) {
+                        *value = current;
+                    }
+                    return index;
+                }
+            }
+        }
+    }
+    if (free_slot != NULL) {
+        *free_slot = first_free;
+    }
+    return -1;
+}
+
+/*
+    A static function, rebuilds the slots of a shared table without 
+    removed slots, the writers lock. The slots are cleared and every record, 
+    which keeps an item, is placed again, so `count` is counted again.
+    Readers, which miss a key, while `generation` is odd or changed, 
+    search it again. Records are not moved, found keys are valid.
+    Nothing to returns.
+ */
+static void shared_rebuild(tb_shared_table *table, tb_shared_header *header) {
+    const uint64_t mask = table->allocated - 1;
+    uint32_t generation = header->generation | 1;
+    __atomic_store_n(&header->generation, generation, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (uint32_t index = 0; index < table->allocated; ++index) {
+        __atomic_store_n(&table->slots[index], 0, __ATOMIC_RELAXED);
+    }
+    uint32_t count = 0;
+    uint64_t offset = SHARED_SLOTS_OFFSET + (uint64_t)table->allocated * sizeof(uint64_t);
+    while (offset < header->heap_used) {
+        const tb_shared_record *record = shared_record(table, offset);
+        if (!(record->seq & 1)) {
+            uint64_t h = seeded_hash(header->seed, record->key, KEY_NUL);
+            const uint64_t step = (h >> 32) | 1;
+            uint32_t index = (uint32_t)(h & mask);
+            for (uint32_t try = 1; table->slots[index]; ++try) {
+                index = (uint32_t)((h + try * step) & mask);
+            }
+            __atomic_store_n(&table->slots[index], shared_tag(h) | offset, __ATOMIC_RELAXED);
+            ++count;
+        }
+        offset += record->bytes;
+    }
+    __atomic_store_n(&header->count, count, __ATOMIC_RELAXED);
+    header->deleted = 0;
+    __atomic_store_n(&header->generation, generation + 1, __ATOMIC_RELEASE);
+}
+
+/*
+    A static function, takes the lock of the writers of a shared table.
+    If a writer died with the lock, the lock is taken, its record is 
+    either published or not visible, at most `count` is 1 less 
+    and a record is lost. If it died in a rebuild, the slots are rebuilt.
+    Returns 1 if the lock is taken, otherwise 0.
+ */
+static int shared_lock(tb_shared_table *table, tb_shared_header *header) {
+    int error = pthread_mutex_lock(&header->lock);
+    if (error == EOWNERDEAD) {
+        pthread_mutex_consistent(&header->lock);
+        if (header->generation & 1) {
+            shared_rebuild(table, header);
+        }
+        error = 0;
+    }
+    return error == 0;
+}
+
+/*
+    A static function, the free list of records of `bytes` bytes.
+    Returns the index of the list.
+ */
+static inline uint32_t shared_free_list(uint64_t bytes) {
+    uint64_t list = bytes / sizeof(uint64_t) - 3;
+    return list < SHARED_FREE_LISTS - 1 ? (uint32_t)list : SHARED_FREE_LISTS - 1;
+}
+
+/*
+    A static function, takes the first record of at least `bytes` bytes 
+    from the free list `link`, the writers lock.
+    Returns the offset of the record, or 0 if there is not such record.
+ */
+static uint64_t shared_pop(tb_shared_table *table, uint64_t *link, uint64_t bytes) {
+    while (*link) {
+        uint64_t offset = *link;
+        tb_shared_record *record = shared_record(table, offset);
+        if (record->bytes >= bytes) {
+            __atomic_store_n(link, __atomic_load_n(&record->value, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+            return offset;
+        }
+        link = &record->value;
+    }
+    return 0;
+}
+
+/*
+    A static function, takes a record of at least `bytes` bytes from 
+    its free list, from the end of the records or from the lists of bigger 
+    records, the writers lock. The record is odd, it is not visible to readers.
+    Returns the offset of the record, or 0 if the segment is full.
+ */
+static uint64_t shared_alloc(tb_shared_table *table, tb_shared_header *header, uint64_t bytes) {
+    uint32_t list = shared_free_list(bytes);
+    uint64_t offset = shared_pop(table, &header->free[list], bytes);
+    if (offset) {
+        return offset;
+    }
+    if (header->heap_used + bytes <= table->size) {
+        offset = header->heap_used;
+        tb_shared_record *record = shared_record(table, offset);
+        record->seq = 1;
+        record->bytes = (uint32_t)bytes;
+        header->heap_used = offset + bytes;
+        return offset;
+    }
+    // a bigger record is better than a full segment
+    for (++list; list < SHARED_FREE_LISTS && !offset; ++list) {
+        offset = shared_pop(table, &header->free[list], bytes);
+    }
+    return offset;
+}
+
+/*
+    A static function, puts the record at `offset` into its free list, 
+    the writers lock. The record is odd before it is changed, so readers, 
+    which still read it, do not match it.
+    Nothing to returns.
+ */
+static void shared_free(tb_shared_table *table, tb_shared_header *header, uint64_t offset) {
+    tb_shared_record *record = shared_record(table, offset);
+    __atomic_store_n(&record->seq, record->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    uint64_t *head = &header->free[shared_free_list(record->bytes)];
+    __atomic_store_n(&record->value, *head, __ATOMIC_RELAXED);
+    *head = offset;
+}
+
+/*
+    A static function, maps a segment of `size` bytes into this process.
+    Returns a pointer to the table, or NULL.
+ */
+static tb_shared_table *shared_map(int fd, uint64_t size) {
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    tb_shared_table *table = (tb_shared_table *)malloc(sizeof(tb_shared_table));
+    if (table == NULL) {
+        munmap(base, size);
+        return NULL;
+    }
+    table->base = (uint8_t *)base;
+    table->size = size;
+    table->slots = (uint64_t *)(table->base + SHARED_SLOTS_OFFSET);
+    table->allocated = 0;
+    return table;
+}
+
+/*
+    The function creates a table in a new POSIX shared memory segment `name`,
+    see `shm_open`. The table keeps `size` items, `key_bytes` is the total 
+    length of their keys. Other processes open it by `tb_open_shared_table`,
+    or inherit the mapping by `fork`.
+    Keys and values are records, which are never moved, so the readers 
+    do not lock: replaced values are atomic stores of 8 bytes, removed 
+    records and slots are reused, readers check the sequence number 
+    of a record, see `tb_shared_record`. The writers of all processes 
+    are serialized by a process-shared robust mutex.
+    Returns a pointer to the table, or NULL, if the segment exists.
+ */
+tb_shared_table *tb_create_shared_table(const char *name, uint32_t size, uint64_t key_bytes) {
+    uint32_t allocated = capacity_for(size);
+    if (!size || !allocated) {
+        return NULL;
+    }
+    uint64_t heap = SHARED_SLOTS_OFFSET + (uint64_t)allocated * sizeof(uint64_t);
+    // a record is at most 24 bytes more than its key
+    uint64_t bytes = heap + (uint64_t)size * 3 * sizeof(uint64_t) + key_bytes;
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    tb_shared_table *table = NULL;
+    if (ftruncate(fd, (off_t)bytes) == 0) {
+        table = shared_map(fd, bytes);
+    }
+    close(fd);
+    if (table == NULL) {
+        shm_unlink(name);
+        return NULL;
+    }
+    // the segment is zeroed, all slots are free
+    tb_shared_header *header = shared_header(table);
+    header->version = SHARED_VERSION;
+    header->allocated = table->allocated = allocated;
+    header->size = size;
+    header->heap_used = heap;
+    random_seed(header->seed);
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int error = pthread_mutex_init(&header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (error) {
+        tb_close_shared_table(table);
+        shm_unlink(name);
+        return NULL;
+    }
+    // the table is ready for other processes
+    __atomic_store_n(&header->magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+    return table;
+}
+
+/*
+    The function maps the shared table `name` of `tb_create_shared_table`.
+    Returns a pointer to the table, or NULL, if it is not a ready table.
+ */
+tb_shared_table *tb_open_shared_table(const char *name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    tb_shared_table *table = NULL;
+    if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= SHARED_SLOTS_OFFSET) {
+        table = shared_map(fd, (uint64_t)st.st_size);
+    }
+    close(fd);
+    if (table == NULL) {
+        return NULL;
+    }
+    tb_shared_header *header = shared_header(table);
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC 
+            || header->version != SHARED_VERSION 
+            || SHARED_SLOTS_OFFSET + (uint64_t)header->allocated * sizeof(uint64_t) > table->size) {
+        tb_close_shared_table(table);
+        return NULL;
+    }
+    table->allocated = header->allocated;
+    return table;
+}
+
+/*
+    The function inserts a value by key into a shared table.
+    If the key exists, its value is replaced by one atomic store.
+    Returns 1 if success, otherwise 0, if the table or its segment is full.
+ */
+int tb_shared_insert(tb_shared_table *table, const char *key, const void *val) {
+    tb_shared_header *header = shared_header(table);
+    size_t length = strlen(key);
+    uint64_t h = seeded_hash(header->seed, key, KEY_NUL);
+    uint64_t value = 0;
+    memcpy(&value, val, sizeof(void *));
+    if (!shared_lock(table, header)) {
+        return 0;
+    }
+    int done = 0;
+    uint64_t slot;
+    int64_t free_slot;
+    if (shared_probe(table, key, length, h, &slot, NULL, &free_slot) >= 0) {
+        tb_shared_record *record = shared_record(table, slot & SHARED_OFFSET_MASK);
+        __atomic_store_n(&record->value, value, __ATOMIC_RELEASE);
+        done = 1;
+    } else if (header->count < header->size && free_slot >= 0) {
+        uint64_t bytes = (sizeof(tb_shared_record) + length + 1 + 7) & ~(uint64_t)7;
+        uint64_t offset = bytes <= UINT32_MAX ? shared_alloc(table, header, bytes) : 0;
+        if (offset) {
+            tb_shared_record *record = shared_record(table, offset);
+            __atomic_store_n(&record->value, value, __ATOMIC_RELAXED);
+            memcpy(record->key, key, length + 1);
+            // the record is complete before readers see it and its slot
+            __atomic_store_n(&record->seq, record->seq + 1, __ATOMIC_RELEASE);
+            if (table->slots[free_slot] == SHARED_DELETED) {
+                --header->deleted;
+            }
+            __atomic_store_n(&table->slots[free_slot], shared_tag(h) | offset, __ATOMIC_RELEASE);
+            __atomic_store_n(&header->count, header->count + 1, __ATOMIC_RELAXED);
+            done = 1;
+        }
+    }
+    pthread_mutex_unlock(&header->lock);
+    return done;
+}
+
+/*
+    The function gets a value by key from a shared table, 
+    it does not lock and can run with the writers of other processes.
+    A miss during a rebuild of the slots is searched again.
+    Copies the value of 8 bytes into `val`.
+    Returns 1 if the key is found, otherwise 0.
+ */
+int tb_shared_get_value(const tb_shared_table * const table, const char *key, void *val) {
+    const tb_shared_header *header = shared_header(table);
+    size_t length = strlen(key);
+    uint64_t slot;
+    uint64_t value;
+    uint64_t h = seeded_hash(header->seed, key, KEY_NUL);
+    uint32_t generation;
+    do {
+        generation = __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+        if (shared_probe(table, key, length, h, &slot, &value, NULL) >= 0) {
+            memcpy(val, &value, sizeof(void *));
+            return 1;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((generation & 1) || __atomic_load_n(&header->generation, __ATOMIC_RELAXED) != generation);
+    return 0;
+}
+
+/*
+    The function removes a value by key from a shared table.
+    The slot is marked as removed, the record goes to a free list, 
+    readers, which still read it, do not match it. When removed slots 
+    are a half of the slots, which are never used by items, the slots 
+    are rebuilt, so misses do not scan all slots after many deletions.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+int tb_shared_delete(tb_shared_table *table, const char *key) {
+    tb_shared_header *header = shared_header(table);
+    size_t length = strlen(key);
+    uint64_t h = seeded_hash(header->seed, key, KEY_NUL);
+    if (!shared_lock(table, header)) {
+        return 0;
+    }
+    uint64_t slot;
+    int64_t index = shared_probe(table, key, length, h, &slot, NULL, NULL);
+    if (index >= 0) {
+        __atomic_store_n(&table->slots[index], SHARED_DELETED, __ATOMIC_RELEASE);
+        __atomic_store_n(&header->count, header->count - 1, __ATOMIC_RELAXED);
+        shared_free(table, header, slot & SHARED_OFFSET_MASK);
+        if (++header->deleted > (header->allocated - header->size) / 2) {
+            shared_rebuild(table, header);
+        }
+    }
+    pthread_mutex_unlock(&header->lock);
+    return index >= 0;
+}
+
+/*
+    The function gets the number of items of a shared table.
+    Returns the number of items.
+ */
+uint32_t tb_shared_count(const tb_shared_table * const table) {
+    return __atomic_load_n(&shared_header(table)->count, __ATOMIC_RELAXED);
+}
+
+/*
+    The function unmaps a shared table from this process, 
+    the segment stays until `tb_unlink_shared_table`.
+    Nothing to returns.
+ */
+void tb_close_shared_table(tb_shared_table *table) {
+    munmap(table->base, table->size);
+    free(table);
+}
+
+/*
+    The function removes the name of a shared table, see `shm_unlink`.
+    The segment is freed, when all processes close it.
+    Returns 1 if success, otherwise 0.
+ */
+int tb_unlink_shared_table(const char *name) {
+    return shm_unlink(name) == 0;
+}
+
+/*
+    The header of the file of a log, and of every record of the log. 
+    `count` is the number of items of a snapshot, 0 in a log.
+    A record is followed by `length` bytes of the key without NUL, 
+    `checksum` covers the rest of the header and the key, 
+    so the records of a torn write at the end are found.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t count;
+} tb_log_header;
+
+typedef struct {
+    uint32_t checksum;
+    uint32_t length;
+    uint64_t val;
+} tb_log_record;
+
+/*
+    A static function, the checksum of a record of a log, 
+    FNV-1a over the length, the value and the key, folded to 32 bits.
+    Returns the checksum.
+ */
+static uint32_t log_checksum(const tb_log_record *record, const char *key) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const uint8_t *bytes = (const uint8_t *)&record->length;
+    for (size_t i = 0; i < sizeof(tb_log_record) - sizeof(uint32_t); ++i) {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    uint32_t length = record->length & ~LOG_DELETE;
+    for (uint32_t i = 0; i < length; ++i) {
+        h = (h ^ (uint8_t)key[i]) * 0x100000001b3ULL;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/*
+    A static function, the current time of a log in milliseconds.
+    Returns the time.
+ */
+static inline uint64_t log_now(const tb_table_log * const log) {
+    return log->options.clock ? log->options.clock() : monotonic_ms();
+}
+
+/*
+    A static function, writes all `size` bytes of `data` into a file.
+    Returns 1 if success, otherwise 0.
+ */
+static int write_all(int fd, const void *data, uint64_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (size) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        bytes += written;
+        size -= (uint64_t)written;
+    }
+    return 1;
+}
+
+/*
+    A static function, syncs the directory of a file, so a renamed 
+    file is durable.
+    Returns 1 if success, otherwise 0.
+ */
+static int sync_directory(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *directory = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+    if (directory == NULL) {
+        return 0;
+    }
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    free(directory);
+    if (fd < 0) {
+        return 0;
+    }
+    int done = fsync(fd) == 0;
+    close(fd);
+    return done;
+}
+
+/*
+    A static function, inserts a recovered item into the table of a log.
+    A full table grows, but `TB_LRU` tables evict items as usual.
+    Returns 1 if success, otherwise 0.
+ */
+static int log_restore(tb_table_log *log, const char *key, uint32_t length, const void *val) {
+    tb_hash_table *table = log->table;
+    if (!(table->flags & TB_LRU) && table->count >= table->size 
+            && !tb_reserve(table, table->size <= UINT32_MAX / 2 ? table->size * 2 : UINT32_MAX)) {
+        return 0;
+    }
+    return insert_item(table, key, length, val, table->ttl, NULL) != NULL;
+}
+
+/*
+    A static function, applies the records of a log or a snapshot 
+    of `size` bytes from `offset` to the table of the log, 
+    it stops at the first broken record.
+    Returns the offset after the last applied record, 
+    or 0 if an item can not be inserted.
+ */
+static uint64_t log_apply(tb_table_log *log, const uint8_t *data, uint64_t size, uint64_t offset) {
+    while (offset + sizeof(tb_log_record) <= size) {
+        tb_log_record record;
+        memcpy(&record, data + offset, sizeof(record));
+        const char *key = (const char *)data + offset + sizeof(record);
+        uint32_t length = record.length & ~LOG_DELETE;
+        if (offset + sizeof(record) + length > size || record.checksum != log_checksum(&record, key)) {
+            break;
+        }
+        if (record.length & LOG_DELETE) {
+            tb_delete_item_n(log->table, key, length);
+        } else if (!log_restore(log, key, length, &record.val)) {
+            return 0;
+        }
+        offset += sizeof(record) + length;
+    }
+    return offset;
+}
+
+/*
+    A static function, loads the snapshot of the last compaction into 
+    the table of a log, the table is presized for its items.
+    Returns 1 if success or if there is no snapshot, 
+    otherwise 0, if the snapshot is broken or the items do not fit.
+ */
+static int log_load_snapshot(tb_table_log *log) {
+    int fd = open(log->snapshot, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= sizeof(tb_log_header)) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+    madvise(data, size, MADV_SEQUENTIAL);
+    const tb_log_header *header = (const tb_log_header *)data;
+    int done = header->magic == LOG_MAGIC && header->version == LOG_VERSION 
+        && ((log->table->flags & TB_LRU) || tb_reserve(log->table, header->count)) 
+        && log_apply(log, (const uint8_t *)data, size, sizeof(tb_log_header)) == size;
+    munmap(data, size);
+    return done;
+}
+
+/*
+    A static function, replays the file of a log into its table.
+    The file is mapped and read once from the start, the replay stops 
+    at the first broken record, the file is cut there, so new records 
+    follow the last complete one. A new file gets the header.
+    Returns 1 if success, otherwise 0, if the file is broken 
+    or an item can not be inserted.
+ */
+static int log_replay(tb_table_log *log) {
+    struct stat st;
+    if (fstat(log->fd, &st) != 0) {
+        return 0;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+    if (size < sizeof(tb_log_header)) {
+        tb_log_header header = {LOG_MAGIC, LOG_VERSION, 0};
+        log->log_bytes = sizeof(tb_log_header);
+        return ftruncate(log->fd, 0) == 0 && write_all(log->fd, &header, sizeof(header)) 
+            && fdatasync(log->fd) == 0;
+    }
+    uint8_t *data = (uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, log->fd, 0);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    const tb_log_header *header = (const tb_log_header *)data;
+    uint64_t offset = 0;
+    if (header->magic == LOG_MAGIC && header->version == LOG_VERSION) {
+        offset = log_apply(log, data, size, sizeof(tb_log_header));
+    }
+    munmap(data, size);
+    if (!offset) {
+        return 0;
+    }
+    log->log_bytes = offset;
+    if (offset < size && ftruncate(log->fd, (off_t)offset) != 0) {
+        return 0;
+    }
+    return lseek(log->fd, (off_t)offset, SEEK_SET) == (off_t)offset;
+}
+
+/*
+    A static function, writes the items of the table of a log into 
+    the file of a snapshot: the header with the number of items and 
+    a record of every item, as in the log, they are written in blocks.
+    Returns 1 if success, otherwise 0.
+ */
+static int log_write_snapshot(tb_table_log *log, int fd) {
+    const uint64_t capacity = 64 * MEMORY_PAGE;
+    uint8_t *buffer = (uint8_t *)malloc(capacity);
+    tb_log_header header = {LOG_MAGIC, LOG_VERSION, log->table->count};
+    int done = buffer != NULL && write_all(fd, &header, sizeof(header));
+    uint64_t buffered = 0;
+    uint32_t position = 0;
+    const tb_hash_table_item *item;
+    while (done && (item = tb_next_item(log->table, &position)) != NULL) {
+        size_t length = strlen(item->key);
+        if (length >= LOG_DELETE) {
+            done = 0;
+            break;
+        }
+        tb_log_record record = {0, (uint32_t)length, 0};
+        memcpy(&record.val, item->val, sizeof(void *));
+        record.checksum = log_checksum(&record, item->key);
+        if (buffered + sizeof(record) + length > capacity) {
+            done = write_all(fd, buffer, buffered);
+            buffered = 0;
+        }
+        if (sizeof(record) + length > capacity) {
+            // a huge key is written past the buffer
+            done = done && write_all(fd, &record, sizeof(record)) && write_all(fd, item->key, length);
+            continue;
+        }
+        memcpy(buffer + buffered, &record, sizeof(record));
+        memcpy(buffer + buffered + sizeof(record), item->key, length);
+        buffered += sizeof(record) + length;
+    }
+    done = done && write_all(fd, buffer, buffered);
+    free(buffer);
+    return done;
+}
+
+/*
+    A static function, concatenates two strings.
+    Returns a new string, or NULL.
+ */
+static char *concat(const char *first, const char *second) {
+    size_t length = strlen(first);
+    char *result = (char *)malloc(length + strlen(second) + 1);
+    if (result != NULL) {
+        memcpy(result, first, length);
+        strcpy(result + length, second);
+    }
+    return result;
+}
+
+/*
+    The function opens the write-ahead log `path` of a table, the table 
+    is recovered from it: the snapshot of the last compaction, `path` 
+    with ".snapshot", is loaded, then the operations of the log are replayed. 
+    `options` can be NULL, then every operation is synced.
+    Changes of the table by `tb_log_insert_item` and `tb_log_delete_item` 
+    are appended to the log. Values are logged as `sizeof(void *)` bytes.
+    The recovered items of `TB_TTL` tables get the default `ttl`, 
+    `TB_LRU` tables do not keep the order of use.
+    Returns a pointer to the log, or NULL, if the files are broken, or 
+    the table is `TB_INTERNED`, the keys of which the log can not own, 
+    or `TB_MULTI`, the runs of which the log does not keep.
+ */
+tb_table_log *tb_open_table_log(tb_hash_table *table, const char *path, 
+        const tb_log_options *options) {
+    if (table->flags & (TB_INTERNED | TB_MULTI)) {
+        return NULL;
+    }
+    tb_table_log *log = (tb_table_log *)calloc(1, sizeof(tb_table_log));
+    if (log == NULL) {
+        return NULL;
+    }
+    log->table = table;
+    log->fd = -1;
+    if (options != NULL) {
+        log->options = *options;
+    }
+    log->path = strdup(path);
+    log->snapshot = concat(path, LOG_SNAPSHOT);
+    if (log->path == NULL || log->snapshot == NULL || !log_load_snapshot(log)) {
+        goto error;
+    }
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0 || !log_replay(log)) {
+        goto error;
+    }
+    return log;
+error:
+    if (log->fd >= 0) {
+        close(log->fd);
+    }
+    free(log->path);
+    free(log->snapshot);
+    free(log);
+    return NULL;
+}
+
+/*
+    A static function, appends a record to the buffer of a log and 
+    commits the group, if it is full, or its window ended.
+    Returns 1 if success, otherwise 0.
+ */
+static int log_append(tb_table_log *log, const char *key, uint32_t flags, const void *val) {
+    size_t length = strlen(key);
+    if (length >= LOG_DELETE) {
+        return 0;
+    }
+    uint64_t bytes = sizeof(tb_log_record) + length;
+    if (log->buffered + bytes > log->capacity) {
+        uint64_t capacity = log->capacity ? log->capacity : MEMORY_PAGE;
+        while (capacity < log->buffered + bytes) {
+            capacity *= 2;
+        }
+        uint8_t *buffer = (uint8_t *)realloc(log->buffer, capacity);
+        if (buffer == NULL) {
+            return 0;
+        }
+        log->buffer = buffer;
+        log->capacity = capacity;
+    }
+    tb_log_record record = {0, (uint32_t)length | flags, 0};
+    if (val != NULL) {
+        memcpy(&record.val, val, sizeof(void *));
+    }
+    record.checksum = log_checksum(&record, key);
+    memcpy(log->buffer + log->buffered, &record, sizeof(record));
+    memcpy(log->buffer + log->buffered + sizeof(record), key, length);
+    log->buffered += bytes;
+    uint64_t now = log_now(log);
+    if (!log->pending++) {
+        log->first_pending = now;
+    }
+    if (log->options.window && now - log->first_pending < log->options.window 
+            && (!log->options.batch || log->pending < log->options.batch)) {
+        return 1;
+    }
+    return tb_log_sync(log);
+}
+
+/*
+    The function inserts a value by key into the table of a log, 
+    see `tb_insert_item`, and appends the insertion to the log.
+    Returns 1 if success, otherwise 0, if the table is full, 
+    or the log can not be written.
+ */
+int tb_log_insert_item(tb_table_log *log, const char *key, const void *val) {
+    if (insert_item(log->table, key, KEY_NUL, val, log->table->ttl, NULL) == NULL) {
+        return 0;
+    }
+    return log_append(log, key, 0, val);
+}
+
+/*
+    The function removes a value by key from the table of a log, 
+    see `tb_delete_item`, and appends the deletion to the log.
+    Returns 1 if the deletion is successful, otherwise returns 0.
+ */
+int tb_log_delete_item(tb_table_log *log, const char *key) {
+    if (!tb_delete_item(log->table, key)) {
+        return 0;
+    }
+    return log_append(log, key, LOG_DELETE, NULL);
+}
+
+/*
+    A static function, commits the group of pending operations of a log: 
+    they are written with one `write` and synced with one `fdatasync`.
+    If it fails, the log is cut back to its last commit, the group stays 
+    in the buffer and the next commit writes it again at the same offset.
+    Returns 1 if success, otherwise 0.
+ */
+static int log_commit(tb_table_log *log) {
+    if (!log->pending) {
+        return 1;
+    }
+    if (!write_all(log->fd, log->buffer, log->buffered) || fdatasync(log->fd) != 0) {
+        // the bytes of a partial write are cut, if the cut fails, 
+        // the next group overwrites them, it is not shorter
+        int cut = ftruncate(log->fd, (off_t)log->log_bytes);
+        (void)cut;
+        lseek(log->fd, (off_t)log->log_bytes, SEEK_SET);
+        return 0;
+    }
+    log->log_bytes += log->buffered;
+    log->buffered = 0;
+    log->pending = 0;
+    ++log->commits;
+    return 1;
+}
+
+/*
+    The function commits the pending operations of a log, see `log_commit`.
+    If the log is bigger than `compact_bytes`, it is compacted, a failed 
+    compaction is tried again by the next sync.
+    Call it when the writer is idle, so the last operations are durable 
+    in the window.
+    Returns 1 if the operations are durable, otherwise 0.
+ */
+int tb_log_sync(tb_table_log *log) {
+    if (!log_commit(log)) {
+        return 0;
+    }
+    if (log->options.compact_bytes && log->log_bytes >= log->options.compact_bytes) {
+        // the operations are durable, even if the compaction fails
+        tb_log_compact(log);
+    }
+    return 1;
+}
+
+/*
+    The function compacts a log: the items of the table are written into 
+    the snapshot, then the log is emptied.
+    The snapshot replaces the previous one by `rename`, if the process 
+    stops before the log is emptied, the recovery replays the log 
+    over the new snapshot, it gives the same table.
+    Returns 1 if success, otherwise 0.
+ */
+int tb_log_compact(tb_table_log *log) {
+    // the operations are durable, even if the compaction fails
+    if (!log_commit(log)) {
+        return 0;
+    }
+    char *temporary = concat(log->snapshot, LOG_TEMPORARY);
+    int fd = temporary ? open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    int done = fd >= 0 && log_write_snapshot(log, fd) && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    done = done && rename(temporary, log->snapshot) == 0 && sync_directory(log->snapshot);
+    if (!done && temporary != NULL) {
+        unlink(temporary);
+    }
+    free(temporary);
+    if (!done) {
+        return 0;
+    }
+    if (ftruncate(log->fd, sizeof(tb_log_header)) != 0 
+            || lseek(log->fd, sizeof(tb_log_header), SEEK_SET) != sizeof(tb_log_header)
+            || fdatasync(log->fd) != 0) {
+        return 0;
+    }
+    log->log_bytes = sizeof(tb_log_header);
+    ++log->compactions;
+    return 1;
+}
+
+/*
+    The function commits the pending operations of a log and closes it, 
+    the table is not deleted.
+    Returns 1 if the operations are durable, otherwise 0.
+ */
+int tb_close_table_log(tb_table_log *log) {
+    int done = tb_log_sync(log);
+    close(log->fd);
+    free(log->buffer);
+    free(log->path);
+    free(log->snapshot);
+    free(log);
+    return done;
+}
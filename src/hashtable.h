@@ -2,6 +2,7 @@
 #define HASHTABLE_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,6 +41,12 @@ extern "C" {
     *value; \
 })
 
+/*
+    A macro to get the pointer to the value `index` of the values 
+    of `tb_get_all_values`.
+ */
+#define TB_VALUE_AT(values, index) ((void *)((char *)(values) + (size_t)(index) * sizeof(void *)))
+
 
 /*   
     The hashtable item struct.
@@ -53,6 +60,167 @@ typedef struct {
     void *val;
 } tb_hash_table_item;
 
+/*
+    Flags of the table, see `tb_hash_table_options`.
+    `TB_COMPACT` - the insertion-ordered compact layout. Items are stored
+    in a dense array `entries` in insertion order, `index` is a small array
+    of 8, 16 or 32-bit positions in `entries`. `items` is NULL.
+    Pointers to items are valid until the next insertion.
+ */
+#define TB_COMPACT 0x1
+
+/*
+    `TB_LRU` - the bounded cache. If the table is full, an insertion 
+    of a new key evicts the least recently used item. Lookups count 
+    `hits` and `misses` and make the found item the most recently used.
+    So the lookups of a `TB_LRU` table are writes, though `tb_get_value`, 
+    `tb_get_values`, `tb_get_item` and their `_n` functions take a const 
+    table: concurrent readers need the same lock as writers.
+    Can not be combined with `TB_COMPACT`.
+ */
+#define TB_LRU 0x2
+
+/*
+    `TB_TTL` - items expire. Every item has a time to live, see 
+    `tb_insert_item_ttl`, lookups do not return expired items.
+    Expired items are removed step by step, by insertions, deletions 
+    and `tb_expire_step`, until then they are counted in `count`.
+    Can not be combined with `TB_COMPACT`.
+ */
+#define TB_TTL 0x4
+
+/*
+    `TB_FILTER` - misses are short-circuited. The table keeps a counting 
+    Bloom filter of its keys, about 5 bytes per key of `size`, lookups 
+    and deletions of keys that are surely not in the table do not probe it.
+ */
+#define TB_FILTER 0x8
+
+/*
+    `TB_SEEDED` - keys are hashed by SipHash-1-3 with a secret 128-bit seed 
+    of the table, so crafted keys can not collide on purpose. The seed is 
+    `seed` of the options, or a random one if it is zero.
+ */
+#define TB_SEEDED 0x10
+
+/*
+    `TB_CUCKOO` - bucketized cuckoo hashing. A key is in one of two buckets 
+    of 4 slots, every bucket is one cache line, so a lookup reads at most 
+    two lines of the table, and a small stash if an insertion could not 
+    place an item. If the stash is full, the buckets are doubled.
+    `items` is NULL. Can not be combined with `TB_COMPACT`, `TB_LRU`, 
+    `TB_TTL` and `TB_FILTER`, `probing` is not used.
+ */
+#define TB_CUCKOO 0x20
+
+/*
+    `TB_INTERNED` - keys are interned by the caller: equal keys are 
+    the same pointer. Keys are not copied, they must be valid until 
+    they are removed from the table. Lookups hash and compare pointers, 
+    the bytes of keys are not read.
+ */
+#define TB_INTERNED 0x40
+
+/*
+    `TB_MULTI` - a key has many values, see `tb_append_value`. The values 
+    of a key are one run in its item, in the order of appends, so all 
+    of them are found by one probe. The run grows twice, when it is full.
+    `tb_insert_item` and `tb_get_value` set and get the first value, 
+    frozen tables keep only the first value. Can not be combined with 
+    `TB_COMPACT`, `TB_CUCKOO`, `TB_LRU` and `TB_TTL`.
+ */
+#define TB_MULTI 0x80
+
+/*
+    The probing strategies of `probing` in `tb_hash_table_options`.
+    `TB_PROBE_DOUBLE` - double hashing, the default, the step depends on the key.
+    `TB_PROBE_QUADRATIC` - the steps are 1, 2, 3 ... slots.
+    `TB_PROBE_LINEAR` - the step is 1 slot, it is the most cache friendly, 
+    but keys form long clusters.
+ */
+#define TB_PROBE_DOUBLE 0
+#define TB_PROBE_QUADRATIC 1
+#define TB_PROBE_LINEAR 2
+
+/*
+    The memory flags of `memory` in `tb_hash_table_options`, they place 
+    the slot array of the table and the blocks of small items.
+    `TB_MEMORY_HUGE_2MB` and `TB_MEMORY_HUGE_1GB` - huge pages of 2 MB or 1 GB 
+    from the reserved pool of the system, if it has not enough of them, 
+    transparent huge pages are used.
+    `TB_MEMORY_THP` - transparent huge pages, the memory is aligned to 2 MB.
+    `TB_MEMORY_PREFAULT` - the memory is touched when it is allocated, 
+    so the first lookups do not take page faults.
+    `TB_MEMORY_NUMA_BIND` - the memory is on the NUMA nodes of `numa_nodes`.
+    `TB_MEMORY_NUMA_INTERLEAVE` - the pages are interleaved over the nodes 
+    of `numa_nodes`.
+    They are supported on Linux, on other systems the memory is from `malloc`.
+ */
+#define TB_MEMORY_HUGE_2MB 0x1
+#define TB_MEMORY_HUGE_1GB 0x2
+#define TB_MEMORY_THP 0x4
+#define TB_MEMORY_PREFAULT 0x8
+#define TB_MEMORY_NUMA_BIND 0x10
+#define TB_MEMORY_NUMA_INTERLEAVE 0x20
+
+/*
+    The number of size classes of the pool of item blocks, see `pool`.
+ */
+#define TB_POOL_CLASSES 16
+
+/*
+    The options of a new table, see `tb_create_hash_table_ex`.
+    `flags` is 0 or a combination of `TB_*` flags.
+    `ttl` is the default time to live of `TB_TTL` tables in milliseconds, 
+    0 is never.
+    `clock` returns the current time in milliseconds for `TB_TTL` tables,
+    NULL is the monotonic clock.
+    `seed` is the seed of `TB_SEEDED` tables, zero is a random seed.
+    `probing` is one of `TB_PROBE_*` strategies.
+    `memory` is 0 or a combination of `TB_MEMORY_*` flags.
+    `numa_nodes` is the mask of NUMA nodes, bit 0 is node 0.
+ */
+typedef struct {
+    uint32_t flags;
+    uint64_t ttl;
+    uint64_t (*clock)(void);
+    uint64_t seed[2];
+    uint32_t probing;
+    uint32_t memory;
+    uint64_t numa_nodes;
+} tb_hash_table_options;
+
+/*
+    The operations of `tb_trace_event`.
+    `TB_TRACE_INSERT` - `tb_insert_item`, `tb_insert_item_ttl`, `tb_insert_item_n` 
+        and `tb_exchange_item_n`.
+    `TB_TRACE_GET` - `tb_get_value`, `tb_get_item` and their `_n` functions.
+    `TB_TRACE_DELETE` - `tb_delete_item`, `tb_delete_item_n` and `tb_pop_item_n`.
+    `TB_TRACE_RESIZE` - `tb_reserve` and the growth of `TB_CUCKOO` tables.
+ */
+#define TB_TRACE_INSERT 0
+#define TB_TRACE_GET 1
+#define TB_TRACE_DELETE 2
+#define TB_TRACE_RESIZE 3
+
+/*
+    The event of an operation of a traced table, see `tb_set_trace`.
+    `operation` is one of `TB_TRACE_*`. `key` and `length` are the key 
+    of the operation, the key does not need NUL at the end, it is NULL 
+    for resizes. `probes` is the number of slots, which a lookup of 
+    the key checks, it is counted after insertions and lookups and 
+    before deletions; for resizes it is the new number of slots.
+    `cycles` is the time of the operation in CPU cycles, the time stamp 
+    counter on x86, the virtual counter on ARM64, otherwise nanoseconds.
+ */
+typedef struct {
+    uint32_t operation;
+    uint32_t probes;
+    uint64_t cycles;
+    const char *key;
+    size_t length;
+} tb_trace_event;
+
 /* 
     The hash table struct.
     `size` is the size of the table.
@@ -60,15 +228,176 @@ typedef struct {
     `empty` is 1 or 0.  
     `items` is an array of pointers.
     `size` and `count` must be unsigned int and greater that 0.
+    `allocated` is the number of slots, a power of two, at least 25% of 
+    them are free. `probing` is the probing strategy.
+    `flags` is the flags from `tb_hash_table_options`.
+    `entries`, `used`, `index` and `index_width` are used only 
+    by `TB_COMPACT` tables. `used` is the number of filled entries, 
+    including deleted ones. `index_width` is 1, 2 or 4 bytes.
+    `hits`, `misses` and `evictions` are counters of `TB_LRU` tables.
+    `lru_head` and `lru_tail` are the most and the least recently used items.
+    `ttl`, `clock` and `expire_cursor` are used by `TB_TTL` tables,
+    `expire_cursor` is the next slot for `tb_expire_step`.
+    `filter` and `filter_blocks` are the filter of `TB_FILTER` tables 
+    and the number of its 64-byte blocks.
+    `seed` is the key of the hash of `TB_SEEDED` tables.
+    `buckets`, `bucket_mask`, `stash` and `stash_count` are used 
+    by `TB_CUCKOO` tables, `allocated` is the number of slots in `buckets`.
+    `pool` keeps the blocks of removed items for new ones, a block is 
+    an item with its value and key, the lists are by size in 16-byte steps, 
+    `pooled` is the number of blocks in them, at most `size`.
+    `snapshots` is the list of snapshots, `deferred` are the removed items,
+    which they can read, see `tb_snapshot`.
+    `memory` and `numa_nodes` are from `tb_hash_table_options`, `arena` is 
+    the list of memory chunks for small items, if `memory` is not 0.
+    `trace` and `trace_context` are the callback of `tb_set_trace`.
+    `tombstones` is the number of EMPTY_ITEM slots. `rehash` is NULL, or 
+    the new slots of a purge of tombstones or of `tb_shrink_to_fit`, 
+    `rehash_allocated` is their number, `rehash_tombstones` is the number 
+    of EMPTY_ITEM in them. The slots before `rehash_cursor` are moved, 
+    see `tb_rehash_step`.
 */
-typedef struct {
+typedef struct tb_hash_table {
     uint32_t allocated;
     uint32_t size;
     uint32_t count;
     tb_hash_table_item **items;
     int empty;
+    uint32_t flags;
+    tb_hash_table_item *entries;
+    uint32_t used;
+    void *index;
+    uint32_t index_width;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    void *lru_head;
+    void *lru_tail;
+    uint64_t ttl;
+    uint64_t (*clock)(void);
+    uint32_t expire_cursor;
+    uint8_t *filter;
+    uint32_t filter_blocks;
+    uint64_t seed[2];
+    uint32_t probing;
+    void *buckets;
+    uint32_t bucket_mask;
+    tb_hash_table_item **stash;
+    uint32_t stash_count;
+    void *pool[TB_POOL_CLASSES];
+    uint32_t pooled;
+    struct tb_table_snapshot *snapshots;
+    tb_hash_table_item **deferred;
+    uint32_t deferred_count;
+    uint32_t deferred_capacity;
+    uint32_t memory;
+    uint64_t numa_nodes;
+    void *arena;
+    void (*trace)(const struct tb_hash_table *table, const tb_trace_event *event, void *context);
+    void *trace_context;
+    uint32_t tombstones;
+    tb_hash_table_item **rehash;
+    uint32_t rehash_allocated;
+    uint32_t rehash_cursor;
+    uint32_t rehash_tombstones;
 } tb_hash_table;
 
+/*
+    The read-only snapshot of a table, see `tb_snapshot`.
+    `view` is the table at the time of the snapshot, its `items` are 
+    the slots of `table`. `pages` are the saved pages of slots, NULL 
+    if the page is not changed. `now` is the time of the snapshot 
+    for `TB_TTL` tables. `next` is the next snapshot of the table.
+ */
+typedef struct tb_table_snapshot {
+    tb_hash_table *table;
+    tb_hash_table view;
+    tb_hash_table_item ***pages;
+    uint64_t now;
+    struct tb_table_snapshot *next;
+} tb_table_snapshot;
+
+/*
+    The frozen, read-only table, see `tb_freeze`.
+    `data` is the buffer of `size` bytes with all the table, 
+    it can be saved and opened by `tb_open_frozen_table`.
+    `count` is the number of keys and slots, `buckets` is the number 
+    of `pilots`, `offsets` are the offsets of the records in `data`.
+    Pilots place keys into `positions` positions, a bit more than `count`,
+    `remap` are the slots of the positions after `count`.
+    `owner` is 1 if `data` is freed with the table.
+ */
+typedef struct {
+    const void *data;
+    uint64_t size;
+    uint32_t count;
+    uint32_t positions;
+    uint32_t buckets;
+    uint64_t seed[2];
+    const uint16_t *pilots;
+    const uint32_t *remap;
+    const uint32_t *offsets;
+    int owner;
+} tb_frozen_table;
+
+/*
+    The table in a POSIX shared memory segment, see `tb_create_shared_table`.
+    It is the mapping of the segment in this process: `base` and `size`.
+    The segment has a header, `allocated` slots and the records of items, 
+    they refer to each other by offsets, not pointers, so every process 
+    can map the segment at any address.
+ */
+typedef struct {
+    uint8_t *base;
+    uint64_t size;
+    uint64_t *slots;
+    uint32_t allocated;
+} tb_shared_table;
+
+/*
+    The options of the log of a table, see `tb_open_table_log`.
+    `window` is the durability window in milliseconds: operations are 
+    written and synced to the file in groups, an operation is durable 
+    at most `window` after it, if more operations follow it or 
+    `tb_log_sync` is called. 0 syncs every operation.
+    `batch` is the number of operations, which are synced at once, 
+    before the window ends, 0 is no limit.
+    `compact_bytes` is the size of the log file, which starts 
+    a compaction, see `tb_log_compact`, 0 is never.
+    `clock` returns the current time in milliseconds, NULL is the monotonic clock.
+ */
+typedef struct {
+    uint64_t window;
+    uint32_t batch;
+    uint64_t compact_bytes;
+    uint64_t (*clock)(void);
+} tb_log_options;
+
+/*
+    The write-ahead log of a table, see `tb_open_table_log`.
+    `table` is the table of the log, `path` is the file of the log, 
+    `snapshot` is the file of the last compaction.
+    `buffer` keeps `buffered` bytes of `pending` operations, which are 
+    not written yet, `first_pending` is the time of the first of them.
+    `log_bytes` is the size of the written log. `commits` is the number 
+    of group commits, `compactions` is the number of compactions.
+ */
+typedef struct {
+    tb_hash_table *table;
+    char *path;
+    char *snapshot;
+    int fd;
+    tb_log_options options;
+    uint8_t *buffer;
+    uint64_t buffered;
+    uint64_t capacity;
+    uint32_t pending;
+    uint64_t first_pending;
+    uint64_t log_bytes;
+    uint64_t commits;
+    uint64_t compactions;
+} tb_table_log;
+
 /*
     A variable EMPTY_ITEM, for check all EMPTY_ITEM items in table.
     Key and val must be null.
@@ -77,12 +406,76 @@ extern tb_hash_table_item *EMPTY_ITEM;
 
 // The functions from `hastable.c`
 tb_hash_table_item *tb_get_item(const tb_hash_table * const table, const char* key);
+tb_hash_table_item *tb_get_item_n(const tb_hash_table * const table, const char *key, size_t length);
 tb_hash_table_item *tb_find_item(const tb_hash_table * const table, const char* key);
 tb_hash_table *tb_create_hash_table(uint32_t size);
+tb_hash_table *tb_create_hash_table_ex(uint32_t size, const tb_hash_table_options *options);
+tb_hash_table *tb_copy_hash_table(const tb_hash_table * const table);
 void tb_insert_item(tb_hash_table *table, const char* key, const void* val);
+void tb_insert_item_ttl(tb_hash_table *table, const char* key, const void* val, uint64_t ttl);
+tb_hash_table_item *tb_insert_item_n(tb_hash_table *table, const char *key, 
+        size_t length, const void *val);
+tb_hash_table_item *tb_exchange_item_n(tb_hash_table *table, const char *key, 
+        size_t length, const void *val, void *old);
 void *tb_get_value(const tb_hash_table * const table, const char* key);
+void *tb_get_value_n(const tb_hash_table * const table, const char *key, size_t length);
+uint32_t tb_get_values(const tb_hash_table * const table, const char * const *keys, 
+        uint32_t count, void **values);
 int tb_delete_item(tb_hash_table *table, const char* key);
+int tb_delete_item_n(tb_hash_table *table, const char *key, size_t length);
+int tb_pop_item_n(tb_hash_table *table, const char *key, size_t length, void *val);
+uint32_t tb_delete_items(tb_hash_table *table, const char * const *keys, 
+        uint32_t count, int *deleted);
+uint32_t tb_append_value(tb_hash_table *table, const char *key, const void *val);
+uint32_t tb_append_value_n(tb_hash_table *table, const char *key, size_t length, const void *val);
+void *tb_get_all_values(const tb_hash_table * const table, const char *key, uint32_t *count);
+void *tb_get_all_values_n(const tb_hash_table * const table, const char *key, 
+        size_t length, uint32_t *count);
+void *tb_item_values(const tb_hash_table * const table, const tb_hash_table_item *item, 
+        uint32_t *count);
+int tb_delete_value(tb_hash_table *table, const char *key, const void *val);
 void tb_delete_hash_table(tb_hash_table *table);
+uint32_t tb_expire_step(tb_hash_table *table, uint32_t slots);
+tb_hash_table_item *tb_next_item(const tb_hash_table * const table, uint32_t *position);
+uint32_t tb_item_position(const tb_hash_table * const table, const tb_hash_table_item *item);
+uint32_t tb_probe_length(const tb_hash_table * const table, const char *key);
+void tb_set_trace(tb_hash_table *table, 
+        void (*trace)(const tb_hash_table *table, const tb_trace_event *event, void *context), 
+        void *context);
+tb_frozen_table *tb_freeze(const tb_hash_table * const table);
+tb_frozen_table *tb_open_frozen_table(const void *data, uint64_t size);
+void *tb_frozen_get_value(const tb_frozen_table * const table, const char *key);
+const char *tb_frozen_key_at(const tb_frozen_table * const table, uint32_t slot, void **val);
+void tb_delete_frozen_table(tb_frozen_table *table);
+int tb_clear(tb_hash_table *table);
+int tb_reserve(tb_hash_table *table, uint32_t size);
+int tb_shrink_to_fit(tb_hash_table *table);
+uint32_t tb_rehash_step(tb_hash_table *table, uint32_t slots);
+int tb_merge(tb_hash_table *dst, tb_hash_table *src, 
+        void (*combine)(const char *key, void *dst_val, const void *src_val));
+int tb_merge_many(tb_hash_table *dst, tb_hash_table * const *srcs, uint32_t count, 
+        void (*combine)(const char *key, void *dst_val, const void *src_val), uint32_t threads);
+tb_table_snapshot *tb_snapshot(tb_hash_table *table);
+const tb_hash_table_item *tb_snapshot_get_item(const tb_table_snapshot * const snapshot, const char *key);
+const void *tb_snapshot_get_value(const tb_table_snapshot * const snapshot, const char *key);
+const tb_hash_table_item *tb_snapshot_next_item(const tb_table_snapshot * const snapshot, 
+        uint32_t *position);
+void tb_delete_snapshot(tb_table_snapshot *snapshot);
+tb_shared_table *tb_create_shared_table(const char *name, uint32_t size, uint64_t key_bytes);
+tb_shared_table *tb_open_shared_table(const char *name);
+int tb_shared_insert(tb_shared_table *table, const char *key, const void *val);
+int tb_shared_get_value(const tb_shared_table * const table, const char *key, void *val);
+int tb_shared_delete(tb_shared_table *table, const char *key);
+uint32_t tb_shared_count(const tb_shared_table * const table);
+void tb_close_shared_table(tb_shared_table *table);
+int tb_unlink_shared_table(const char *name);
+tb_table_log *tb_open_table_log(tb_hash_table *table, const char *path, 
+        const tb_log_options *options);
+int tb_log_insert_item(tb_table_log *log, const char *key, const void *val);
+int tb_log_delete_item(tb_table_log *log, const char *key);
+int tb_log_sync(tb_table_log *log);
+int tb_log_compact(tb_table_log *log);
+int tb_close_table_log(tb_table_log *log);
 
 #ifdef __cplusplus
 }
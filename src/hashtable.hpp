@@ -0,0 +1,492 @@
+/*
+    The C++17 wrapper of the hash table, see hashtable.h for the engine.
+    `tb::hash_table<Key, Value, Hash, Alloc>` keeps the keys in the table
+    and the values by move. A value, which fits into the 8 bytes of
+    the value of an item and is trivially copyable, is kept in the item,
+    other values are allocated by `Alloc` and the item keeps the pointer.
+    Lookups take `std::string_view`, the keys are not copied into strings.
+    The engine keeps keys with NUL, so keys with NUL bytes are rejected.
+ */
+#ifndef HASHTABLE_HPP
+#define HASHTABLE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "hashtable.h"
+
+namespace tb {
+
+/*
+    The hashes of `hash_table`. The engine hashes the keys itself,
+    a hash selects it by the flags of the table.
+    `default_hash` - `djb2` mixed by `fmix64`.
+    `seeded_hash` - SipHash-1-3 with a random seed, see `TB_SEEDED`.
+ */
+struct default_hash {
+    static constexpr uint32_t flags = 0;
+};
+
+struct seeded_hash {
+    static constexpr uint32_t flags = TB_SEEDED;
+};
+
+/*
+    The hash table of string keys and values of `Value`.
+    `TB_LRU`, `TB_TTL`, `TB_INTERNED` and `TB_MULTI` tables are not supported,
+    the table removes items only by `erase` and `clear`.
+    The table grows twice, if it is full. Insertions invalidate
+    iterators and references of `TB_COMPACT` tables, a moved-from
+    table can only be assigned or destroyed.
+ */
+template <class Key, class Value, class Hash = default_hash, class Alloc = std::allocator<Value>>
+class hash_table {
+    static_assert(std::is_same_v<Key, std::string>, "the keys of the table are strings");
+    static_assert(std::is_same_v<typename std::allocator_traits<Alloc>::value_type, Value>,
+            "the allocator allocates values");
+
+    using traits = std::allocator_traits<Alloc>;
+
+    // values, which are kept in the value of the item itself
+    static constexpr bool inline_value = sizeof(Value) <= sizeof(void *)
+        && alignof(Value) <= alignof(void *) && std::is_trivially_copyable_v<Value>;
+
+    // the position of an iterator of `find`, it is computed by the first increment
+    static constexpr uint32_t npos = UINT32_MAX;
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using allocator_type = Alloc;
+
+    /*
+        The forward iterator over the items, in the order of `tb_next_item`.
+        It gives pairs of the key and the reference to the value.
+     */
+    template <bool Const>
+    class basic_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, Value>;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::pair<std::string_view, std::conditional_t<Const, const Value &, Value &>>;
+
+        // `operator->` returns the pair itself
+        struct pointer {
+            reference ref;
+            reference *operator->() {
+                return &ref;
+            }
+        };
+
+        basic_iterator() = default;
+
+        template <bool Other, class = std::enable_if_t<Const && !Other>>
+        basic_iterator(const basic_iterator<Other> &other)
+            : table_(other.table_), item_(other.item_), position_(other.position_) {}
+
+        reference operator*() const {
+            return {std::string_view(item_->key), value_of(item_)};
+        }
+
+        pointer operator->() const {
+            return {**this};
+        }
+
+        basic_iterator &operator++() {
+            if (position_ == npos) {
+                position_ = tb_item_position(table_, item_);
+            }
+            item_ = tb_next_item(table_, &position_);
+            return *this;
+        }
+
+        basic_iterator operator++(int) {
+            basic_iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const basic_iterator &a, const basic_iterator &b) {
+            return a.item_ == b.item_;
+        }
+
+        friend bool operator!=(const basic_iterator &a, const basic_iterator &b) {
+            return a.item_ != b.item_;
+        }
+
+    private:
+        friend class hash_table;
+        template <bool> friend class basic_iterator;
+
+        basic_iterator(const tb_hash_table *table, tb_hash_table_item *item, uint32_t position)
+            : table_(table), item_(item), position_(position) {}
+
+        const tb_hash_table *table_ = nullptr;
+        tb_hash_table_item *item_ = nullptr;
+        uint32_t position_ = 0;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    /*
+        Creates a table for `size` items, `options` are the options
+        of `tb_create_hash_table_ex`, the flags of `Hash` are added.
+        Throws `std::invalid_argument` for flags, which are not supported,
+        and `std::bad_alloc`, if the table is not created.
+     */
+    explicit hash_table(size_type size = 16, const Alloc &alloc = Alloc())
+        : hash_table(size, tb_hash_table_options{}, alloc) {}
+
+    hash_table(size_type size, tb_hash_table_options options, const Alloc &alloc = Alloc())
+        : alloc_(alloc) {
+        if (options.flags & (TB_LRU | TB_TTL | TB_INTERNED | TB_MULTI)) {
+            // evicted items would leak their values, interned keys are pointers, 
+            // a value is one object
+            throw std::invalid_argument("tb::hash_table: LRU, TTL, interned and multi tables are not supported");
+        }
+        if (size > UINT32_MAX) {
+            throw std::length_error("tb::hash_table: too many items");
+        }
+        options.flags |= Hash::flags;
+        table_ = tb_create_hash_table_ex(size ? static_cast<uint32_t>(size) : 1, &options);
+        if (table_ == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+
+    hash_table(const hash_table &other)
+        : alloc_(traits::select_on_container_copy_construction(other.alloc_)) {
+        table_ = tb_copy_hash_table(other.table_);
+        if (table_ == nullptr) {
+            throw std::bad_alloc();
+        }
+        if constexpr (!inline_value) {
+            // the items of the copy have the pointers to the values of `other`
+            uint32_t position = 0;
+            tb_hash_table_item *item = nullptr;
+            try {
+                while ((item = tb_next_item(table_, &position)) != nullptr) {
+                    set_pointer(item, create(value_of(item)));
+                }
+            } catch (...) {
+                do {
+                    set_pointer(item, nullptr);
+                } while ((item = tb_next_item(table_, &position)) != nullptr);
+                release();
+                throw;
+            }
+        }
+    }
+
+    hash_table(hash_table &&other) noexcept
+        : table_(std::exchange(other.table_, nullptr)), alloc_(std::move(other.alloc_)) {}
+
+    hash_table &operator=(const hash_table &other) {
+        if (this != &other) {
+            hash_table copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    hash_table &operator=(hash_table &&other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~hash_table() {
+        release();
+    }
+
+    void swap(hash_table &other) noexcept {
+        std::swap(table_, other.table_);
+        std::swap(alloc_, other.alloc_);
+    }
+
+    iterator begin() noexcept {
+        uint32_t position = 0;
+        tb_hash_table_item *item = tb_next_item(table_, &position);
+        return iterator(table_, item, position);
+    }
+
+    const_iterator begin() const noexcept {
+        return const_cast<hash_table *>(this)->begin();
+    }
+
+    iterator end() noexcept {
+        return iterator(table_, nullptr, 0);
+    }
+
+    const_iterator end() const noexcept {
+        return const_iterator(table_, nullptr, 0);
+    }
+
+    size_type size() const noexcept {
+        return table_->count;
+    }
+
+    bool empty() const noexcept {
+        return table_->count == 0;
+    }
+
+    /*
+        Reserves the table for `size` items, see `tb_reserve`.
+        Throws `std::bad_alloc`, if the table is not changed.
+     */
+    void reserve(size_type size) {
+        if (size > UINT32_MAX || !tb_reserve(table_, static_cast<uint32_t>(size))) {
+            throw std::bad_alloc();
+        }
+    }
+
+    iterator find(std::string_view key) noexcept {
+        return iterator(table_, get_item(key), npos);
+    }
+
+    const_iterator find(std::string_view key) const noexcept {
+        return const_iterator(table_, get_item(key), npos);
+    }
+
+    bool contains(std::string_view key) const noexcept {
+        return get_item(key) != nullptr;
+    }
+
+    size_type count(std::string_view key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    /*
+        Returns the value by key, throws `std::out_of_range`, if it is not found.
+     */
+    Value &at(std::string_view key) {
+        tb_hash_table_item *item = get_item(key);
+        if (item == nullptr) {
+            throw std::out_of_range("tb::hash_table: no such key");
+        }
+        return value_of(item);
+    }
+
+    const Value &at(std::string_view key) const {
+        return const_cast<hash_table *>(this)->at(key);
+    }
+
+    /*
+        Returns the value by key, a new key gets a value made by `Value()`.
+     */
+    Value &operator[](std::string_view key) {
+        return value_of(try_emplace(key).first.item_);
+    }
+
+    /*
+        Inserts a value made of `args`, if the key is not in the table.
+        Throws `std::invalid_argument`, if the key has NUL bytes.
+        Returns the item of the key and true, if it is inserted.
+     */
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(std::string_view key, Args &&...args) {
+        check_key(key);
+        tb_hash_table_item *item = tb_get_item_n(table_, data(key), key.size());
+        if (item != nullptr) {
+            return {iterator(table_, item, npos), false};
+        }
+        return {iterator(table_, insert_new(key, std::forward<Args>(args)...), npos), true};
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(std::string_view key, Args &&...args) {
+        return try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    /*
+        Inserts a value or assigns it to the value of the key.
+        Throws `std::invalid_argument`, if the key has NUL bytes.
+        Returns the item of the key and true, if it is inserted.
+     */
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(std::string_view key, M &&value) {
+        check_key(key);
+        if constexpr (inline_value) {
+            // the engine replaces the value of an existing key itself
+            uint32_t count = table_->count;
+            if (count == table_->size && !contains(key)) {
+                grow();
+            }
+            Value stored(std::forward<M>(value));
+            void *slot = nullptr;
+            std::memcpy(&slot, &stored, sizeof(Value));
+            tb_hash_table_item *item = tb_insert_item_n(table_, data(key), key.size(), &slot);
+            if (item == nullptr) {
+                throw std::bad_alloc();
+            }
+            return {iterator(table_, item, npos), table_->count != count};
+        } else {
+            tb_hash_table_item *item = tb_get_item_n(table_, data(key), key.size());
+            if (item != nullptr) {
+                value_of(item) = std::forward<M>(value);
+                return {iterator(table_, item, npos), false};
+            }
+            return {iterator(table_, insert_new(key, std::forward<M>(value)), npos), true};
+        }
+    }
+
+    /*
+        Removes the item by key.
+        Returns the number of removed items, 1 or 0.
+     */
+    size_type erase(std::string_view key) {
+        if (has_nul(key)) {
+            return 0;
+        }
+        if constexpr (inline_value) {
+            return static_cast<size_type>(tb_delete_item_n(table_, data(key), key.size()));
+        } else {
+            tb_hash_table_item *item = tb_get_item_n(table_, data(key), key.size());
+            if (item == nullptr) {
+                return 0;
+            }
+            Value *value = pointer_of(item);
+            tb_delete_item_n(table_, data(key), key.size());
+            destroy(value);
+            return 1;
+        }
+    }
+
+    /*
+        Removes all items, the table keeps its memory, see `tb_clear`.
+     */
+    void clear() noexcept {
+        destroy_values();
+        tb_clear(table_);
+    }
+
+    allocator_type get_allocator() const {
+        return alloc_;
+    }
+
+    // the table of the engine
+    tb_hash_table *native_handle() noexcept {
+        return table_;
+    }
+
+private:
+    // `string_view` of nothing has no data, the engine needs a pointer
+    static const char *data(std::string_view key) noexcept {
+        return key.data() != nullptr ? key.data() : "";
+    }
+
+    // the engine keeps keys with NUL, a key with NUL bytes is not in the table
+    static bool has_nul(std::string_view key) noexcept {
+        return key.find('\0') != std::string_view::npos;
+    }
+
+    static void check_key(std::string_view key) {
+        if (has_nul(key)) {
+            throw std::invalid_argument("tb::hash_table: the key has NUL bytes");
+        }
+    }
+
+    tb_hash_table_item *get_item(std::string_view key) const noexcept {
+        return has_nul(key) ? nullptr : tb_get_item_n(table_, data(key), key.size());
+    }
+
+    static Value *pointer_of(const tb_hash_table_item *item) noexcept {
+        if constexpr (inline_value) {
+            return std::launder(reinterpret_cast<Value *>(item->val));
+        } else {
+            Value *value;
+            std::memcpy(&value, item->val, sizeof(value));
+            return value;
+        }
+    }
+
+    static Value &value_of(const tb_hash_table_item *item) noexcept {
+        return *pointer_of(item);
+    }
+
+    static void set_pointer(tb_hash_table_item *item, Value *value) noexcept {
+        std::memcpy(item->val, &value, sizeof(value));
+    }
+
+    template <class... Args>
+    Value *create(Args &&...args) {
+        Value *value = traits::allocate(alloc_, 1);
+        try {
+            traits::construct(alloc_, value, std::forward<Args>(args)...);
+        } catch (...) {
+            traits::deallocate(alloc_, value, 1);
+            throw;
+        }
+        return value;
+    }
+
+    void destroy(Value *value) noexcept {
+        if (value != nullptr) {
+            traits::destroy(alloc_, value);
+            traits::deallocate(alloc_, value, 1);
+        }
+    }
+
+    void destroy_values() noexcept {
+        if constexpr (!inline_value) {
+            uint32_t position = 0;
+            while (tb_hash_table_item *item = tb_next_item(table_, &position)) {
+                destroy(pointer_of(item));
+            }
+        }
+    }
+
+    void release() noexcept {
+        if (table_ != nullptr) {
+            destroy_values();
+            tb_delete_hash_table(table_);
+            table_ = nullptr;
+        }
+    }
+
+    void grow() {
+        uint64_t size = static_cast<uint64_t>(table_->size) * 2;
+        reserve(static_cast<size_type>(size < UINT32_MAX ? size : UINT32_MAX));
+    }
+
+    // inserts a key, which is not in the table
+    template <class... Args>
+    tb_hash_table_item *insert_new(std::string_view key, Args &&...args) {
+        if (table_->count == table_->size) {
+            grow();
+        }
+        void *slot = nullptr;
+        if constexpr (inline_value) {
+            Value value(std::forward<Args>(args)...);
+            std::memcpy(&slot, &value, sizeof(Value));
+        } else {
+            slot = create(std::forward<Args>(args)...);
+        }
+        tb_hash_table_item *item = tb_insert_item_n(table_, data(key), key.size(), &slot);
+        if (item == nullptr) {
+            if constexpr (!inline_value) {
+                destroy(static_cast<Value *>(slot));
+            }
+            throw std::bad_alloc();
+        }
+        return item;
+    }
+
+    tb_hash_table *table_ = nullptr;
+    Alloc alloc_;
+};
+
+} // namespace tb
+
+#endif
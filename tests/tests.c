@@ -7,6 +7,16 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
 #include "tests.h"
 #include "hashtable.h"
 
@@ -189,9 +199,2077 @@ TEST(test_delete_value_from_table) {
     tb_delete_hash_table(table);
 }
 
+TEST(test_copy_table) {
+    tb_hash_table *table = tb_create_hash_table(5000);
+    char key[32];
+    for (int i = 0; i < 5000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    for (int i = 0; i < 100; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_delete_item(table, key);
+    }
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    ACTUAL_TRUE(copy != NULL);
+    EXPECT_EQ(copy->size, table->size);
+    EXPECT_EQ(copy->count, table->count);
+    EXPECT_FALSE(copy->empty);
+    for (int i = 0; i < 5000; ++i) {
+        sprintf(key, "key_%i", i);
+        void *value = tb_get_value(copy, key);
+        if (i < 100) {
+            EXPECT_TRUE(value == NULL);
+        } else {
+            EXPECT_TRUE(value != NULL && GET_INT(value) == i);
+            EXPECT_TRUE(value != tb_get_value(table, key));
+        }
+    }
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(copy);
+}
+
+TEST(test_compact_table) {
+    tb_hash_table_options options = {.flags = TB_COMPACT};
+    tb_hash_table *table = tb_create_hash_table_ex(20000, &options);
+    ACTUAL_TRUE(table != NULL);
+    EXPECT_TRUE(table->empty);
+    EXPECT_TRUE(table->items == NULL);
+    EXPECT_EQ(table->index_width, 2);
+    char key[32];
+    clock_t begin = clock();
+    for (int i = 0; i < 20000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("Insertion perfomance of compact table - 20000 items: %f ms \n", time_spent);
+    EXPECT_EQ(table->count, 20000);
+    // the table is full, churn forces deleted entries to be squeezed out
+    for (int round = 0; round < 3; ++round) {
+        for (int i = round * 6000; i < (round + 1) * 6000; ++i) {
+            sprintf(key, "key_%i", i);
+            int deleted = tb_delete_item(table, key);
+            ACTUAL_TRUE(deleted);
+            sprintf(key, "new_%i", i);
+            tb_insert_item(table, key, &i);
+        }
+    }
+    EXPECT_EQ(table->count, 20000);
+    // iteration is in insertion order
+    uint32_t position = 0;
+    int expected = 18000;
+    int is_new = 0;
+    tb_hash_table_item *item;
+    begin = clock();
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        if (expected == 20000 && !is_new) {
+            expected = 0;
+            is_new = 1;
+        }
+        sprintf(key, is_new ? "new_%i" : "key_%i", expected);
+        EXPECT_STRINGS_EQ(item->key, key);
+        EXPECT_TRUE(GET_INT(item->val) == expected);
+        ++expected;
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("Iteration perfomance of compact table - 20000 items: %f ms \n", time_spent);
+    EXPECT_EQ(expected, 18000);
+    sprintf(key, "key_%i", 0);
+    EXPECT_TRUE(tb_get_value(table, key) == NULL);
+    sprintf(key, "new_%i", 0);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == 0);
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    for (int i = 0; i < 18000; ++i) {
+        sprintf(key, "new_%i", i);
+        int deleted = tb_delete_item(table, key);
+        ACTUAL_TRUE(deleted);
+        EXPECT_TRUE(GET_INT(tb_get_value(copy, key)) == i);
+    }
+    EXPECT_EQ(table->count, 2000);
+    EXPECT_EQ(copy->count, 20000);
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(copy);
+}
+
+TEST(test_lru_table) {
+    tb_hash_table_options options = {.flags = TB_LRU};
+    tb_hash_table *table = tb_create_hash_table_ex(1000, &options);
+    ACTUAL_TRUE(table != NULL);
+    char key[32];
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_EQ(table->count, 1000);
+    // keys 0-99 become the most recently used
+    for (int i = 0; i < 100; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+    }
+    EXPECT_TRUE(tb_get_value(table, "nothing") == NULL);
+    EXPECT_EQ(table->hits, 100);
+    EXPECT_EQ(table->misses, 1);
+    // the full table evicts keys 100-199
+    for (int i = 1000; i < 1100; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_EQ(table->count, 1000);
+    EXPECT_EQ(table->evictions, 100);
+    for (int i = 0; i < 1100; ++i) {
+        sprintf(key, "key_%i", i);
+        void *value = tb_get_value(table, key);
+        if (i >= 100 && i < 200) {
+            EXPECT_TRUE(value == NULL);
+        } else {
+            EXPECT_TRUE(value != NULL && GET_INT(value) == i);
+        }
+    }
+    EXPECT_EQ(table->hits, 1100);
+    EXPECT_EQ(table->misses, 101);
+    // the copy keeps the recency order, key 0 is the least recently used
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    int deleted = tb_delete_item(table, "key_200");
+    ACTUAL_TRUE(deleted);
+    EXPECT_EQ(table->count, 999);
+    int i = 2000;
+    tb_insert_item(copy, "key_2000", &i);
+    EXPECT_TRUE(tb_get_value(copy, "key_0") == NULL);
+    EXPECT_TRUE(tb_get_value(copy, "key_1") != NULL);
+    EXPECT_EQ(copy->evictions, 101);
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(copy);
+}
+// The clock of `test_ttl_table`, in milliseconds.
+static uint64_t test_now = 1000;
+
+static uint64_t test_clock(void) {
+    return test_now;
+}
+
+TEST(test_filter_table) {
+    tb_hash_table_options options = {.flags = TB_FILTER};
+    tb_hash_table *table = tb_create_hash_table_ex(100000, &options);
+    tb_hash_table *plain = tb_create_hash_table(100000);
+    ACTUAL_TRUE(table != NULL && table->filter != NULL);
+    char key[32];
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+        tb_insert_item(plain, key, &i);
+    }
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+    }
+
+    clock_t begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "miss_%i", i);
+        EXPECT_TRUE(tb_get_value(table, key) == NULL);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Miss perfomance of filtered table - 100000 lookups: %f ms \n", time_spent);
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "miss_%i", i);
+        EXPECT_TRUE(tb_get_value(plain, key) == NULL);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Miss perfomance of table - 100000 lookups: %f ms \n", time_spent);
+
+    // deleted keys are removed from the filter, the others are still found
+    for (int i = 0; i < 50000; i += 2) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_delete_item(table, key));
+        EXPECT_FALSE(tb_delete_item(table, key));
+    }
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    ACTUAL_TRUE(copy != NULL);
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(i % 2 ? tb_get_item(table, key) != NULL : tb_get_item(table, key) == NULL);
+        EXPECT_TRUE(i % 2 ? tb_get_value(copy, key) != NULL : tb_get_value(copy, key) == NULL);
+    }
+    int value = 7;
+    tb_insert_item(table, "key_0", &value);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_0")) == 7);
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(plain);
+    tb_delete_hash_table(copy);
+
+    options.flags = TB_FILTER | TB_COMPACT;
+    table = tb_create_hash_table_ex(1000, &options);
+    ACTUAL_TRUE(table != NULL);
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_TRUE(tb_get_value(table, "nothing") == NULL);
+    int deleted = tb_delete_item(table, "key_10");
+    ACTUAL_TRUE(deleted);
+    EXPECT_TRUE(tb_find_item(table, "key_10") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_11")) == 11);
+    tb_delete_hash_table(table);
+}
+
+TEST(test_seeded_table) {
+    tb_hash_table_options options = {.flags = TB_SEEDED};
+    tb_hash_table *table = tb_create_hash_table_ex(100000, &options);
+    tb_hash_table *plain = tb_create_hash_table(100000);
+    ACTUAL_TRUE(table != NULL);
+    EXPECT_TRUE(table->seed[0] || table->seed[1]);
+    char key[32];
+
+    clock_t begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Insertion perfomance of seeded table - 100000 items: %f ms \n", time_spent);
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(plain, key, &i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Insertion perfomance of table - 100000 items: %f ms \n", time_spent);
+
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of seeded table - 100000 items: %f ms \n", time_spent);
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_get_value(plain, key)) == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of table - 100000 items: %f ms \n", time_spent);
+
+    for (int i = 0; i < 100000; i += 2) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_delete_item(table, key));
+    }
+    EXPECT_EQ(table->count, 50000);
+    EXPECT_TRUE(tb_get_value(table, "key_0") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_1")) == 1);
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(plain);
+
+    // the same seed gives the same layout, another seed gives another one
+    options.flags = TB_SEEDED | TB_COMPACT;
+    options.seed[0] = 1;
+    tb_hash_table *first = tb_create_hash_table_ex(1000, &options);
+    tb_hash_table *second = tb_create_hash_table_ex(1000, &options);
+    options.flags = TB_SEEDED;
+    options.seed[1] = 2;
+    tb_hash_table *third = tb_create_hash_table_ex(1000, &options);
+    tb_hash_table *fourth = tb_create_hash_table_ex(1000, &options);
+    ACTUAL_TRUE(first && second && third && fourth);
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(first, key, &i);
+        tb_insert_item(second, key, &i);
+        tb_insert_item(third, key, &i);
+        tb_insert_item(fourth, key, &i);
+    }
+    EXPECT_EQ(memcmp(first->index, second->index, first->allocated * first->index_width), 0);
+    uint32_t same = 0;
+    for (uint32_t index = 0; index < third->allocated; ++index) {
+        tb_hash_table_item *item = third->items[index];
+        same += item && item != EMPTY_ITEM && tb_find_item(fourth, item->key) == fourth->items[index];
+    }
+    EXPECT_EQ(same, 1000);
+    EXPECT_TRUE(tb_get_value(first, "nothing") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(third, "key_999")) == 999);
+    tb_delete_hash_table(first);
+    tb_delete_hash_table(second);
+    tb_delete_hash_table(third);
+    tb_delete_hash_table(fourth);
+}
+
+TEST(test_probing_table) {
+    const char *names[] = {"double hashing", "quadratic", "linear"};
+    char key[32];
+    for (uint32_t probing = TB_PROBE_DOUBLE; probing <= TB_PROBE_LINEAR; ++probing) {
+        for (uint32_t flags = 0; flags <= TB_COMPACT; flags += TB_COMPACT) {
+            tb_hash_table_options options = {.flags = flags, .probing = probing};
+            tb_hash_table *table = tb_create_hash_table_ex(100000, &options);
+            ACTUAL_TRUE(table != NULL);
+            EXPECT_EQ(table->allocated, 131072);
+            clock_t begin = clock();
+            for (int i = 0; i < 100000; ++i) {
+                sprintf(key, "key_%i", i);
+                tb_insert_item(table, key, &i);
+            }
+            for (int i = 0; i < 100000; ++i) {
+                sprintf(key, "key_%i", i);
+                EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+            }
+            clock_t end = clock();
+            double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+            uint64_t hits = 0, misses = 0;
+            uint32_t longest_hit = 0, longest_miss = 0;
+            for (int i = 0; i < 100000; ++i) {
+                sprintf(key, "key_%i", i);
+                uint32_t length = tb_probe_length(table, key);
+                hits += length;
+                longest_hit = length > longest_hit ? length : longest_hit;
+                sprintf(key, "miss_%i", i);
+                length = tb_probe_length(table, key);
+                misses += length;
+                longest_miss = length > longest_miss ? length : longest_miss;
+                EXPECT_TRUE(tb_get_value(table, key) == NULL);
+            }
+            printf("Probing %s%s - 100000 items: insertion and search %f ms, "
+                    "hit probes %.2f (max %u), miss probes %.2f (max %u) \n", 
+                    names[probing], flags ? ", compact" : "", time_spent, 
+                    hits / 100000.0, longest_hit, misses / 100000.0, longest_miss);
+            tb_delete_hash_table(table);
+        }
+    }
+    tb_hash_table_options options = {.probing = TB_PROBE_LINEAR + 1};
+    EXPECT_TRUE(tb_create_hash_table_ex(100, &options) == NULL);
+}
+
+TEST(test_cuckoo_table) {
+    tb_hash_table_options options = {.flags = TB_CUCKOO};
+    tb_hash_table *table = tb_create_hash_table_ex(100000, &options);
+    ACTUAL_TRUE(table != NULL);
+    EXPECT_TRUE(table->items == NULL);
+    char key[32];
+    clock_t begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Insertion perfomance of cuckoo table - 100000 items: %f ms \n", time_spent);
+    EXPECT_EQ(table->count, 100000);
+
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of cuckoo table - 100000 items: %f ms \n", time_spent);
+    uint32_t longest = 0;
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "miss_%i", i);
+        EXPECT_TRUE(tb_get_value(table, key) == NULL);
+        uint32_t length = tb_probe_length(table, key);
+        longest = length > longest ? length : longest;
+    }
+    EXPECT_TRUE(longest <= 3);
+    printf("Cuckoo table - 100000 items: max buckets read %u, stash %u \n", longest, table->stash_count);
+
+    // churn, the copy and the iteration
+    for (int i = 0; i < 100000; i += 2) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_delete_item(table, key));
+        EXPECT_FALSE(tb_delete_item(table, key));
+    }
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "new_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    ACTUAL_TRUE(copy != NULL);
+    tb_delete_hash_table(table);
+    uint32_t position = 0, count = 0;
+    while (tb_next_item(copy, &position) != NULL) {
+        ++count;
+    }
+    EXPECT_EQ(count, 100000);
+    EXPECT_TRUE(GET_INT(tb_get_value(copy, "key_99999")) == 99999);
+    EXPECT_TRUE(GET_INT(tb_get_value(copy, "new_49999")) == 49999);
+    EXPECT_TRUE(tb_get_value(copy, "key_0") == NULL);
+    tb_delete_hash_table(copy);
+
+    // small tables with random seeds fill the stash and grow
+    uint32_t stashed = 0, grown = 0;
+    options.flags = TB_CUCKOO | TB_SEEDED;
+    for (int n = 0; n < 1000; ++n) {
+        table = tb_create_hash_table_ex(6, &options);
+        ACTUAL_TRUE(table != NULL);
+        for (int i = 0; i < 6; ++i) {
+            sprintf(key, "key_%i", i);
+            tb_insert_item(table, key, &i);
+        }
+        stashed += table->stash_count > 0;
+        grown += table->allocated > 8;
+        for (int i = 0; i < 6; ++i) {
+            sprintf(key, "key_%i", i);
+            EXPECT_TRUE(GET_INT(tb_get_value(table, key)) == i);
+        }
+        EXPECT_TRUE(tb_delete_item(table, "key_5"));
+        EXPECT_TRUE(tb_find_item(table, "key_5") == NULL);
+        EXPECT_EQ(table->count, 5);
+        tb_delete_hash_table(table);
+    }
+    EXPECT_TRUE(stashed > 0);
+    printf("Cuckoo tables - 1000 tables of 6 items: %u use the stash, %u are grown \n", stashed, grown);
+
+    options.flags = TB_CUCKOO | TB_COMPACT;
+    EXPECT_TRUE(tb_create_hash_table_ex(100, &options) == NULL);
+}
+
+TEST(test_frozen_table) {
+    tb_hash_table *table = tb_create_hash_table(100000);
+    char key[32];
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t begin = clock();
+    tb_frozen_table *frozen = tb_freeze(table);
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Freezing perfomance of table - 100000 items: %f ms \n", time_spent);
+    ACTUAL_TRUE(frozen != NULL);
+    EXPECT_EQ(frozen->count, 100000);
+    printf("Frozen table - 100000 items: %lu bytes \n", (unsigned long)frozen->size);
+
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_frozen_get_value(frozen, key)) == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_frozen_get_value' function perfomance of table - 100000 items: %f ms \n", time_spent);
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(key, "miss_%i", i);
+        EXPECT_TRUE(tb_frozen_get_value(frozen, key) == NULL);
+    }
+    // every slot is used once
+    uint64_t sum = 0;
+    for (uint32_t slot = 0; slot < frozen->count; ++slot) {
+        void *val;
+        const char *frozen_key = tb_frozen_key_at(frozen, slot, &val);
+        EXPECT_TRUE(tb_get_value(table, frozen_key) != NULL);
+        sum += (uint64_t)GET_INT(val);
+    }
+    EXPECT_EQ(sum, 4999950000ULL);
+
+    // the buffer is used as is from a file
+    FILE *file = tmpfile();
+    ACTUAL_TRUE(file != NULL);
+    EXPECT_EQ(fwrite(frozen->data, 1, frozen->size, file), frozen->size);
+    fflush(file);
+    void *data = mmap(NULL, frozen->size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    ACTUAL_TRUE(data != MAP_FAILED);
+    tb_frozen_table *mapped = tb_open_frozen_table(data, frozen->size);
+    ACTUAL_TRUE(mapped != NULL);
+    EXPECT_TRUE(GET_INT(tb_frozen_get_value(mapped, "key_12345")) == 12345);
+    EXPECT_TRUE(tb_frozen_get_value(mapped, "nothing") == NULL);
+    EXPECT_TRUE(tb_open_frozen_table(data, frozen->size - 1) == NULL);
+    // values are aligned to 8 bytes
+    for (int i = 0; i < 100; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(((uintptr_t)tb_frozen_get_value(mapped, key) & 7) == 0);
+    }
+    // broken offsets and remapped positions are rejected
+    uint8_t *broken = (uint8_t *)malloc(frozen->size);
+    ACTUAL_TRUE(broken != NULL);
+    memcpy(broken, frozen->data, frozen->size);
+    const uint8_t *origin = (const uint8_t *)frozen->data;
+    uint32_t *broken_offsets = (uint32_t *)(broken + ((const uint8_t *)frozen->offsets - origin));
+    broken_offsets[7] = (uint32_t)frozen->size;
+    EXPECT_TRUE(tb_open_frozen_table(broken, frozen->size) == NULL);
+    broken_offsets[7] = frozen->offsets[7];
+    uint32_t *broken_remap = (uint32_t *)(broken + ((const uint8_t *)frozen->remap - origin));
+    broken_remap[0] = frozen->count;
+    EXPECT_TRUE(tb_open_frozen_table(broken, frozen->size) == NULL);
+    broken_remap[0] = frozen->remap[0];
+    tb_frozen_table *repaired = tb_open_frozen_table(broken, frozen->size);
+    EXPECT_TRUE(repaired != NULL);
+    tb_delete_frozen_table(repaired);
+    free(broken);
+    tb_delete_frozen_table(mapped);
+    munmap(data, frozen->size);
+    fclose(file);
+    tb_delete_frozen_table(frozen);
+    tb_delete_hash_table(table);
+
+    table = tb_create_hash_table(10);
+    frozen = tb_freeze(table);
+    ACTUAL_TRUE(frozen != NULL);
+    EXPECT_TRUE(tb_frozen_get_value(frozen, "nothing") == NULL);
+    tb_delete_frozen_table(frozen);
+    tb_delete_hash_table(table);
+
+    // large key sets, the keys after `count` are remapped
+    table = tb_create_hash_table(1000000);
+    for (int64_t i = 0; i < 1000000; ++i) {
+        sprintf(key, "key_%li", (long)i);
+        tb_insert_item(table, key, &i);
+    }
+    begin = clock();
+    frozen = tb_freeze(table);
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Freezing perfomance of table - 1000000 items: %f ms \n", time_spent);
+    ACTUAL_TRUE(frozen != NULL);
+    EXPECT_EQ(frozen->count, 1000000);
+    EXPECT_TRUE(frozen->positions > frozen->count);
+    uint32_t found = 0;
+    for (int64_t i = 0; i < 1000000; ++i) {
+        sprintf(key, "key_%li", (long)i);
+        void *val = tb_frozen_get_value(frozen, key);
+        found += val != NULL && GET_CUSTOM_TYPE(int64_t, val) == i;
+    }
+    EXPECT_EQ(found, 1000000);
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(key, "miss_%i", i);
+        EXPECT_TRUE(tb_frozen_get_value(frozen, key) == NULL);
+    }
+    tb_delete_frozen_table(frozen);
+    tb_delete_hash_table(table);
+}
+
+TEST(test_recycle_table) {
+    const uint32_t layouts[] = {0, TB_COMPACT, TB_CUCKOO, TB_LRU | TB_FILTER};
+    char key[32];
+    for (uint32_t layout = 0; layout < 4; ++layout) {
+        tb_hash_table_options options = {.flags = layouts[layout]};
+        clock_t begin = clock();
+        for (int cycle = 0; cycle < 10000; ++cycle) {
+            tb_hash_table *table = tb_create_hash_table_ex(100, &options);
+            for (int i = 0; i < 100; ++i) {
+                sprintf(key, "key_%i", i);
+                tb_insert_item(table, key, &i);
+            }
+            tb_delete_hash_table(table);
+        }
+        clock_t end = clock();
+        double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+        printf("Create and delete perfomance of table (flags %u) - 10000 x 100 items: %f ms \n", 
+                layouts[layout], time_spent);
+
+        tb_hash_table *table = tb_create_hash_table_ex(100, &options);
+        begin = clock();
+        for (int cycle = 0; cycle < 10000; ++cycle) {
+            for (int i = 0; i < 100; ++i) {
+                sprintf(key, "key_%i", i);
+                tb_insert_item(table, key, &i);
+            }
+            tb_clear(table);
+        }
+        end = clock();
+        time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+        printf("Clear perfomance of table (flags %u) - 10000 x 100 items: %f ms \n", 
+                layouts[layout], time_spent);
+        EXPECT_TRUE(table->empty);
+        EXPECT_EQ(table->count, 0);
+        EXPECT_TRUE(tb_get_value(table, "key_1") == NULL);
+        uint32_t position = 0;
+        EXPECT_TRUE(tb_next_item(table, &position) == NULL);
+
+        // the table grows with its items
+        for (int i = 0; i < 100; ++i) {
+            sprintf(key, "key_%i", i);
+            tb_insert_item(table, key, &i);
+        }
+        sprintf(key, "key_%i", 10);
+        EXPECT_TRUE(tb_delete_item(table, key));
+        int reserved = tb_reserve(table, 20000);
+        ACTUAL_TRUE(reserved);
+        EXPECT_EQ(table->size, 20000);
+        EXPECT_TRUE(table->allocated >= 25000);
+        for (int i = 100; i < 20000; ++i) {
+            sprintf(key, "key_%i", i);
+            tb_insert_item(table, key, &i);
+        }
+        EXPECT_EQ(table->count, 19999);
+        for (int i = 0; i < 20000; ++i) {
+            sprintf(key, "key_%i", i);
+            EXPECT_TRUE(i == 10 ? tb_get_value(table, key) == NULL 
+                    : GET_INT(tb_get_value(table, key)) == i);
+        }
+        EXPECT_TRUE(tb_reserve(table, 100));
+        EXPECT_EQ(table->size, 20000);
+        tb_delete_hash_table(table);
+    }
+}
+
+TEST(test_interned_table) {
+    // the vocabulary, every key is one pointer
+    char **words = (char **)malloc(100000 * sizeof(char *));
+    char key[32];
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "field_name_%i", i);
+        words[i] = strdup(key);
+    }
+    tb_hash_table_options options = {.flags = TB_INTERNED};
+    tb_hash_table *table = tb_create_hash_table_ex(100000, &options);
+    tb_hash_table *plain = tb_create_hash_table(100000);
+    ACTUAL_TRUE(table != NULL);
+    for (int i = 0; i < 100000; ++i) {
+        tb_insert_item(table, words[i], &i);
+        tb_insert_item(plain, words[i], &i);
+    }
+    EXPECT_TRUE(tb_get_item(table, words[5])->key == words[5]);
+
+    clock_t begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(GET_INT(tb_get_value(table, words[i])) == i);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of interned table - 100000 items: %f ms \n", time_spent);
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        EXPECT_TRUE(GET_INT(tb_get_value(plain, words[i])) == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of table - 100000 items: %f ms \n", time_spent);
+
+    // the same bytes by another pointer are another key
+    EXPECT_TRUE(tb_get_value(table, "field_name_1") == NULL);
+    EXPECT_TRUE(tb_delete_item(table, words[1]));
+    EXPECT_TRUE(tb_get_value(table, words[1]) == NULL);
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    EXPECT_TRUE(GET_INT(tb_get_value(copy, words[2])) == 2);
+    tb_delete_hash_table(table);
+    tb_delete_hash_table(plain);
+    tb_delete_hash_table(copy);
+
+    options.flags = TB_INTERNED | TB_COMPACT;
+    table = tb_create_hash_table_ex(1000, &options);
+    for (int i = 0; i < 1000; ++i) {
+        tb_insert_item(table, words[i], &i);
+    }
+    EXPECT_TRUE(tb_delete_item(table, words[7]));
+    EXPECT_TRUE(tb_find_item(table, words[7]) == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, words[999])) == 999);
+    tb_delete_hash_table(table);
+
+    for (int i = 0; i < 100000; ++i) {
+        free(words[i]);
+    }
+    free(words);
+}
+
+/*
+    The virtual memory of this process, from /proc/self/status.
+    Returns the size in KB, or 0 if it is not known.
+ */
+static uint64_t virtual_memory_kb() {
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    char line[128];
+    unsigned long long size = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "VmSize: %llu kB", &size) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return size;
+}
+
+TEST(test_snapshot_table) {
+    tb_hash_table *table = tb_create_hash_table(100000);
+    char key[32];
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t begin = clock();
+    tb_table_snapshot *snapshot = tb_snapshot(table);
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Snapshot perfomance of table - 50000 items: %f ms \n", time_spent);
+    ACTUAL_TRUE(snapshot != NULL);
+    EXPECT_FALSE(tb_reserve(table, 200000));
+
+    // writes after the snapshot: new keys, new values and deletions
+    for (int i = 0; i < 1000; ++i) {
+        int value = -i;
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &value);
+        sprintf(key, "key_%i", 1000 + i);
+        EXPECT_TRUE(tb_delete_item(table, key));
+        sprintf(key, "new_%i", i);
+        tb_insert_item(table, key, &i);
+        if (i == 9 || i == 999) {
+            uint32_t pages = 0;
+            for (uint32_t page = 0; page < (table->allocated + 511) / 512; ++page) {
+                pages += snapshot->pages[page] != NULL;
+            }
+            EXPECT_TRUE(pages <= (uint32_t)(i + 1) * 3);
+            printf("Snapshot of table - 50000 items, %i writes: %u of %u pages copied \n", 
+                    (i + 1) * 3, pages, (table->allocated + 511) / 512);
+        }
+    }
+    tb_table_snapshot *second = tb_snapshot(table);
+    for (int i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(GET_INT(tb_snapshot_get_value(snapshot, key)) == i);
+    }
+    EXPECT_TRUE(tb_snapshot_get_value(snapshot, "new_1") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_5")) == -5);
+    EXPECT_TRUE(tb_get_value(table, "key_1005") == NULL);
+    EXPECT_TRUE(GET_INT(tb_snapshot_get_value(second, "key_5")) == -5);
+    EXPECT_TRUE(GET_INT(tb_snapshot_get_value(second, "new_5")) == 5);
+    EXPECT_TRUE(tb_snapshot_get_value(second, "key_1005") == NULL);
+
+    tb_clear(table);
+    uint32_t position = 0, count = 0;
+    while (tb_snapshot_next_item(snapshot, &position) != NULL) {
+        ++count;
+    }
+    EXPECT_EQ(count, 50000);
+    EXPECT_EQ(second->view.count, 50000);
+    tb_delete_snapshot(snapshot);
+    EXPECT_TRUE(GET_INT(tb_snapshot_get_value(second, "key_49999")) == 49999);
+    EXPECT_TRUE(table->deferred_count > 0);
+    tb_delete_snapshot(second);
+    EXPECT_EQ(table->deferred_count, 0);
+    EXPECT_TRUE(tb_reserve(table, 200000));
+    tb_delete_hash_table(table);
+
+    // without memory for the pages of a snapshot, a deletion fails, 
+    // the table is not changed
+    table = tb_create_hash_table(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    snapshot = tb_snapshot(table);
+    ACTUAL_TRUE(snapshot != NULL);
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        struct rlimit limit = {(virtual_memory_kb() + 1024) * 1024, RLIM_INFINITY};
+        int good = virtual_memory_kb() && setrlimit(RLIMIT_AS, &limit) == 0;
+        uint32_t deleted = 0;
+        int i = 0;
+        for (; good && i < 1000000; ++i) {
+            sprintf(key, "key_%i", i);
+            if (!tb_delete_item(table, key)) {
+                break;
+            }
+            ++deleted;
+        }
+        good = good && i < 1000000 && tb_get_value(table, key) != NULL 
+            && table->count == 1000000 - deleted && tb_snapshot_get_value(snapshot, "key_0") != NULL;
+        // the memory of the snapshot is freed, the deletion is done
+        tb_delete_snapshot(snapshot);
+        good = good && tb_delete_item(table, key) && tb_get_value(table, key) == NULL;
+        _exit(good ? 0 : 1);
+    }
+    int status = -1;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    tb_delete_snapshot(snapshot);
+    tb_delete_hash_table(table);
+
+    // the evicted items of a cache stay in the snapshot
+    tb_hash_table_options options = {.flags = TB_LRU};
+    table = tb_create_hash_table_ex(100, &options);
+    for (int i = 0; i < 100; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    snapshot = tb_snapshot(table);
+    for (int i = 100; i < 200; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_TRUE(tb_get_value(table, "key_0") == NULL);
+    EXPECT_TRUE(GET_INT(tb_snapshot_get_value(snapshot, "key_0")) == 0);
+    EXPECT_TRUE(tb_snapshot_get_value(snapshot, "key_100") == NULL);
+    tb_delete_snapshot(snapshot);
+    options.flags = TB_COMPACT;
+    tb_hash_table *compact = tb_create_hash_table_ex(100, &options);
+    EXPECT_TRUE(tb_snapshot(compact) == NULL);
+    tb_delete_hash_table(compact);
+    tb_delete_hash_table(table);
+}
+
+/*
+    Opens the counter of dTLB load misses of this thread.
+    Returns the file descriptor, or -1 if the counter is not available.
+ */
+static int dtlb_misses_open() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+TEST(test_huge_page_table) {
+    // the slot array and the items are much bigger than the reach of the dTLB
+    const int count = 500000;
+    char (*keys)[16] = malloc((size_t)count * sizeof(*keys));
+    uint32_t *order = (uint32_t *)malloc((size_t)count * sizeof(uint32_t));
+    uint64_t state = 88172645463325252ULL;
+    for (int i = 0; i < count; ++i) {
+        sprintf(keys[i], "key_%i", i);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        order[i] = (uint32_t)(state % (uint64_t)count);
+    }
+    uint32_t memories[] = {0, TB_MEMORY_THP | TB_MEMORY_PREFAULT, 
+        TB_MEMORY_HUGE_2MB | TB_MEMORY_PREFAULT | TB_MEMORY_NUMA_BIND};
+    int counter = dtlb_misses_open();
+    for (uint32_t memory = 0; memory < sizeof(memories) / sizeof(memories[0]); ++memory) {
+        tb_hash_table_options options = {.memory = memories[memory], .numa_nodes = 1};
+        tb_hash_table *table = tb_create_hash_table_ex((uint32_t)count, &options);
+        ACTUAL_TRUE(table != NULL && table->items != NULL);
+        for (int i = 0; i < count; ++i) {
+            tb_insert_item(table, keys[i], &i);
+        }
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        clock_t begin = clock();
+        for (int i = 0; i < count; ++i) {
+            EXPECT_TRUE(GET_INT(tb_get_value(table, keys[order[i]])) == (int)order[i]);
+        }
+        clock_t end = clock();
+        double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+        long long misses = -1;
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+                misses = -1;
+            }
+        }
+        if (misses >= 0) {
+            printf("Random lookups perfomance of table (memory %u) - %i items: %f ms, "
+                    "%lld dTLB misses \n", memories[memory], count, time_spent, misses);
+        } else {
+            printf("Random lookups perfomance of table (memory %u) - %i items: %f ms, "
+                    "dTLB misses are not counted \n", memories[memory], count, time_spent);
+        }
+
+        tb_hash_table *copy = tb_copy_hash_table(table);
+        EXPECT_TRUE(GET_INT(tb_get_value(copy, "key_7")) == 7);
+        EXPECT_TRUE(tb_delete_item(copy, "key_7"));
+        EXPECT_TRUE(GET_INT(tb_get_value(table, "key_7")) == 7);
+        tb_delete_hash_table(copy);
+        EXPECT_TRUE(tb_reserve(table, (uint32_t)count * 2));
+        EXPECT_TRUE(GET_INT(tb_get_value(table, keys[count - 1])) == count - 1);
+        tb_delete_hash_table(table);
+
+        // other layouts take the same memory
+        uint32_t layouts[] = {TB_COMPACT, TB_CUCKOO};
+        for (uint32_t layout = 0; layout < 2; ++layout) {
+            options.flags = layouts[layout];
+            table = tb_create_hash_table_ex(1000, &options);
+            for (int i = 0; i < 1000; ++i) {
+                tb_insert_item(table, keys[i], &i);
+            }
+            EXPECT_TRUE(tb_reserve(table, 5000));
+            for (int i = 1000; i < 5000; ++i) {
+                tb_insert_item(table, keys[i], &i);
+            }
+            EXPECT_TRUE(GET_INT(tb_get_value(table, "key_999")) == 999);
+            EXPECT_TRUE(GET_INT(tb_get_value(table, "key_4999")) == 4999);
+            tb_delete_hash_table(table);
+        }
+    }
+    if (counter >= 0) {
+        close(counter);
+    }
+
+    // without reserved 1 GB pages, the slots take 2 MB pages, not 1 GB of memory
+    FILE *reserved = fopen("/sys/kernel/mm/hugepages/hugepages-1048576kB/free_hugepages", "r");
+    unsigned long free_pages = 0;
+    if (reserved != NULL) {
+        if (fscanf(reserved, "%lu", &free_pages) != 1) {
+            free_pages = 0;
+        }
+        fclose(reserved);
+    }
+    tb_hash_table_options options = {.memory = TB_MEMORY_HUGE_1GB};
+    uint64_t before = virtual_memory_kb();
+    tb_hash_table *table = tb_create_hash_table_ex(1000, &options);
+    ACTUAL_TRUE(table != NULL && table->items != NULL);
+    if (!free_pages && before) {
+        EXPECT_TRUE(virtual_memory_kb() - before < 1024 * 1024);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        tb_insert_item(table, keys[i], &i);
+    }
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_999")) == 999);
+    tb_delete_hash_table(table);
+    EXPECT_TRUE(!before || virtual_memory_kb() <= before);
+    free(keys);
+    free(order);
+}
+
+TEST(test_length_keys) {
+    uint32_t layouts[] = {0, TB_COMPACT, TB_CUCKOO, TB_SEEDED | TB_FILTER, TB_LRU};
+    // keys are parts of the text, without NUL after them
+    const char *text = "alpha,beta,gamma";
+    for (uint32_t layout = 0; layout < 5; ++layout) {
+        tb_hash_table_options options = {.flags = layouts[layout]};
+        tb_hash_table *table = tb_create_hash_table_ex(10, &options);
+        // values are copied as `sizeof(void *)` bytes
+        int64_t values[] = {1, 2, 3};
+        tb_hash_table_item *item = tb_insert_item_n(table, text, 5, &values[0]);
+        ACTUAL_TRUE(item != NULL);
+        EXPECT_STRINGS_EQ(item->key, "alpha");
+        tb_insert_item_n(table, text + 6, 4, &values[1]);
+        tb_insert_item(table, "gamma", &values[2]);
+        EXPECT_TRUE(tb_get_item_n(table, text + 11, 5) == tb_get_item(table, "gamma"));
+        EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(table, "beta")) == 2);
+        EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value_n(table, text, 5)) == 1);
+        EXPECT_TRUE(tb_get_value_n(table, text, 4) == NULL);
+        EXPECT_TRUE(tb_get_value_n(table, text, 6) == NULL);
+        // the same key gets a new value
+        EXPECT_TRUE(tb_insert_item_n(table, text + 6, 4, &values[2]) == tb_get_item(table, "beta"));
+        EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(table, "beta")) == 3);
+        EXPECT_EQ(table->count, 3);
+        uint32_t position = tb_item_position(table, tb_get_item(table, "beta"));
+        uint32_t after = 0;
+        while (tb_next_item(table, &position) != NULL) {
+            ++after;
+        }
+        EXPECT_TRUE(after <= 2);
+        EXPECT_FALSE(tb_delete_item_n(table, text, 4));
+        EXPECT_TRUE(tb_delete_item_n(table, text, 5));
+        EXPECT_TRUE(tb_get_item(table, "alpha") == NULL);
+        EXPECT_EQ(table->count, 2);
+        // the old value is given back by the same lookup
+        int64_t old = 0;
+        EXPECT_TRUE(tb_exchange_item_n(table, text + 6, 4, &values[0], &old) == tb_get_item(table, "beta"));
+        EXPECT_TRUE(old == 3);
+        EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(table, "beta")) == 1);
+        old = 0;
+        EXPECT_TRUE(tb_exchange_item_n(table, text, 5, &values[1], &old) != NULL);
+        EXPECT_TRUE(old == 0);
+        EXPECT_EQ(table->count, 3);
+        EXPECT_FALSE(tb_pop_item_n(table, text, 4, &old));
+        EXPECT_TRUE(old == 0);
+        EXPECT_TRUE(tb_pop_item_n(table, text, 5, &old));
+        EXPECT_TRUE(old == 2);
+        EXPECT_TRUE(tb_get_item(table, "alpha") == NULL);
+        EXPECT_EQ(table->count, 2);
+        tb_delete_hash_table(table);
+    }
+}
+
+TEST(test_shared_table) {
+    char name[64];
+    sprintf(name, "/tb_tests_%i", (int)getpid());
+    tb_unlink_shared_table(name);
+    tb_shared_table *table = tb_create_shared_table(name, 100000, 100000 * 16);
+    ACTUAL_TRUE(table != NULL);
+    EXPECT_TRUE(tb_create_shared_table(name, 10, 100) == NULL);
+    char key[32];
+    clock_t begin = clock();
+    for (int64_t i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_shared_insert(table, key, &i));
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_shared_insert' function perfomance of shared table - 100000 items: %f ms \n", time_spent);
+    EXPECT_EQ(tb_shared_count(table), 100000);
+    int64_t value = 0;
+    begin = clock();
+    for (int64_t i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_shared_get_value(table, key, &value) && value == i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_shared_get_value' function perfomance of shared table - 100000 items: %f ms \n", time_spent);
+
+    // workers read and write the same table, while this process removes keys
+    fflush(stdout);
+    pid_t workers[2];
+    for (int worker = 0; worker < 2; ++worker) {
+        workers[worker] = fork();
+        if (workers[worker] == 0) {
+            tb_shared_table *shared = tb_open_shared_table(name);
+            int good = shared != NULL;
+            for (int64_t i = 0; good && i < 50000; ++i) {
+                sprintf(key, "key_%i", (int)i);
+                good = tb_shared_get_value(shared, key, &value) && value == i;
+            }
+            int64_t id = worker;
+            sprintf(key, "worker_%i", worker);
+            good = good && tb_shared_insert(shared, key, &id);
+            if (shared != NULL) {
+                tb_close_shared_table(shared);
+            }
+            _exit(good ? 0 : 1);
+        }
+    }
+    for (int i = 50000; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_shared_delete(table, key));
+    }
+    for (int worker = 0; worker < 2; ++worker) {
+        int status = -1;
+        waitpid(workers[worker], &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    EXPECT_TRUE(tb_shared_get_value(table, "worker_1", &value) && value == 1);
+    EXPECT_FALSE(tb_shared_get_value(table, "key_50000", &value));
+    EXPECT_EQ(tb_shared_count(table), 50002);
+
+    // the removed slots are reused, until the table is full
+    for (int64_t i = 50000; i < 99998; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_shared_insert(table, key, &i));
+    }
+    EXPECT_FALSE(tb_shared_insert(table, "key_99999", &value));
+    value = -1;
+    EXPECT_TRUE(tb_shared_insert(table, "key_5", &value));
+    EXPECT_TRUE(tb_shared_get_value(table, "key_5", &value) && value == -1);
+    EXPECT_EQ(tb_shared_count(table), 100000);
+    tb_close_shared_table(table);
+    EXPECT_TRUE(tb_unlink_shared_table(name));
+    EXPECT_TRUE(tb_open_shared_table(name) == NULL);
+
+    // the removed records are reused, a small table is never full of them
+    table = tb_create_shared_table(name, 1000, 1000 * 16);
+    ACTUAL_TRUE(table != NULL);
+    for (int64_t i = 0; i < 3000; ++i) {
+        EXPECT_TRUE(tb_shared_insert(table, "churn", &i));
+        EXPECT_TRUE(tb_shared_delete(table, "churn"));
+    }
+    for (int64_t i = 0; i < 500; ++i) {
+        sprintf(key, "stable_%i", (int)i);
+        EXPECT_TRUE(tb_shared_insert(table, key, &i));
+    }
+    // a worker reads the stable keys and the removed ones, while this process 
+    // reuses their records for other keys with other values
+    fflush(stdout);
+    pid_t reader = fork();
+    if (reader == 0) {
+        tb_shared_table *shared = tb_open_shared_table(name);
+        int good = shared != NULL;
+        for (int round = 0; good && round < 200; ++round) {
+            for (int64_t i = 0; good && i < 500; ++i) {
+                sprintf(key, "stable_%i", (int)i);
+                good = tb_shared_get_value(shared, key, &value) && value == i;
+                sprintf(key, "k%i", (int)i);
+                good = good && (!tb_shared_get_value(shared, key, &value) || value == i);
+            }
+        }
+        if (shared != NULL) {
+            tb_close_shared_table(shared);
+        }
+        _exit(good ? 0 : 1);
+    }
+    for (int round = 0; round < 50; ++round) {
+        // keys of other lengths take records of other sizes
+        const char *format = round % 2 ? "k%i" : "key_of_round_%i";
+        for (int64_t i = 0; i < 500; ++i) {
+            sprintf(key, format, (int)i);
+            EXPECT_TRUE(tb_shared_insert(table, key, &i));
+        }
+        EXPECT_EQ(tb_shared_count(table), 1000);
+        EXPECT_FALSE(tb_shared_insert(table, "full", &value));
+        for (int i = 0; i < 500; ++i) {
+            sprintf(key, format, i);
+            EXPECT_TRUE(tb_shared_delete(table, key));
+        }
+    }
+    int status = -1;
+    waitpid(reader, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_EQ(tb_shared_count(table), 500);
+    tb_close_shared_table(table);
+    EXPECT_TRUE(tb_unlink_shared_table(name));
+
+    // the removed slots are purged, misses stay fast after many deletions
+    table = tb_create_shared_table(name, 100000, 100000 * 16);
+    ACTUAL_TRUE(table != NULL);
+    for (int64_t i = 0; i < 50000; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_shared_insert(table, key, &i));
+    }
+    double miss_time[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        begin = clock();
+        for (int i = 0; i < 100000; ++i) {
+            sprintf(key, "miss_%i", i);
+            EXPECT_FALSE(tb_shared_get_value(table, key, &value));
+        }
+        end = clock();
+        miss_time[pass] = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+        for (int64_t i = 0; pass == 0 && i < 200000; ++i) {
+            sprintf(key, "churn_%i", (int)i);
+            EXPECT_TRUE(tb_shared_insert(table, key, &i));
+            EXPECT_TRUE(tb_shared_delete(table, key));
+        }
+    }
+    printf("Misses of shared table - 100000 keys: %f ms, after 200000 deletions: %f ms \n", 
+            miss_time[0], miss_time[1]);
+    uint32_t removed = 0;
+    for (uint32_t i = 0; i < table->allocated; ++i) {
+        // 1 is a removed slot
+        removed += table->slots[i] == 1;
+    }
+    EXPECT_TRUE(removed <= (table->allocated - 100000) / 2);
+    EXPECT_EQ(tb_shared_count(table), 50000);
+    EXPECT_TRUE(tb_shared_get_value(table, "key_49999", &value) && value == 49999);
+    tb_close_shared_table(table);
+    EXPECT_TRUE(tb_unlink_shared_table(name));
+}
+
+/*
+    The wall time since `begin` in milliseconds, the time of syncs 
+    is not the time of this process.
+ */
+static double elapsed_ms(const struct timespec *begin) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - begin->tv_sec) * 1000 + (double)(now.tv_nsec - begin->tv_nsec) / 1e6;
+}
+
+TEST(test_table_log) {
+    char path[64], snapshot[80], key[32];
+    sprintf(path, "/tmp/tb_tests_%i.log", (int)getpid());
+    sprintf(snapshot, "%s.snapshot", path);
+    unlink(path);
+    unlink(snapshot);
+    struct timespec begin;
+
+    // every operation is synced
+    tb_hash_table *table = tb_create_hash_table(100000);
+    tb_table_log *log = tb_open_table_log(table, path, NULL);
+    ACTUAL_TRUE(log != NULL);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int64_t i = 0; i < 200; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_log_insert_item(log, key, &i));
+    }
+    printf("'tb_log_insert_item' function perfomance of a log, sync of every operation - 200 items: %f ms \n", 
+            elapsed_ms(&begin));
+    EXPECT_EQ(log->commits, 200);
+    EXPECT_TRUE(tb_close_table_log(log));
+
+    // group commits, the window does not end by the test clock
+    tb_log_options options = {10, 1000, 0, test_clock};
+    tb_delete_hash_table(table);
+    table = tb_create_hash_table(100000);
+    log = tb_open_table_log(table, path, &options);
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 200);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int64_t i = 200; i < 100000; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        EXPECT_TRUE(tb_log_insert_item(log, key, &i));
+    }
+    printf("'tb_log_insert_item' function perfomance of a log, group commits - 99800 items: %f ms \n", 
+            elapsed_ms(&begin));
+    EXPECT_EQ(log->commits, 99);
+    EXPECT_EQ(log->pending, 800);
+    // the window ends by the next operation
+    test_now += 10;
+    int64_t value = -1;
+    EXPECT_TRUE(tb_log_insert_item(log, "key_0", &value));
+    EXPECT_EQ(log->pending, 0);
+    for (int i = 0; i < 100000; i += 2) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_log_delete_item(log, key));
+    }
+    EXPECT_FALSE(tb_log_delete_item(log, "key_0"));
+    EXPECT_TRUE(tb_close_table_log(log));
+
+    // recovery replays the log
+    tb_delete_hash_table(table);
+    table = tb_create_hash_table(100000);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    log = tb_open_table_log(table, path, &options);
+    printf("'tb_open_table_log' function perfomance, recovery of 150001 operations: %f ms \n", 
+            elapsed_ms(&begin));
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 50000);
+    EXPECT_TRUE(tb_get_value(table, "key_0") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_99999")) == 99999);
+
+    // a compaction writes the snapshot and empties the log
+    EXPECT_TRUE(tb_log_compact(log));
+    EXPECT_EQ(log->compactions, 1);
+    EXPECT_EQ(log->log_bytes, 16);
+    value = 7;
+    EXPECT_TRUE(tb_log_insert_item(log, "after", &value));
+    EXPECT_TRUE(tb_log_delete_item(log, "key_1"));
+    EXPECT_TRUE(tb_close_table_log(log));
+    // a torn record at the end of the log
+    int fd = open(path, O_WRONLY | O_APPEND);
+    EXPECT_TRUE(write(fd, "\x12\x34\x56\x78\x05\x00\x00\x00torn", 12) == 12);
+    close(fd);
+
+    tb_delete_hash_table(table);
+    table = tb_create_hash_table(100000);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    log = tb_open_table_log(table, path, &options);
+    printf("'tb_open_table_log' function perfomance, recovery of a snapshot of 50000 items: %f ms \n", 
+            elapsed_ms(&begin));
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 50000);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "after")) == 7);
+    EXPECT_TRUE(tb_get_value(table, "key_1") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_3")) == 3);
+    // the torn record is cut, new records follow the last complete one
+    struct stat st;
+    EXPECT_TRUE(stat(path, &st) == 0 && (uint64_t)st.st_size == log->log_bytes);
+    EXPECT_TRUE(tb_close_table_log(log));
+    tb_delete_hash_table(table);
+
+    // the recovery grows a smaller table
+    table = tb_create_hash_table(1000);
+    log = tb_open_table_log(table, path, &options);
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 50000);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_99999")) == 99999);
+    EXPECT_TRUE(tb_close_table_log(log));
+    tb_delete_hash_table(table);
+
+    // big tables are compacted by the size of the log
+    unlink(path);
+    unlink(snapshot);
+    tb_log_options compacting = {10, 1000, 4 * 1024 * 1024, test_clock};
+    table = tb_create_hash_table(400000);
+    log = tb_open_table_log(table, path, &compacting);
+    ACTUAL_TRUE(log != NULL);
+    for (int64_t i = 0; i < 400000; ++i) {
+        sprintf(key, "big_key_%i", (int)i);
+        EXPECT_TRUE(tb_log_insert_item(log, key, &i));
+    }
+    EXPECT_TRUE(log->compactions >= 2);
+    EXPECT_TRUE(tb_close_table_log(log));
+    tb_delete_hash_table(table);
+    table = tb_create_hash_table(16);
+    log = tb_open_table_log(table, path, &compacting);
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 400000);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "big_key_399999")) == 399999);
+    // a failed compaction does not fail the durable operations
+    unlink(snapshot);
+    EXPECT_TRUE(mkdir(snapshot, 0700) == 0);
+    uint64_t compactions = log->compactions;
+    log->options.compact_bytes = 16;
+    log->options.window = 0;
+    value = 1;
+    EXPECT_TRUE(tb_log_insert_item(log, "big_key_0", &value));
+    EXPECT_EQ(log->compactions, compactions);
+    EXPECT_TRUE(tb_close_table_log(log));
+    rmdir(snapshot);
+    tb_delete_hash_table(table);
+
+    // a partial write of a group is cut, the group is written again
+    unlink(path);
+    table = tb_create_hash_table(100);
+    log = tb_open_table_log(table, path, &options);
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_TRUE(tb_log_insert_item(log, "first", &value));
+    EXPECT_TRUE(tb_log_sync(log));
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    struct rlimit small = {log->log_bytes + 20, limit.rlim_max};
+    setrlimit(RLIMIT_FSIZE, &small);
+    for (int64_t i = 0; i < 10; ++i) {
+        sprintf(key, "torn_%i", (int)i);
+        EXPECT_TRUE(tb_log_insert_item(log, key, &i));
+    }
+    EXPECT_FALSE(tb_log_sync(log));
+    EXPECT_TRUE(stat(path, &st) == 0 && (uint64_t)st.st_size == log->log_bytes);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, SIG_DFL);
+    for (int64_t i = 10; i < 20; ++i) {
+        sprintf(key, "torn_%i", (int)i);
+        EXPECT_TRUE(tb_log_insert_item(log, key, &i));
+    }
+    EXPECT_TRUE(tb_log_sync(log));
+    EXPECT_TRUE(tb_close_table_log(log));
+    tb_delete_hash_table(table);
+    table = tb_create_hash_table(100);
+    log = tb_open_table_log(table, path, &options);
+    ACTUAL_TRUE(log != NULL);
+    EXPECT_EQ(table->count, 21);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "torn_19")) == 19);
+    EXPECT_TRUE(tb_close_table_log(log));
+    tb_delete_hash_table(table);
+
+    // the log can not keep the keys of interned tables
+    tb_hash_table_options interned = {0};
+    interned.flags = TB_INTERNED;
+    table = tb_create_hash_table_ex(16, &interned);
+    EXPECT_TRUE(tb_open_table_log(table, path, NULL) == NULL);
+    tb_delete_hash_table(table);
+    unlink(path);
+    unlink(snapshot);
+}
+
+/*
+    Adds the count of a key of a partial table to the merged count.
+ */
+static void add_counts(const char *key, void *dst_val, const void *src_val) {
+    (void)key;
+    *(int64_t *)dst_val += *(const int64_t *)src_val;
+}
+
+/*
+    Fills `count` partial tables of 20000 keys each, keys of different 
+    tables overlap, every key is counted once in its table.
+ */
+static void fill_partials(tb_hash_table **partials, uint32_t count, const tb_hash_table_options *options) {
+    char key[32];
+    int64_t one = 1;
+    for (uint32_t p = 0; p < count; ++p) {
+        partials[p] = tb_create_hash_table_ex(20000, options);
+        for (int i = 0; i < 20000; ++i) {
+            sprintf(key, "word_%i", (int)((i * 7 + p * 4999) % 100000));
+            tb_insert_item(partials[p], key, &one);
+        }
+    }
+}
+
+/*
+    Checks the merged counts of `fill_partials`.
+ */
+static int merged_counts_valid(const tb_hash_table *table, uint32_t partials) {
+    int64_t sum = 0;
+    uint32_t position = 0, count = 0;
+    tb_hash_table_item *item;
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        sum += GET_CUSTOM_TYPE(int64_t, item->val);
+        ++count;
+    }
+    return count == table->count && sum == (int64_t)partials * 20000;
+}
+
+TEST(test_merge_tables) {
+    const uint32_t count = 16;
+    tb_hash_table *partials[16];
+    tb_hash_table_options options = {0};
+
+    // the merge by lookups and insertions
+    fill_partials(partials, count, &options);
+    tb_hash_table *table = tb_create_hash_table(20000);
+    clock_t begin = clock();
+    for (uint32_t p = 0; p < count; ++p) {
+        uint32_t position = 0;
+        tb_hash_table_item *item;
+        while ((item = tb_next_item(partials[p], &position)) != NULL) {
+            if (table->count == table->size) {
+                tb_reserve(table, table->size * 2);
+            }
+            int64_t value = GET_CUSTOM_TYPE(int64_t, item->val);
+            void *known = tb_get_value(table, item->key);
+            if (known != NULL) {
+                value += GET_CUSTOM_TYPE(int64_t, known);
+            }
+            tb_insert_item(table, item->key, &value);
+        }
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' and 'tb_insert_item' perfomance of merge - 16 tables of 20000 items: %f ms \n", 
+            time_spent);
+    uint32_t distinct = table->count;
+    EXPECT_TRUE(merged_counts_valid(table, count));
+    tb_delete_hash_table(table);
+
+    // the items are moved
+    table = tb_create_hash_table(20000);
+    begin = clock();
+    for (uint32_t p = 0; p < count; ++p) {
+        EXPECT_TRUE(tb_merge(table, partials[p], add_counts));
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_merge' function perfomance - 16 tables of 20000 items: %f ms \n", time_spent);
+    EXPECT_EQ(table->count, distinct);
+    EXPECT_TRUE(merged_counts_valid(table, count));
+    for (uint32_t p = 0; p < count; ++p) {
+        EXPECT_TRUE(partials[p]->empty && partials[p]->count == 0);
+        EXPECT_TRUE(tb_get_value(partials[p], "word_0") == NULL);
+        tb_delete_hash_table(partials[p]);
+    }
+    tb_delete_hash_table(table);
+
+    // the parallel merge, the wall time of threads
+    fill_partials(partials, count, &options);
+    table = tb_create_hash_table(20000);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    EXPECT_TRUE(tb_merge_many(table, partials, count, add_counts, 4));
+    printf("'tb_merge_many' function perfomance, 4 threads - 16 tables of 20000 items: %f ms \n", 
+            elapsed_ms(&start));
+    EXPECT_EQ(table->count, distinct);
+    EXPECT_TRUE(merged_counts_valid(table, count));
+    EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(table, "word_4999")) >= 1);
+    for (uint32_t p = 0; p < count; ++p) {
+        EXPECT_TRUE(partials[p]->count == 0);
+        // a merged table can be filled again
+        int64_t value = 5;
+        tb_insert_item(partials[p], "again", &value);
+        EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(partials[p], "again")) == 5);
+    }
+    // without `combine` the value of the source is taken
+    EXPECT_TRUE(tb_merge(table, partials[0], NULL));
+    EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, tb_get_value(table, "again")) == 5);
+    for (uint32_t p = 0; p < count; ++p) {
+        tb_delete_hash_table(partials[p]);
+    }
+    tb_delete_hash_table(table);
+
+    // other layouts are merged by insertions, the filter is kept
+    uint32_t layouts[] = {TB_COMPACT, TB_CUCKOO, TB_FILTER};
+    for (uint32_t layout = 0; layout < 3; ++layout) {
+        tb_hash_table_options other = {.flags = layouts[layout]};
+        tb_hash_table *merged = tb_create_hash_table_ex(16, &other);
+        fill_partials(partials, 4, &options);
+        EXPECT_TRUE(tb_merge_many(merged, partials, 4, add_counts, 2));
+        EXPECT_TRUE(merged_counts_valid(merged, 4));
+        EXPECT_TRUE(tb_get_value(merged, "word_7") != NULL);
+        EXPECT_TRUE(tb_get_value(merged, "word_100001") == NULL);
+        for (uint32_t p = 0; p < 4; ++p) {
+            EXPECT_TRUE(partials[p]->count == 0);
+            tb_delete_hash_table(partials[p]);
+        }
+        tb_delete_hash_table(merged);
+    }
+}
+
+/*
+    The callback of traced tables, counts the events of every operation, 
+    keeps the last event.
+ */
+static void count_events(const tb_hash_table *table, const tb_trace_event *event, void *context) {
+    (void)table;
+    tb_trace_event *events = (tb_trace_event *)context;
+    ++events[event->operation].probes;
+    events[4] = *event;
+}
+
+TEST(test_trace_table) {
+    tb_hash_table *table = tb_create_hash_table(100000);
+    char key[32];
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        tb_insert_item(table, key, &i);
+    }
+    clock_t begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_get_value(table, key) != NULL);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of not traced table - 100000 items: %f ms \n", time_spent);
+
+    // the first 4 events are the counters of operations, the last one is the last event
+    tb_trace_event events[5];
+    memset(events, 0, sizeof(events));
+    tb_set_trace(table, count_events, events);
+    begin = clock();
+    for (int i = 0; i < 100000; ++i) {
+        sprintf(key, "key_%i", i);
+        EXPECT_TRUE(tb_get_value(table, key) != NULL);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_value' function perfomance of traced table - 100000 items: %f ms \n", time_spent);
+    EXPECT_EQ(events[TB_TRACE_GET].probes, 100000);
+    EXPECT_EQ(events[4].operation, TB_TRACE_GET);
+    EXPECT_STRINGS_EQ(events[4].key, "key_99999");
+    EXPECT_EQ(events[4].probes, tb_probe_length(table, "key_99999"));
+
+    int value = 5;
+    tb_insert_item(table, "key_5", &value);
+    EXPECT_EQ(events[TB_TRACE_INSERT].probes, 1);
+    EXPECT_EQ(events[4].probes, tb_probe_length(table, "key_5"));
+    // the key does not need NUL
+    EXPECT_TRUE(tb_get_item_n(table, "key_5000", 5) != NULL);
+    EXPECT_EQ(events[4].length, 5);
+    uint32_t probes = tb_probe_length(table, "key_7");
+    EXPECT_TRUE(tb_delete_item(table, "key_7"));
+    EXPECT_EQ(events[4].operation, TB_TRACE_DELETE);
+    EXPECT_EQ(events[4].probes, probes);
+    EXPECT_TRUE(tb_reserve(table, 300000));
+    EXPECT_EQ(events[4].operation, TB_TRACE_RESIZE);
+    EXPECT_TRUE(events[4].key == NULL && events[4].probes == table->allocated);
+    EXPECT_TRUE(events[4].cycles > 0);
+    // a smaller size is not a resize
+    EXPECT_TRUE(tb_reserve(table, 10));
+    EXPECT_EQ(events[TB_TRACE_RESIZE].probes, 1);
+
+    tb_set_trace(table, NULL, NULL);
+    tb_get_value(table, "key_1");
+    EXPECT_EQ(events[TB_TRACE_GET].probes, 100001);
+    tb_delete_hash_table(table);
+
+    // other layouts
+    uint32_t layouts[] = {TB_COMPACT, TB_CUCKOO};
+    for (uint32_t layout = 0; layout < 2; ++layout) {
+        tb_hash_table_options options = {.flags = layouts[layout]};
+        table = tb_create_hash_table_ex(100, &options);
+        memset(events, 0, sizeof(events));
+        tb_set_trace(table, count_events, events);
+        for (int i = 0; i < 100; ++i) {
+            sprintf(key, "key_%i", i);
+            tb_insert_item(table, key, &i);
+        }
+        EXPECT_TRUE(tb_get_value(table, "key_50") != NULL);
+        EXPECT_EQ(events[4].probes, tb_probe_length(table, "key_50"));
+        EXPECT_TRUE(tb_delete_item(table, "key_50"));
+        EXPECT_EQ(events[TB_TRACE_INSERT].probes, 100);
+        EXPECT_EQ(events[TB_TRACE_DELETE].probes, 1);
+        tb_delete_hash_table(table);
+    }
+}
+
+/*
+    Returns the time of lookups of `count` missing keys in ms.
+ */
+static double miss_lookups_ms(const tb_hash_table * const table, uint32_t count) {
+    char key[32];
+    clock_t begin = clock();
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "miss_%u", i);
+        EXPECT_TRUE(tb_get_value(table, key) == NULL);
+    }
+    return (double)(clock() - begin) / (CLOCKS_PER_SEC / 1000);
+}
+
+/*
+    Returns the sum of probe lengths of `count` missing keys.
+ */
+static uint64_t miss_probes(const tb_hash_table * const table, uint32_t count) {
+    char key[32];
+    uint64_t probes = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "miss_%u", i);
+        probes += tb_probe_length(table, key);
+    }
+    return probes;
+}
+
+/*
+    Returns 1 if the table has the values of the keys `i % step == 0` 
+    below `count`, and no other keys below `count`.
+ */
+static int stepped_keys_valid(const tb_hash_table * const table, uint32_t count, uint32_t step) {
+    char key[32];
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "key_%u", i);
+        void *found = tb_get_value(table, key);
+        if (i % step == 0 ? found == NULL || GET_CUSTOM_TYPE(int64_t, found) != i : found != NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+TEST(test_shrink_table) {
+    const uint32_t count = 100000;
+    char key[32];
+    tb_hash_table *table = tb_create_hash_table(count);
+    for (int64_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (uint32_t)i);
+        tb_insert_item(table, key, &i);
+    }
+    // a snapshot stops purges, the bulk deletion leaves all tombstones
+    tb_table_snapshot *snapshot = tb_snapshot(table);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 10) {
+            snprintf(key, sizeof(key), "key_%u", i);
+            tb_delete_item(table, key);
+        }
+    }
+    EXPECT_TRUE(tb_shrink_to_fit(table) == 0);
+    tb_delete_snapshot(snapshot);
+    EXPECT_EQ(table->tombstones, count - count / 10);
+    // the pool keeps the blocks of removed items, until the shrink
+    EXPECT_EQ(table->pooled, count - count / 10);
+    uint32_t allocated = table->allocated;
+    uint64_t probes = miss_probes(table, 1000);
+    printf("'tb_get_value' function perfomance, misses with 90%% of tombstones - %u items: %f ms \n", 
+            count, miss_lookups_ms(table, count));
+
+    // the slots shrink step by step, lookups see all items meanwhile
+    EXPECT_TRUE(tb_shrink_to_fit(table));
+    EXPECT_EQ(table->pooled, 0);
+    EXPECT_EQ(table->size, count);
+    EXPECT_TRUE(tb_rehash_step(table, 1000) > 0);
+    EXPECT_EQ(table->allocated, allocated);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 10));
+    clock_t begin = clock();
+    while (tb_rehash_step(table, 1000)) {
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_rehash_step' function perfomance - shrink of %u slots: %f ms \n", allocated, time_spent);
+    EXPECT_TRUE(table->rehash == NULL);
+    EXPECT_TRUE(table->allocated < allocated / 4);
+    EXPECT_EQ(table->tombstones, 0);
+    EXPECT_TRUE(miss_probes(table, 1000) < probes);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 10));
+    printf("'tb_get_value' function perfomance, misses after 'tb_shrink_to_fit' - %u items: %f ms \n", 
+            count, miss_lookups_ms(table, count));
+    // nothing to shrink
+    allocated = table->allocated;
+    EXPECT_TRUE(tb_shrink_to_fit(table));
+    EXPECT_TRUE(table->rehash == NULL && table->allocated == allocated);
+    // new keys grow the slots back, up to the size
+    int64_t value = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 10) {
+            value = i;
+            snprintf(key, sizeof(key), "key_%u", i);
+            EXPECT_TRUE(tb_insert_item_n(table, key, strlen(key), &value) != NULL);
+        }
+    }
+    EXPECT_EQ(table->count, count);
+    EXPECT_TRUE(table->allocated > allocated);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 1));
+    EXPECT_TRUE(tb_insert_item_n(table, "over", 4, &value) == NULL);
+    // `tb_reserve` of a smaller size grows shrunk slots too
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 10) {
+            snprintf(key, sizeof(key), "key_%u", i);
+            tb_delete_item(table, key);
+        }
+    }
+    EXPECT_TRUE(tb_shrink_to_fit(table));
+    EXPECT_TRUE(tb_reserve(table, count));
+    EXPECT_TRUE(table->rehash == NULL && table->allocated >= count);
+    EXPECT_EQ(table->size, count);
+    tb_delete_hash_table(table);
+
+    // keys of other lengths do not reuse the blocks, the pool is limited
+    table = tb_create_hash_table(100);
+    for (int round = 0; round < 10; ++round) {
+        for (int64_t i = 0; i < 100; ++i) {
+            snprintf(key, sizeof(key), "%0*u", 3 + round * 2, (uint32_t)i);
+            tb_insert_item(table, key, &i);
+        }
+        for (uint32_t i = 0; i < 100; ++i) {
+            snprintf(key, sizeof(key), "%0*u", 3 + round * 2, i);
+            tb_delete_item(table, key);
+        }
+        EXPECT_TRUE(table->pooled <= table->size);
+    }
+    EXPECT_EQ(table->pooled, table->size);
+    tb_delete_hash_table(table);
+
+    // tombstones are purged by deletions themselves
+    table = tb_create_hash_table(count);
+    for (int64_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (uint32_t)i);
+        tb_insert_item(table, key, &i);
+    }
+    allocated = table->allocated;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 10) {
+            snprintf(key, sizeof(key), "key_%u", i);
+            tb_delete_item(table, key);
+        }
+        EXPECT_TRUE(table->tombstones <= allocated / 8 + allocated / 64 + 1);
+    }
+    EXPECT_EQ(table->allocated, allocated);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 10));
+    tb_rehash_step(table, UINT32_MAX);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 10));
+
+    // insertions, updates and deletions during a shrink
+    EXPECT_TRUE(tb_shrink_to_fit(table));
+    for (int64_t i = 0; i < count; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (uint32_t)i);
+        if (i % 20 == 0) {
+            int64_t value = i + 1;
+            tb_insert_item(table, key, &value);
+            tb_insert_item(table, key, &i);
+        } else if (i % 10 == 0) {
+            tb_delete_item(table, key);
+        }
+        if (i % 1000 == 0) {
+            tb_rehash_step(table, 16);
+        }
+    }
+    while (tb_rehash_step(table, 16)) {
+    }
+    EXPECT_EQ(table->count, count / 20);
+    EXPECT_TRUE(stepped_keys_valid(table, count, 20));
+    uint32_t position = 0, seen = 0;
+    while (tb_next_item(table, &position) != NULL) {
+        ++seen;
+    }
+    EXPECT_EQ(seen, count / 20);
+    tb_delete_hash_table(table);
+
+    // a cache keeps the order of recency
+    tb_hash_table_options options = {.flags = TB_LRU};
+    table = tb_create_hash_table_ex(1000, &options);
+    for (int64_t i = 0; i < 1000; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (uint32_t)i);
+        tb_insert_item(table, key, &i);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        if (i % 4) {
+            snprintf(key, sizeof(key), "key_%u", i);
+            tb_delete_item(table, key);
+        }
+    }
+    EXPECT_TRUE(tb_shrink_to_fit(table));
+    tb_rehash_step(table, UINT32_MAX);
+    EXPECT_EQ(table->size, 1000);
+    EXPECT_TRUE(stepped_keys_valid(table, 1000, 4));
+    value = -1;
+    // the least recently used key is evicted, when the size is full again
+    for (int64_t i = 1000; i < 1750; ++i) {
+        snprintf(key, sizeof(key), "key_%u", (uint32_t)i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_EQ(table->count, 1000);
+    tb_insert_item(table, "new", &value);
+    EXPECT_TRUE(tb_get_value(table, "key_0") == NULL);
+    EXPECT_TRUE(tb_get_value(table, "key_4") != NULL);
+    tb_delete_hash_table(table);
+
+    // other layouts are not shrunk
+    tb_hash_table_options compact = {.flags = TB_COMPACT};
+    table = tb_create_hash_table_ex(16, &compact);
+    EXPECT_TRUE(tb_shrink_to_fit(table) == 0);
+    tb_delete_hash_table(table);
+}
+
+/*
+    A vector of values, it is the value of a table without `TB_MULTI`.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    int64_t *values;
+} test_vector;
+
+/*
+    Returns 1 if the table has `per_key` values of every key of `keys` 
+    users in the order of appends, the value `j` of the user `i` is `j * keys + i`.
+ */
+static int multi_values_valid(const tb_hash_table * const table, uint32_t keys, uint32_t per_key) {
+    char key[32];
+    for (uint32_t i = 0; i < keys; ++i) {
+        snprintf(key, sizeof(key), "user_%u", i);
+        uint32_t count;
+        void *values = tb_get_all_values(table, key, &count);
+        if (values == NULL || count != per_key) {
+            return 0;
+        }
+        for (uint32_t j = 0; j < count; ++j) {
+            if (GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, j)) != (int64_t)j * keys + i) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+TEST(test_multi_table) {
+    const uint32_t keys = 20000, per_key = 20;
+    char key[32];
+    tb_hash_table_options options = {.flags = TB_MULTI};
+    tb_hash_table *table = tb_create_hash_table_ex(keys, &options);
+    // sessions of users are appended in turns, as events come
+    clock_t begin = clock();
+    for (int64_t j = 0; j < per_key; ++j) {
+        for (uint32_t i = 0; i < keys; ++i) {
+            snprintf(key, sizeof(key), "user_%u", i);
+            int64_t value = j * keys + i;
+            EXPECT_TRUE(tb_append_value(table, key, &value) == j + 1);
+        }
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_append_value' function perfomance - %u keys, %u values: %f ms \n", 
+            keys, keys * per_key, time_spent);
+    EXPECT_EQ(table->count, keys);
+    int64_t sum = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < keys; ++i) {
+        snprintf(key, sizeof(key), "user_%u", i);
+        uint32_t count;
+        void *values = tb_get_all_values(table, key, &count);
+        for (uint32_t j = 0; j < count; ++j) {
+            sum += GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, j));
+        }
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'tb_get_all_values' function perfomance - %u keys, %u values: %f ms \n", 
+            keys, keys * per_key, time_spent);
+    int64_t total = (int64_t)keys * per_key;
+    EXPECT_TRUE(sum == total * (total - 1) / 2);
+    EXPECT_TRUE(multi_values_valid(table, keys, per_key));
+
+    // the same by vectors, which are the values of a table
+    tb_hash_table *vectors = tb_create_hash_table(keys);
+    begin = clock();
+    for (int64_t j = 0; j < per_key; ++j) {
+        for (uint32_t i = 0; i < keys; ++i) {
+            snprintf(key, sizeof(key), "user_%u", i);
+            void *found = tb_get_value(vectors, key);
+            test_vector *vector = found != NULL ? GET_CUSTOM_TYPE(test_vector *, found) : NULL;
+            if (vector == NULL) {
+                vector = (test_vector *)calloc(1, sizeof(test_vector));
+                tb_insert_item(vectors, key, &vector);
+            }
+            if (vector->count == vector->capacity) {
+                vector->capacity = vector->capacity ? vector->capacity * 2 : 1;
+                vector->values = (int64_t *)realloc(vector->values, vector->capacity * sizeof(int64_t));
+            }
+            vector->values[vector->count++] = j * keys + i;
+        }
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Appends perfomance of vectors in values - %u keys, %u values: %f ms \n", 
+            keys, keys * per_key, time_spent);
+    sum = 0;
+    begin = clock();
+    for (uint32_t i = 0; i < keys; ++i) {
+        snprintf(key, sizeof(key), "user_%u", i);
+        test_vector *vector = GET_CUSTOM_TYPE(test_vector *, tb_get_value(vectors, key));
+        for (uint32_t j = 0; j < vector->count; ++j) {
+            sum += vector->values[j];
+        }
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("Lookups perfomance of vectors in values - %u keys, %u values: %f ms \n", 
+            keys, keys * per_key, time_spent);
+    EXPECT_TRUE(sum == total * (total - 1) / 2);
+    uint32_t position = 0;
+    tb_hash_table_item *item;
+    while ((item = tb_next_item(vectors, &position)) != NULL) {
+        test_vector *vector = GET_CUSTOM_TYPE(test_vector *, item->val);
+        free(vector->values);
+        free(vector);
+    }
+    tb_delete_hash_table(vectors);
+
+    // iteration gives the runs of the items
+    position = 0;
+    sum = 0;
+    while ((item = tb_next_item(table, &position)) != NULL) {
+        uint32_t count;
+        void *values = tb_item_values(table, item, &count);
+        EXPECT_EQ(count, per_key);
+        sum += GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, count - 1));
+    }
+    EXPECT_TRUE(sum == (int64_t)keys * (per_key - 1) * keys + (int64_t)keys * (keys - 1) / 2);
+
+    // a copy and a snapshot keep the runs
+    tb_hash_table *copy = tb_copy_hash_table(table);
+    tb_table_snapshot *snapshot = tb_snapshot(table);
+    int64_t value = -1;
+    EXPECT_TRUE(tb_append_value(table, "user_0", &value) == per_key + 1);
+    EXPECT_TRUE(multi_values_valid(copy, keys, per_key));
+    uint32_t count;
+    tb_item_values(table, tb_snapshot_get_item(snapshot, "user_0"), &count);
+    EXPECT_EQ(count, per_key);
+    tb_delete_snapshot(snapshot);
+    tb_delete_hash_table(copy);
+
+    // values are removed in order, the key with the last one
+    EXPECT_TRUE(tb_delete_value(table, "user_0", &value));
+    EXPECT_FALSE(tb_delete_value(table, "user_0", &value));
+    for (int64_t j = 0; j < per_key; j += 2) {
+        value = j * keys;
+        EXPECT_TRUE(tb_delete_value(table, "user_0", &value));
+    }
+    void *values = tb_get_all_values(table, "user_0", &count);
+    EXPECT_EQ(count, per_key / 2);
+    EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, 0)) == keys);
+    EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, count - 1)) == (int64_t)(per_key - 1) * keys);
+    for (int64_t j = 1; j < per_key; j += 2) {
+        value = j * keys;
+        EXPECT_TRUE(tb_delete_value(table, "user_0", &value));
+    }
+    EXPECT_TRUE(tb_get_all_values(table, "user_0", &count) == NULL && count == 0);
+    EXPECT_EQ(table->count, keys - 1);
+    // `tb_insert_item` sets the first value
+    value = 7;
+    tb_insert_item(table, "user_1", &value);
+    values = tb_get_all_values(table, "user_1", &count);
+    EXPECT_TRUE(count == per_key && GET_CUSTOM_TYPE(int64_t, values) == 7);
+    EXPECT_TRUE(GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, 1)) == keys + 1);
+    EXPECT_TRUE(tb_delete_item(table, "user_1"));
+
+    // merged runs are appended
+    tb_hash_table *other = tb_create_hash_table_ex(16, &options);
+    value = 100;
+    tb_append_value(other, "user_2", &value);
+    tb_append_value(other, "merged", &value);
+    EXPECT_TRUE(tb_merge(table, other, NULL));
+    values = tb_get_all_values(table, "user_2", &count);
+    EXPECT_TRUE(count == per_key + 1 && GET_CUSTOM_TYPE(int64_t, TB_VALUE_AT(values, per_key)) == 100);
+    EXPECT_TRUE(tb_get_all_values(table, "merged", &count) != NULL && count == 1);
+    tb_delete_hash_table(other);
+    tb_delete_hash_table(table);
+
+    // other tables have one value of a key
+    table = tb_create_hash_table(16);
+    value = 5;
+    tb_insert_item(table, "one", &value);
+    EXPECT_TRUE(tb_append_value(table, "one", &value) == 0);
+    EXPECT_TRUE(tb_get_all_values(table, "one", &count) != NULL && count == 1);
+    tb_delete_hash_table(table);
+    tb_hash_table_options cache = {.flags = TB_MULTI | TB_LRU};
+    EXPECT_TRUE(tb_create_hash_table_ex(16, &cache) == NULL);
+}
+
+TEST(test_batch_table) {
+    // the batches of plain tables prefetch, other layouts look up one by one
+    uint32_t layouts[] = {0, 0, TB_COMPACT, TB_LRU, TB_CUCKOO};
+    uint32_t probing[] = {TB_PROBE_DOUBLE, TB_PROBE_LINEAR, TB_PROBE_DOUBLE, TB_PROBE_DOUBLE, TB_PROBE_DOUBLE};
+    char keys[1000][16];
+    const char *pointers[1000];
+    void *values[1000];
+    int deleted[1000];
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(keys[i], "key_%i", i);
+        pointers[i] = keys[i];
+    }
+    for (uint32_t layout = 0; layout < 5; ++layout) {
+        tb_hash_table_options options = {.flags = layouts[layout], .probing = probing[layout]};
+        tb_hash_table *table = tb_create_hash_table_ex(1000, &options);
+        ACTUAL_TRUE(table != NULL);
+        // an empty table finds nothing
+        EXPECT_TRUE(tb_get_values(table, pointers, 1000, values) == 0);
+        EXPECT_TRUE(values[0] == NULL && values[999] == NULL);
+        // the even keys are in the table
+        for (int64_t i = 0; i < 1000; i += 2) {
+            tb_insert_item(table, keys[i], &i);
+        }
+        EXPECT_TRUE(tb_get_values(table, pointers, 1000, values) == 500);
+        uint32_t valid = 0;
+        for (int i = 0; i < 1000; ++i) {
+            valid += i % 2 ? values[i] == NULL : GET_CUSTOM_TYPE(int64_t, values[i]) == i;
+        }
+        EXPECT_EQ(valid, 1000);
+        // the keys of the first half are removed, the odd ones are missing
+        EXPECT_TRUE(tb_delete_items(table, pointers, 500, deleted) == 250);
+        valid = 0;
+        for (int i = 0; i < 500; ++i) {
+            valid += deleted[i] == !(i % 2) && tb_get_value(table, keys[i]) == NULL;
+        }
+        EXPECT_EQ(valid, 500);
+        EXPECT_EQ(table->count, 250);
+        EXPECT_TRUE(tb_delete_items(table, pointers, 1000, NULL) == 250);
+        EXPECT_TRUE(table->empty);
+        tb_delete_hash_table(table);
+    }
+}
+
+TEST(test_ttl_table) {
+    tb_hash_table_options options = {.flags = TB_TTL, .ttl = 100, .clock = test_clock};
+    tb_hash_table *table = tb_create_hash_table_ex(1000, &options);
+    ACTUAL_TRUE(table != NULL);
+    char key[32];
+    for (int64_t i = 0; i < 1000; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        if (i < 500) {
+            tb_insert_item(table, key, &i);
+        } else {
+            // never expires
+            tb_insert_item_ttl(table, key, &i, 0);
+        }
+    }
+    EXPECT_EQ(table->count, 1000);
+    test_now += 99;
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_0")) == 0);
+    test_now += 1;
+    // expired items are misses, but they are not removed yet
+    EXPECT_TRUE(tb_get_value(table, "key_0") == NULL);
+    EXPECT_TRUE(tb_get_item(table, "key_499") == NULL);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_500")) == 500);
+    EXPECT_EQ(table->count, 1000);
+    uint32_t position = 0;
+    uint32_t alive = 0;
+    while (tb_next_item(table, &position) != NULL) {
+        ++alive;
+    }
+    EXPECT_EQ(alive, 500);
+    // a full pass in steps
+    uint32_t removed = 0;
+    for (uint32_t step = 0; step < table->allocated; step += 64) {
+        removed += tb_expire_step(table, 64);
+    }
+    EXPECT_EQ(removed, 500);
+    EXPECT_EQ(table->count, 500);
+    // a new ttl for an existing key
+    int64_t i = 42;
+    tb_insert_item_ttl(table, "key_500", &i, 10);
+    test_now += 10;
+    EXPECT_TRUE(tb_get_value(table, "key_500") == NULL);
+    // a full table removes expired items itself
+    for (int64_t i = 1000; i < 1501; ++i) {
+        sprintf(key, "key_%i", (int)i);
+        tb_insert_item(table, key, &i);
+    }
+    EXPECT_EQ(table->count, 1000);
+    EXPECT_TRUE(GET_INT(tb_get_value(table, "key_1500")) == 1500);
+    tb_delete_hash_table(table);
+}
 
 void run_tests() {
     RUN_TEST(test_insert_table);
     RUN_TEST(test_get_value_from_table);
     RUN_TEST(test_delete_value_from_table);
+    RUN_TEST(test_copy_table);
+    RUN_TEST(test_compact_table);
+    RUN_TEST(test_lru_table);
+    RUN_TEST(test_ttl_table);
+    RUN_TEST(test_filter_table);
+    RUN_TEST(test_seeded_table);
+    RUN_TEST(test_probing_table);
+    RUN_TEST(test_cuckoo_table);
+    RUN_TEST(test_frozen_table);
+    RUN_TEST(test_recycle_table);
+    RUN_TEST(test_interned_table);
+    RUN_TEST(test_snapshot_table);
+    RUN_TEST(test_huge_page_table);
+    RUN_TEST(test_length_keys);
+    RUN_TEST(test_shared_table);
+    RUN_TEST(test_table_log);
+    RUN_TEST(test_merge_tables);
+    RUN_TEST(test_trace_table);
+    RUN_TEST(test_shrink_table);
+    RUN_TEST(test_multi_table);
+    RUN_TEST(test_batch_table);
 }
@@ -0,0 +1,213 @@
+/*
+    The tests of the C++ wrapper, see hashtable.hpp.
+*/
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "hashtable.hpp"
+
+#define NORMAL "\x1B[0m"
+#define RED "\x1B[31m"
+
+#define RUN_TEST(name) __##name##__()
+
+#define TEST(test_section) void __##test_section##__()
+
+#define EXPECT_TRUE(result) { \
+    if (!(result)) {\
+        printf("%sEXPECT_TRUE failed! %s Test: %s. Line:%i \n", RED, NORMAL, __func__, __LINE__);\
+    }\
+}
+
+#define EXPECT_FALSE(result) EXPECT_TRUE(!(result))
+
+TEST(test_cpp_table) {
+    tb::hash_table<std::string, int> table;
+    for (int i = 0; i < 10000; ++i) {
+        // the table grows from 16 items
+        EXPECT_TRUE(table.try_emplace("key_" + std::to_string(i), i).second);
+    }
+    EXPECT_TRUE(table.size() == 10000);
+    EXPECT_FALSE(table.try_emplace("key_5", -5).second);
+    EXPECT_TRUE(table.at("key_5") == 5);
+    // the key is a part of a bigger string, without NUL after it
+    std::string text = "key_123456";
+    EXPECT_TRUE(table.at(std::string_view(text).substr(0, 7)) == 123);
+    EXPECT_FALSE(table.contains(std::string_view(text).substr(0, 2)));
+    EXPECT_FALSE(table.contains(text));
+    bool thrown = false;
+    try {
+        table.at("key_10000");
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+
+    table["key_7"] += 100;
+    EXPECT_TRUE(table.at("key_7") == 107);
+    EXPECT_TRUE(table["new"] == 0);
+    EXPECT_FALSE(table.insert_or_assign("new", 9).second);
+    EXPECT_TRUE(table.insert_or_assign("newer", 10).second);
+    EXPECT_TRUE(table.find("new")->second == 9);
+    EXPECT_TRUE(table.erase("new") == 1);
+    EXPECT_TRUE(table.erase("new") == 0);
+    EXPECT_TRUE(table.find("new") == table.end());
+
+    long long sum = 0;
+    size_t count = 0;
+    for (const auto &[key, value] : table) {
+        EXPECT_TRUE(key.substr(0, 3) == "key" || key == "newer");
+        sum += value;
+        ++count;
+    }
+    EXPECT_TRUE(count == table.size());
+    EXPECT_TRUE(sum == 49995000LL + 100 + 10);
+    // an iterator of `find` continues the iteration
+    count = 0;
+    for (auto it = table.find("key_0"); it != table.end(); ++it) {
+        ++count;
+    }
+    EXPECT_TRUE(count >= 1 && count <= table.size());
+
+    // values, which do not fit into the item, are moved into it
+    tb::hash_table<std::string, std::string> names(4);
+    std::string name(100, 'x');
+    names.try_emplace("long", std::move(name));
+    names.insert_or_assign("short", "y");
+    EXPECT_TRUE(names.at("long").size() == 100);
+    tb::hash_table<std::string, std::string> copy = names;
+    copy.at("short") = "z";
+    EXPECT_TRUE(names.at("short") == "y");
+    EXPECT_TRUE(copy.at("short") == "z");
+    tb::hash_table<std::string, std::string> moved = std::move(copy);
+    EXPECT_TRUE(moved.at("long").size() == 100);
+    names.clear();
+    EXPECT_TRUE(names.empty());
+    EXPECT_TRUE(names.erase("long") == 0);
+
+    tb::hash_table<std::string, std::unique_ptr<int>> owners;
+    owners.try_emplace("one", std::make_unique<int>(1));
+    EXPECT_TRUE(*owners.at("one") == 1);
+    EXPECT_TRUE(owners.erase("one") == 1);
+
+    // other layouts and hashes of the engine
+    uint32_t layouts[] = {TB_COMPACT, TB_CUCKOO, TB_FILTER};
+    for (uint32_t layout : layouts) {
+        tb_hash_table_options options = {};
+        options.flags = layout;
+        tb::hash_table<std::string, std::string, tb::seeded_hash> other(8, options);
+        for (int i = 0; i < 1000; ++i) {
+            other.try_emplace(std::to_string(i), std::to_string(i * 2));
+        }
+        EXPECT_TRUE(other.size() == 1000);
+        EXPECT_TRUE(other.at("999") == "1998");
+        EXPECT_TRUE(other.erase("500") == 1);
+        EXPECT_FALSE(other.contains("500"));
+        count = 0;
+        for (auto it = other.find("10"); it != other.end(); it++) {
+            ++count;
+        }
+        EXPECT_TRUE(count >= 1 && count <= 999);
+    }
+    thrown = false;
+    try {
+        tb_hash_table_options options = {};
+        options.flags = TB_LRU;
+        tb::hash_table<std::string, int> cache(8, options);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+
+    // keys with NUL bytes would collide in the engine
+    using namespace std::string_literals;
+    tb::hash_table<std::string, int> nul(8);
+    nul["a"] = 1;
+    thrown = false;
+    try {
+        nul["a\0b"s] = 2;
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+    thrown = false;
+    try {
+        nul.insert_or_assign("a\0c"s, 3);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+    EXPECT_TRUE(nul.size() == 1);
+    EXPECT_FALSE(nul.contains("a\0b"s));
+    EXPECT_TRUE(nul.find("a\0b"s) == nul.end());
+    EXPECT_TRUE(nul.erase("a\0b"s) == 0);
+    EXPECT_TRUE(nul.at("a") == 1);
+}
+
+TEST(test_cpp_perfomance) {
+    const int count = 200000;
+    std::vector<std::string> keys;
+    // lookups by views of a bigger buffer, as a parser gives them
+    std::string buffer;
+    std::vector<std::string_view> views;
+    for (int i = 0; i < count; ++i) {
+        keys.push_back("some_key_" + std::to_string(i));
+        buffer += keys.back() + ",";
+    }
+    size_t offset = 0;
+    for (int i = 0; i < count; ++i) {
+        views.push_back(std::string_view(buffer).substr(offset, keys[i].size()));
+        offset += keys[i].size() + 1;
+    }
+
+    tb::hash_table<std::string, int> table(count);
+    clock_t begin = clock();
+    for (int i = 0; i < count; ++i) {
+        table.try_emplace(keys[i], i);
+    }
+    clock_t end = clock();
+    double time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'try_emplace' perfomance of tb::hash_table - %i items: %f ms \n", count, time_spent);
+
+    std::unordered_map<std::string, int> map;
+    map.reserve(count);
+    begin = clock();
+    for (int i = 0; i < count; ++i) {
+        map.try_emplace(keys[i], i);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'try_emplace' perfomance of std::unordered_map - %i items: %f ms \n", count, time_spent);
+
+    long long sum = 0;
+    begin = clock();
+    for (int i = 0; i < count; ++i) {
+        sum += table.find(views[i])->second;
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'find' by std::string_view perfomance of tb::hash_table - %i items: %f ms \n",
+            count, time_spent);
+
+    begin = clock();
+    for (int i = 0; i < count; ++i) {
+        // C++17 maps have no heterogeneous lookup, the key is a temporary string
+        sum -= map.find(std::string(views[i]))->second;
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / (CLOCKS_PER_SEC / 1000);
+    printf("'find' by std::string_view perfomance of std::unordered_map - %i items: %f ms \n",
+            count, time_spent);
+    EXPECT_TRUE(sum == 0);
+}
+
+int main() {
+    RUN_TEST(test_cpp_table);
+    RUN_TEST(test_cpp_perfomance);
+    return 0;
+}